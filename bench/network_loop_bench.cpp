@@ -0,0 +1,370 @@
+/**
+ * @file network_loop_bench.cpp
+ * @brief Host benchmark of the network task event loop, comparing the
+ * original polling loop with the readiness based NetworkLoop.
+ *
+ * Build and run on Linux:
+ *
+ *   g++ -O2 -std=gnu++11 -DSH_WG -DSH_WG_LINUX -Isrc/linux/include -Isrc \
+ *     bench/network_loop_bench.cpp src/network_loop.cpp \
+ *     src/linux/network_loop.cpp src/linux/reactesp.cpp \
+ *     src/linux/arduino.cpp src/linux/wifi.cpp -pthread \
+ *     -o network_loop_bench
+ *   ./network_loop_bench
+ *
+ * A minimal TCP server is run in a thread of its own, once as the old
+ * network task did (a ReactESP timer polling the listening socket and the
+ * clients every 100 us, and a 1 ms delay after every tick) and once on a
+ * NetworkLoop. Lines are fed to it from another thread through a
+ * TaskBridge, as the CAN task does.
+ *
+ * The idle run has a few connected clients and no traffic. The loaded run
+ * feeds a line every millisecond, measures the time from connect() to the
+ * first received byte for a series of new connections, and the latency of
+ * every line on a long-lived connection. The coalescing deadline is zero,
+ * so that the numbers only reflect the event loop. Server thread CPU time
+ * is measured with CLOCK_THREAD_CPUTIME_ID.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffered_tcp_client.h"
+#include "network_loop.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "task_bridge.h"
+
+constexpr int kNumClients = 4;
+constexpr double kIdleSeconds = 3.0;
+constexpr double kLoadSeconds = 3.0;
+constexpr int kNumConnects = 50;
+constexpr uint16_t kPort = 15678;
+
+static int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static double ThreadCPUSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Client slots shared by both server variants.
+class Clients {
+ public:
+  Clients() {
+    for (auto& client : clients_) {
+      client.set_tx_buffer(16384, TXOverflowPolicy::kDropOldest);
+      client.set_coalescing(kTCPSegmentSize, 0);
+    }
+  }
+
+  BufferedTCPClient* add(int fd) {
+    for (auto& client : clients_) {
+      if (!client.is_in_use()) {
+        client.attach(WiFiClient(fd));
+        return &client;
+      }
+    }
+    close(fd);
+    return nullptr;
+  }
+
+  BufferedTCPClient clients_[kNumClients + 2];
+};
+
+static int Listen() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(kPort);
+  bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+  listen(fd, 8);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  return fd;
+}
+
+static int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(kPort);
+  connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+  return fd;
+}
+
+/// Server thread body; returns when done is set.
+using ServerFn = void (*)(std::atomic<TaskBridge<String>*>& bridge_out,
+                          std::atomic<bool>& done, double& cpu_seconds,
+                          uint32_t& iterations);
+
+static void RunPollingServer(std::atomic<TaskBridge<String>*>& bridge_out,
+                             std::atomic<bool>& done, double& cpu_seconds,
+                             uint32_t& iterations) {
+  ReactESP app(false);
+  Clients clients;
+  int listen_fd = Listen();
+  auto bridge = new TaskBridge<String>(1000, &app);
+  bridge->connect_to(new LambdaConsumer<String>([&](String line) {
+    for (auto& client : clients.clients_) {
+      if (client.is_in_use()) {
+        client.queue_tx(line);
+        if (client.is_flush_due() && !client.flush_tx()) {
+          client.detach();
+        }
+      }
+    }
+  }));
+  app.onRepeatMicros(100, [&]() {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd >= 0) {
+      clients.add(fd);
+    }
+    for (auto& client : clients.clients_) {
+      if (!client.is_in_use()) {
+        continue;
+      }
+      String line;
+      while (client.read_line(line)) {
+      }
+      if (!client.client_->connected() ||
+          (client.is_flush_due() && !client.flush_tx())) {
+        client.detach();
+      }
+    }
+  });
+  bridge_out = bridge;
+
+  double start = ThreadCPUSeconds();
+  iterations = 0;
+  while (!done) {
+    app.tick();
+    delay(1);
+    iterations++;
+  }
+  cpu_seconds = ThreadCPUSeconds() - start;
+  for (auto& client : clients.clients_) {
+    if (client.is_in_use()) {
+      client.detach();
+    }
+  }
+  close(listen_fd);
+}
+
+static void RunNetworkLoopServer(
+    std::atomic<TaskBridge<String>*>& bridge_out, std::atomic<bool>& done,
+    double& cpu_seconds, uint32_t& iterations) {
+  NetworkLoop loop;
+  Clients clients;
+  int listen_fd = Listen();
+
+  auto service_tx = [&](BufferedTCPClient& client) {
+    if (client.is_flush_due() && !client.flush_tx()) {
+      loop.unwatch(client.fd());
+      client.detach();
+      return;
+    }
+    loop.set_write_interest(client.fd(), client.get_tx_depth() > 0 &&
+                                             client.is_flush_due());
+    if (client.get_tx_depth() > 0 && !client.is_flush_due()) {
+      loop.wake_at(client.get_flush_deadline());
+    }
+  };
+
+  loop.watch(listen_fd, [&]() {
+    int fd;
+    while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+      BufferedTCPClient* client = clients.add(fd);
+      if (client == nullptr) {
+        continue;
+      }
+      loop.watch(
+          client->fd(),
+          [&, client]() {
+            String line;
+            while (client->read_line(line)) {
+            }
+            if (!client->client_->connected()) {
+              loop.unwatch(client->fd());
+              client->detach();
+            }
+          },
+          [&, client]() { service_tx(*client); });
+    }
+  });
+
+  auto bridge = new TaskBridge<String>(1000, &loop);
+  bridge->connect_to(new LambdaConsumer<String>([&](String line) {
+    for (auto& client : clients.clients_) {
+      if (client.is_in_use()) {
+        client.queue_tx(line);
+        service_tx(client);
+      }
+    }
+  }));
+  bridge_out = bridge;
+
+  double start = ThreadCPUSeconds();
+  uint32_t start_iterations = loop.get_iteration_count();
+  while (!done) {
+    loop.run_once();
+  }
+  iterations = loop.get_iteration_count() - start_iterations;
+  cpu_seconds = ThreadCPUSeconds() - start;
+  for (auto& client : clients.clients_) {
+    if (client.is_in_use()) {
+      loop.unwatch(client.fd());
+      client.detach();
+    }
+  }
+  loop.unwatch(listen_fd);
+  close(listen_fd);
+}
+
+struct Result {
+  double idle_cpu_percent;
+  double idle_wakeups;
+  double load_cpu_percent;
+  double connect_p50_ms;
+  double connect_max_ms;
+  double line_p50_ms;
+  double line_p99_ms;
+};
+
+static double Percentile(std::vector<int64_t>& values, int percent) {
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100] / 1000.0;
+}
+
+static void Phase(ServerFn server_fn, double seconds, bool load,
+                  double& cpu_percent, double& wakeups,
+                  std::vector<int64_t>* connect_latencies,
+                  std::vector<int64_t>* line_latencies) {
+  std::atomic<bool> done{false};
+  std::atomic<TaskBridge<String>*> bridge{nullptr};
+  double cpu_seconds = 0;
+  uint32_t iterations = 0;
+  std::thread server(
+      [&]() { server_fn(bridge, done, cpu_seconds, iterations); });
+  while (bridge == nullptr) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::vector<int> idle_fds;
+  for (int i = 0; i < kNumClients; i++) {
+    idle_fds.push_back(Connect());
+  }
+
+  std::atomic<bool> feeding{load};
+  std::thread feeder([&]() {
+    char line[64];
+    int64_t next = NowMicros();
+    while (feeding) {
+      snprintf(line, sizeof(line), "%lld\r\n", (long long)NowMicros());
+      bridge.load()->set_input(line);
+      next += 1000;
+      int64_t wait = next - NowMicros();
+      if (wait > 0) {
+        usleep(wait);
+      }
+    }
+  });
+
+  if (load) {
+    // a long-lived client measuring line latencies
+    int reader_fd = Connect();
+    std::thread reader([&]() {
+      char buf[4096];
+      std::string pending;
+      ssize_t n;
+      while ((n = recv(reader_fd, buf, sizeof(buf), 0)) > 0) {
+        int64_t now = NowMicros();
+        pending.append(buf, n);
+        size_t pos;
+        while ((pos = pending.find('\n')) != std::string::npos) {
+          line_latencies->push_back(now - strtoll(pending.c_str(), NULL, 10));
+          pending.erase(0, pos + 1);
+        }
+      }
+    });
+
+    for (int i = 0; i < kNumConnects; i++) {
+      int64_t start = NowMicros();
+      int fd = Connect();
+      char c;
+      if (recv(fd, &c, 1, 0) == 1) {
+        connect_latencies->push_back(NowMicros() - start);
+      }
+      close(fd);
+      std::this_thread::sleep_for(
+          std::chrono::microseconds((int64_t)(seconds * 1e6 / kNumConnects)));
+    }
+    feeding = false;
+    feeder.join();
+    shutdown(reader_fd, SHUT_RDWR);
+    reader.join();
+    close(reader_fd);
+  } else {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds((int64_t)(seconds * 1e6)));
+    feeder.join();
+  }
+
+  done = true;
+  server.join();
+  for (int fd : idle_fds) {
+    close(fd);
+  }
+  cpu_percent = cpu_seconds / seconds * 100;
+  wakeups = iterations / seconds;
+}
+
+static Result Run(ServerFn server_fn) {
+  Result result;
+  std::vector<int64_t> connect_latencies;
+  std::vector<int64_t> line_latencies;
+  double load_wakeups;
+  Phase(server_fn, kIdleSeconds, false, result.idle_cpu_percent,
+        result.idle_wakeups, nullptr, nullptr);
+  Phase(server_fn, kLoadSeconds, true, result.load_cpu_percent, load_wakeups,
+        &connect_latencies, &line_latencies);
+  result.connect_p50_ms = Percentile(connect_latencies, 50);
+  result.connect_max_ms = Percentile(connect_latencies, 100);
+  result.line_p50_ms = Percentile(line_latencies, 50);
+  result.line_p99_ms = Percentile(line_latencies, 99);
+  return result;
+}
+
+int main() {
+  printf("%-14s %9s %9s %9s %11s %11s %9s %9s\n", "", "idle CPU",
+         "wakeups/s", "load CPU", "1st byte", "1st byte", "line", "line");
+  printf("%-14s %9s %9s %9s %11s %11s %9s %9s\n", "", "%", "", "%", "p50 ms",
+         "max ms", "p50 ms", "p99 ms");
+  const ServerFn servers[] = {RunPollingServer, RunNetworkLoopServer};
+  const char* names[] = {"polling", "NetworkLoop"};
+  for (int i = 0; i < 2; i++) {
+    Result r = Run(servers[i]);
+    printf("%-14s %9.2f %9.0f %9.2f %11.2f %11.2f %9.2f %9.2f\n", names[i],
+           r.idle_cpu_percent, r.idle_wakeups, r.load_cpu_percent,
+           r.connect_p50_ms, r.connect_max_ms, r.line_p50_ms, r.line_p99_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,345 @@
+/**
+ * @file tcp_client_bench.cpp
+ * @brief Host benchmark of the upstream TCP client TX path: idle CPU load of
+ * the client task, delivery latency and throughput.
+ *
+ * Build and run on Linux:
+ *
+ *   g++ -O2 -std=gnu++11 -DSH_WG -DSH_WG_LINUX -Isrc/linux/include -Isrc \
+ *     bench/tcp_client_bench.cpp src/streaming_tcp_client.cpp \
+ *     src/tcp_client_backlog.cpp src/host_resolver.cpp \
+ *     src/network_loop.cpp src/linux/network_loop.cpp src/linux/reactesp.cpp \
+ *     src/linux/arduino.cpp src/linux/wifi.cpp -pthread -o tcp_client_bench
+ *   ./tcp_client_bench --rate 2000 --seconds 5
+ *
+ * Options (defaults in parentheses):
+ *
+ *   --rate N          lines per second fed to the client (2000, roughly a
+ *                     fully loaded 250 kbit/s NMEA 2000 bus); 0 feeds lines
+ *                     as fast as the client accepts them
+ *   --seconds N       duration of the load phase (5)
+ *   --idle-seconds N  duration of the idle phase (2)
+ *   --targets N       number of servers the lines are sent to (1)
+ *
+ * The benchmark listens on the loopback interface and lets the clients
+ * connect to it. After the connections are up, the CPU time of the client
+ * task is measured first with no traffic and then while YDWG RAW lines are
+ * fed to set_input() from the main thread, as the network task does in the
+ * gateway. Every line carries a sequence number and its injection time, so
+ * the receiving ends measure the delivery latency and count the lines that
+ * never arrived. Throughput and loss are given per server.
+ *
+ * CPU time is read from /proc/self/task/<tid>/schedstat of the thread that
+ * start() creates.
+ */
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "network_loop.h"
+#include "streaming_tcp_client.h"
+
+constexpr uint16_t kPort = 15680;
+// time allowed for the tail of the stream to arrive
+constexpr double kDrainSeconds = 1.0;
+
+struct Options {
+  int rate = 2000;
+  double seconds = 5;
+  double idle_seconds = 2;
+  int targets = 1;
+};
+
+static int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static std::set<int> ThreadIDs() {
+  std::set<int> tids;
+  DIR* dir = opendir("/proc/self/task");
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      tids.insert(atoi(entry->d_name));
+    }
+  }
+  closedir(dir);
+  return tids;
+}
+
+/// CPU time of a thread of this process in seconds.
+static double ThreadCPUSeconds(int tid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", tid);
+  FILE* file = fopen(path, "r");
+  unsigned long long ns = 0;
+  if (file != nullptr) {
+    if (fscanf(file, "%llu", &ns) != 1) {
+      ns = 0;
+    }
+    fclose(file);
+  }
+  return ns / 1e9;
+}
+
+static String FormatLine(uint32_t seq, uint32_t micros) {
+  char buf[64];
+  snprintf(buf, sizeof(buf),
+           "00:00:00.000 R 09F80102 %02X %02X %02X %02X %02X %02X %02X "
+           "%02X\r\n",
+           seq >> 24, (seq >> 16) & 0xFF, (seq >> 8) & 0xFF, seq & 0xFF,
+           micros >> 24, (micros >> 16) & 0xFF, (micros >> 8) & 0xFF,
+           micros & 0xFF);
+  return buf;
+}
+
+/// Receiving end of the client connection.
+struct Sink {
+  std::atomic<uint64_t> lines{0};
+  uint64_t keepalives = 0;
+  uint64_t malformed = 0;
+  uint32_t max_seq = 0;
+  std::vector<uint32_t> latencies_us;
+  std::vector<char> pending;
+
+  void receive(const char* data, size_t length) {
+    pending.insert(pending.end(), data, data + length);
+    size_t start = 0;
+    while (true) {
+      auto newline = std::find(pending.begin() + start, pending.end(), '\n');
+      if (newline == pending.end()) {
+        break;
+      }
+      *newline = '\0';
+      handle_line(&pending[start]);
+      start = newline - pending.begin() + 1;
+    }
+    pending.erase(pending.begin(), pending.begin() + start);
+  }
+
+  void handle_line(const char* line) {
+    if (line[0] == '\r' || line[0] == '\0') {
+      keepalives++;
+      return;
+    }
+    unsigned b[8];
+    if (sscanf(line, "00:00:00.000 R 09F80102 %X %X %X %X %X %X %X %X",
+               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6],
+               &b[7]) != 8) {
+      malformed++;
+      return;
+    }
+    uint32_t seq = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+    uint32_t micros = (b[4] << 24) | (b[5] << 16) | (b[6] << 8) | b[7];
+    latencies_us.push_back((uint32_t)NowMicros() - micros);
+    max_seq = std::max(max_seq, seq);
+    lines++;
+  }
+};
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (strcmp(arg, "--rate") == 0) {
+      options.rate = atoi(value);
+    } else if (strcmp(arg, "--seconds") == 0) {
+      options.seconds = atof(value);
+    } else if (strcmp(arg, "--idle-seconds") == 0) {
+      options.idle_seconds = atof(value);
+    } else if (strcmp(arg, "--targets") == 0) {
+      options.targets = atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return options.rate >= 0 && options.seconds > 0 &&
+         options.idle_seconds >= 0 && options.targets >= 1 &&
+         options.targets <= (int)kMaxTCPClientTargets;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    fprintf(stderr, "Invalid arguments; see the top of %s\n", __FILE__);
+    return 1;
+  }
+
+  std::vector<int> listen_fds;
+  std::vector<HostPort> targets;
+  for (int i = 0; i < options.targets; i++) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(kPort + i);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 1) < 0) {
+      perror("listen");
+      return 1;
+    }
+    listen_fds.push_back(listen_fd);
+    targets.push_back(HostPort{"127.0.0.1", (uint16_t)(kPort + i)});
+  }
+
+  ReactESP app;
+  NetworkLoop rx_loop;
+  Networking networking;
+  TCPClientGroup clients(targets, &networking, &rx_loop);
+
+  std::set<int> tids_before = ThreadIDs();
+  Startable::start_all();
+  app.tick();
+  int client_tid = 0;
+  for (int tid : ThreadIDs()) {
+    if (tids_before.count(tid) == 0) {
+      client_tid = tid;
+    }
+  }
+
+  std::vector<int> fds;
+  std::vector<std::unique_ptr<Sink>> sinks;
+  std::vector<std::thread> sink_threads;
+  std::atomic<bool> stop{false};
+  for (int listen_fd : listen_fds) {
+    int fd = accept(listen_fd, NULL, NULL);
+    Sink* sink = new Sink();
+    fds.push_back(fd);
+    sinks.emplace_back(sink);
+    sink_threads.emplace_back([&stop, fd, sink]() {
+      char buf[65536];
+      while (!stop) {
+        int received = recv(fd, buf, sizeof(buf), 0);
+        if (received <= 0) {
+          break;
+        }
+        sink->receive(buf, received);
+      }
+    });
+  }
+
+  // the clients drain their RX bridge in the rx loop
+  std::thread rx_thread([&]() {
+    while (!stop) {
+      rx_loop.run_once();
+    }
+  });
+
+  usleep(200000);
+  double cpu_start = ThreadCPUSeconds(client_tid);
+  usleep(options.idle_seconds * 1e6);
+  double idle_cpu = ThreadCPUSeconds(client_tid) - cpu_start;
+
+  auto max_tx_depth = [&]() {
+    size_t depth = 0;
+    for (auto client : clients.get_clients()) {
+      depth = std::max(depth, client->get_tx_depth());
+    }
+    return depth;
+  };
+
+  uint32_t num_lines = 0;
+  int64_t start = NowMicros();
+  int64_t end = start + (int64_t)(options.seconds * 1e6);
+  cpu_start = ThreadCPUSeconds(client_tid);
+  if (options.rate > 0) {
+    double interval_us = 1e6 / options.rate;
+    uint32_t total = options.rate * options.seconds;
+    for (; num_lines < total; num_lines++) {
+      int64_t due = start + (int64_t)(num_lines * interval_us);
+      int64_t wait = due - NowMicros();
+      if (wait > 0) {
+        usleep(wait);
+      }
+      clients.set_input(
+          OriginString{0, FormatLine(num_lines, NowMicros()), 0x09F80102});
+    }
+  } else {
+    // keep the TX rings topped up without overflowing them
+    while (NowMicros() < end) {
+      while (max_tx_depth() < kTCPClientTXRingSize / 2) {
+        clients.set_input(
+            OriginString{0, FormatLine(num_lines, NowMicros()), 0x09F80102});
+        num_lines++;
+      }
+      usleep(100);
+    }
+  }
+  double feed_seconds = (NowMicros() - start) / 1e6;
+  usleep(kDrainSeconds * 1e6);
+  double load_cpu = ThreadCPUSeconds(client_tid) - cpu_start;
+
+  stop = true;
+  for (size_t i = 0; i < fds.size(); i++) {
+    shutdown(fds[i], SHUT_RDWR);
+    sink_threads[i].join();
+  }
+  rx_loop.wake();
+  rx_thread.join();
+
+  std::vector<uint32_t> samples;
+  uint64_t delivered = 0;
+  uint64_t keepalives = 0;
+  uint64_t malformed = 0;
+  for (auto& sink : sinks) {
+    samples.insert(samples.end(), sink->latencies_us.begin(),
+                   sink->latencies_us.end());
+    delivered += sink->lines;
+    keepalives += sink->keepalives;
+    malformed += sink->malformed;
+  }
+  std::sort(samples.begin(), samples.end());
+  double p50 = samples.empty() ? 0 : samples[samples.size() / 2] / 1000.0;
+  double p99 =
+      samples.empty() ? 0 : samples[samples.size() * 99 / 100] / 1000.0;
+  double max = samples.empty() ? 0 : samples.back() / 1000.0;
+  size_t high_water = 0;
+  uint32_t drops = 0;
+  for (auto client : clients.get_clients()) {
+    high_water = std::max(high_water, client->get_tx_high_water());
+    drops += client->get_tx_drop_count();
+  }
+  uint64_t per_target = delivered / options.targets;
+
+  printf("idle: client task CPU %.2f%% over %.1f s\n",
+         idle_cpu * 100 / std::max(options.idle_seconds, 1e-9),
+         options.idle_seconds);
+  printf("load: %u lines fed in %.1f s (%s) to %d server(s), %llu delivered "
+         "per server (%.0f lines/s), %llu lost\n",
+         num_lines, feed_seconds,
+         options.rate > 0 ? "paced" : "unpaced", options.targets,
+         (unsigned long long)per_target, per_target / feed_seconds,
+         (unsigned long long)((uint64_t)num_lines * options.targets -
+                              delivered));
+  printf("      latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", p50, p99,
+         max);
+  printf("      client task CPU %.2f%%, %llu keepalives, %llu malformed\n",
+         load_cpu * 100 / (feed_seconds + kDrainSeconds),
+         (unsigned long long)keepalives, (unsigned long long)malformed);
+  printf("      TX ring high water %u bytes, %u lines dropped\n",
+         (unsigned)high_water, drops);
+
+  // the client task never returns; don't wait for it
+  fflush(stdout);
+  _exit(0);
+}
@@ -0,0 +1,159 @@
+/**
+ * @file tcp_coalescing_bench.cpp
+ * @brief Host benchmark of the TCP client write coalescing: number of
+ * socket writes and added latency as a function of the flush deadline.
+ *
+ * Build and run on Linux:
+ *
+ *   g++ -O2 -std=gnu++11 -DSH_WG -DSH_WG_LINUX -Isrc/linux/include -Isrc \
+ *     bench/tcp_coalescing_bench.cpp src/linux/arduino.cpp \
+ *     src/linux/wifi.cpp -pthread -o tcp_coalescing_bench
+ *   ./tcp_coalescing_bench
+ *
+ * 45-byte YDWG RAW sized lines are generated with exponentially distributed
+ * intervals at the given mean rate and sent through a BufferedTCPClient over
+ * a loopback connection, polling it every 100 us like StreamingTCPServer
+ * does. The receiver timestamps every line, so the latency is the time
+ * spent waiting in the client's TX ring.
+ *
+ * Loopback has no per-packet cost, so the WiFi airtime column is a model:
+ * each write is assumed to cost one data frame and one TCP ACK frame,
+ * 250 us of medium time in total, plus the payload at 20 Mbit/s.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffered_tcp_client.h"
+
+constexpr double kRunSeconds = 3.0;
+constexpr size_t kLineLength = 45;
+constexpr double kPerWriteAirtimeUs = 250;
+constexpr double kPayloadBitsPerUs = 20;
+
+static int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Result {
+  double writes_per_second;
+  double bytes_per_write;
+  double mean_latency_ms;
+  double p99_latency_ms;
+  double airtime_percent;
+};
+
+static Result Run(double lines_per_second, unsigned long deadline_ms) {
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  int enable = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr));
+  socklen_t addr_len = sizeof(addr);
+  getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len);
+  listen(listen_fd, 1);
+
+  int reader_fd = socket(AF_INET, SOCK_STREAM, 0);
+  connect(reader_fd, (struct sockaddr*)&addr, sizeof(addr));
+  int writer_fd = accept(listen_fd, NULL, NULL);
+  close(listen_fd);
+
+  std::atomic<bool> done{false};
+  std::vector<int64_t> latencies;
+  std::thread reader([&]() {
+    char buf[65536];
+    std::string pending;
+    while (true) {
+      ssize_t n = recv(reader_fd, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        break;
+      }
+      int64_t now = NowMicros();
+      pending.append(buf, n);
+      size_t pos;
+      while ((pos = pending.find('\n')) != std::string::npos) {
+        latencies.push_back(now - strtoll(pending.c_str(), NULL, 10));
+        pending.erase(0, pos + 1);
+      }
+    }
+  });
+
+  BufferedTCPClient client;
+  client.set_tx_buffer(16384, TXOverflowPolicy::kDropNewest);
+  client.set_coalescing(kTCPSegmentSize, deadline_ms);
+  client.attach(WiFiClient(writer_fd));
+
+  std::mt19937 rng(1);
+  std::exponential_distribution<double> interval(lines_per_second / 1e6);
+  int64_t start = NowMicros();
+  int64_t end = start + (int64_t)(kRunSeconds * 1e6);
+  double next_line = start;
+  while (NowMicros() < end) {
+    int64_t now = NowMicros();
+    while (next_line <= now) {
+      char line[kLineLength + 1];
+      snprintf(line, sizeof(line), "%-*lld\r\n", (int)kLineLength - 2,
+               (long long)now);
+      client.queue_tx(line);
+      next_line += interval(rng);
+    }
+    if (client.is_flush_due()) {
+      client.flush_tx();
+    }
+    usleep(100);
+  }
+  while (client.get_tx_depth() > 0) {
+    client.flush_tx();
+  }
+  uint32_t writes = client.get_tx_write_count();
+  client.detach();
+  reader.join();
+  close(reader_fd);
+
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0;
+  for (int64_t latency : latencies) {
+    sum += latency;
+  }
+  Result result;
+  result.writes_per_second = writes / kRunSeconds;
+  result.bytes_per_write = (double)latencies.size() * kLineLength / writes;
+  result.mean_latency_ms = sum / latencies.size() / 1000;
+  result.p99_latency_ms = latencies[latencies.size() * 99 / 100] / 1000.0;
+  double airtime_us =
+      result.writes_per_second * kPerWriteAirtimeUs +
+      result.writes_per_second * result.bytes_per_write * 8 / kPayloadBitsPerUs;
+  result.airtime_percent = airtime_us / 1e6 * 100;
+  return result;
+}
+
+int main() {
+  const double rates[] = {500, 1500, 3000};
+  const unsigned long deadlines[] = {0, 2, 5, 10, 20, 50};
+  printf("%8s %8s %10s %10s %10s %10s %10s\n", "lines/s", "deadline",
+         "writes/s", "B/write", "mean ms", "p99 ms", "airtime %");
+  for (double rate : rates) {
+    for (unsigned long deadline : deadlines) {
+      Result r = Run(rate, deadline);
+      printf("%8.0f %8lu %10.0f %10.0f %10.2f %10.2f %10.1f\n", rate,
+             deadline, r.writes_per_second, r.bytes_per_write,
+             r.mean_latency_ms, r.p99_latency_ms, r.airtime_percent);
+    }
+  }
+  return 0;
+}
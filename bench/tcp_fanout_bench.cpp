@@ -0,0 +1,467 @@
+/**
+ * @file tcp_fanout_bench.cpp
+ * @brief Host load test of the StreamingTCPServer fan-out path with many
+ * simultaneous clients, some of which read slowly.
+ *
+ * Build and run on Linux:
+ *
+ *   g++ -O2 -std=gnu++11 -DSH_WG -DSH_WG_LINUX -Isrc/linux/include -Isrc \
+ *     bench/tcp_fanout_bench.cpp src/network_loop.cpp \
+ *     src/client_subscription.cpp src/pgn_filter.cpp \
+ *     src/linux/network_loop.cpp src/linux/reactesp.cpp \
+ *     src/linux/arduino.cpp src/linux/wifi.cpp -pthread \
+ *     -o tcp_fanout_bench
+ *   ./tcp_fanout_bench --clients 10 --slow 2 --rate 2000 --seconds 10
+ *
+ * Options (defaults in parentheses):
+ *
+ *   --clients N           connections in total (10)
+ *   --slow N              of which slow readers (2)
+ *   --rate N              lines per second fed to the server (2000, roughly
+ *                         a fully loaded 250 kbit/s NMEA 2000 bus)
+ *   --seconds N           duration of the run (10)
+ *   --format F            ydwg (45 byte lines) or nmea0183 (80 byte lines)
+ *   --slow-bps N          read rate of the slow clients, bytes/s (2000)
+ *   --tx-buffer N         TX buffer size per client (server default)
+ *   --flush-deadline-ms N write coalescing deadline (server default)
+ *   --slow-timeout-s N    slow client eviction timeout, 0 = off (server
+ *                         default)
+ *   --server-sndbuf N     socket send buffer of the accepted connections
+ *                         (5744, the lwIP TCP_SND_BUF of the ESP32 Arduino
+ *                         core; 0 keeps the Linux default)
+ *
+ * The server runs on a NetworkLoop in a thread of its own, and lines are
+ * fed to its set_input() from another thread through a TaskBridge, as the
+ * CAN task does in the gateway. Every line carries a sequence number and
+ * its injection time, so each client measures the delivery latency of the
+ * lines it receives and counts the lines it never got. Slow clients have a
+ * small receive buffer and read at a fixed byte rate; they exercise the
+ * TX overflow policy and the slow client eviction.
+ *
+ * Server CPU time is that of the network thread, measured with
+ * CLOCK_THREAD_CPUTIME_ID. More clients than the server has slots can be
+ * given to measure refusals and evictions.
+ *
+ * Linux grows loopback socket buffers to megabytes, which would hide the
+ * server's own TX buffering entirely. The send buffer of the server side
+ * sockets is therefore shrunk to that of the device after they have been
+ * accepted.
+ *
+ * "gaps" are lines a client never received although later ones arrived,
+ * i.e. lines dropped by the server. "unsent" are lines still queued
+ * somewhere when the run ended.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "network_loop.h"
+#include "streaming_tcp_server.h"
+#include "task_bridge.h"
+
+constexpr uint16_t kPort = 15679;
+// time allowed for the fast clients to receive the tail of the stream
+constexpr double kDrainSeconds = 1.0;
+// receive buffer of the slow clients, small to build up back pressure fast
+constexpr int kSlowClientRcvBuf = 4096;
+
+struct Options {
+  int clients = 10;
+  int slow = 2;
+  int rate = 2000;
+  double seconds = 10;
+  bool nmea0183 = false;
+  int slow_bps = 2000;
+  size_t tx_buffer = kDefaultTCPClientTXBufferSize;
+  unsigned long flush_deadline_ms = kDefaultTCPFlushDeadlineMs;
+  unsigned long slow_timeout_ms = kDefaultSlowClientTimeoutMs;
+  int server_sndbuf = 5744;
+};
+
+static int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static double ThreadCPUSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Format a test line carrying the sequence number and the injection time in
+ * the data bytes of a YDWG RAW line or the fields of an NMEA 0183 sentence.
+ */
+static String FormatLine(bool nmea0183, uint32_t seq, uint32_t micros) {
+  char buf[96];
+  if (nmea0183) {
+    snprintf(buf, sizeof(buf),
+             "$GPXXX,%08X,%08X,0000.0000,N,00000.0000,E,000.0,000.0,"
+             "000000,,*00\r\n",
+             seq, micros);
+  } else {
+    snprintf(buf, sizeof(buf),
+             "00:00:00.000 R 09F80102 %02X %02X %02X %02X %02X %02X %02X "
+             "%02X\r\n",
+             seq >> 24, (seq >> 16) & 0xFF, (seq >> 8) & 0xFF, seq & 0xFF,
+             micros >> 24, (micros >> 16) & 0xFF, (micros >> 8) & 0xFF,
+             micros & 0xFF);
+  }
+  return buf;
+}
+
+/// Parse a line made by FormatLine(); false if the line is malformed.
+static bool ParseLine(bool nmea0183, const char* line, uint32_t& seq,
+                      uint32_t& micros) {
+  if (nmea0183) {
+    return sscanf(line, "$GPXXX,%8X,%8X,", &seq, &micros) == 2;
+  }
+  unsigned b[8];
+  if (sscanf(line, "00:00:00.000 R 09F80102 %X %X %X %X %X %X %X %X", &b[0],
+             &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7]) != 8) {
+    return false;
+  }
+  seq = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+  micros = (b[4] << 24) | (b[5] << 16) | (b[6] << 8) | b[7];
+  return true;
+}
+
+/// Receiving end of one test connection.
+struct TestClient {
+  int fd = -1;
+  bool slow = false;
+  bool connected = false;
+  bool disconnected = false;  //< closed by the server
+  bool synced = false;        //< a complete line has been received
+  uint32_t next_seq = 0;
+  uint64_t lines = 0;
+  uint64_t gaps = 0;
+  uint64_t malformed = 0;
+  uint64_t bytes = 0;
+  double read_budget = 0;
+  std::vector<uint32_t> latencies_us;
+  std::vector<char> pending;
+
+  void receive(const Options& options, const char* data, size_t length) {
+    bytes += length;
+    pending.insert(pending.end(), data, data + length);
+    size_t start = 0;
+    while (true) {
+      auto newline = std::find(pending.begin() + start, pending.end(), '\n');
+      if (newline == pending.end()) {
+        break;
+      }
+      *newline = '\0';
+      handle_line(options, &pending[start]);
+      start = newline - pending.begin() + 1;
+    }
+    pending.erase(pending.begin(), pending.begin() + start);
+  }
+
+  void handle_line(const Options& options, const char* line) {
+    uint32_t seq, micros;
+    if (!ParseLine(options.nmea0183, line, seq, micros)) {
+      malformed++;
+      return;
+    }
+    latencies_us.push_back((uint32_t)NowMicros() - micros);
+    if (synced && seq > next_seq) {
+      gaps += seq - next_seq;
+    }
+    synced = true;
+    next_seq = seq + 1;
+    lines++;
+  }
+};
+
+struct Percentiles {
+  double p50_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+};
+
+static Percentiles GetPercentiles(std::vector<uint32_t>& samples) {
+  Percentiles p;
+  if (samples.empty()) {
+    return p;
+  }
+  std::sort(samples.begin(), samples.end());
+  p.p50_ms = samples[samples.size() / 2] / 1000.0;
+  p.p99_ms = samples[samples.size() * 99 / 100] / 1000.0;
+  p.max_ms = samples.back() / 1000.0;
+  return p;
+}
+
+static int Connect(bool slow) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (slow) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kSlowClientRcvBuf,
+               sizeof(kSlowClientRcvBuf));
+  }
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(kPort);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Receive on all test connections until told to stop. Fast clients are
+ * read as soon as data arrives, slow clients every 10 ms within their byte
+ * budget.
+ */
+static void RunClients(const Options& options, std::vector<TestClient>& clients,
+                       std::atomic<bool>& stop) {
+  int epoll_fd = epoll_create1(0);
+  for (auto& client : clients) {
+    if (client.connected && !client.slow) {
+      struct epoll_event event = {};
+      event.events = EPOLLIN;
+      event.data.ptr = &client;
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &event);
+    }
+  }
+  char buf[65536];
+  int64_t last_slow_read = NowMicros();
+  while (!stop) {
+    struct epoll_event events[64];
+    int num_events = epoll_wait(epoll_fd, events, 64, 10);
+    for (int i = 0; i < num_events; i++) {
+      auto client = static_cast<TestClient*>(events[i].data.ptr);
+      int received = recv(client->fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (received > 0) {
+        client->receive(options, buf, received);
+      } else if (received == 0) {
+        client->disconnected = true;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+      }
+    }
+
+    int64_t now = NowMicros();
+    if (now - last_slow_read < 10000) {
+      continue;
+    }
+    double elapsed = (now - last_slow_read) / 1e6;
+    last_slow_read = now;
+    for (auto& client : clients) {
+      if (!client.connected || !client.slow || client.disconnected) {
+        continue;
+      }
+      client.read_budget += elapsed * options.slow_bps;
+      size_t length = std::min(sizeof(buf), (size_t)client.read_budget);
+      if (length == 0) {
+        continue;
+      }
+      int received = recv(client.fd, buf, length, MSG_DONTWAIT);
+      if (received > 0) {
+        client.read_budget -= received;
+        client.receive(options, buf, received);
+      } else if (received == 0) {
+        client.disconnected = true;
+      } else {
+        // nothing to read; don't accumulate budget while idle
+        client.read_budget = std::min(client.read_budget, 4096.0);
+      }
+    }
+  }
+  close(epoll_fd);
+}
+
+/// Shrink the send buffer of the server side sockets of the test port.
+static void SetServerSendBuffers(int size) {
+  for (int fd = 0; fd < 1024; fd++) {
+    struct sockaddr_in local = {}, peer = {};
+    socklen_t local_len = sizeof(local), peer_len = sizeof(peer);
+    if (getsockname(fd, (struct sockaddr*)&local, &local_len) == 0 &&
+        getpeername(fd, (struct sockaddr*)&peer, &peer_len) == 0 &&
+        local.sin_family == AF_INET && ntohs(local.sin_port) == kPort) {
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    }
+  }
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (strcmp(arg, "--clients") == 0) {
+      options.clients = atoi(value);
+    } else if (strcmp(arg, "--slow") == 0) {
+      options.slow = atoi(value);
+    } else if (strcmp(arg, "--rate") == 0) {
+      options.rate = atoi(value);
+    } else if (strcmp(arg, "--seconds") == 0) {
+      options.seconds = atof(value);
+    } else if (strcmp(arg, "--format") == 0) {
+      if (strcmp(value, "nmea0183") == 0) {
+        options.nmea0183 = true;
+      } else if (strcmp(value, "ydwg") != 0) {
+        return false;
+      }
+    } else if (strcmp(arg, "--slow-bps") == 0) {
+      options.slow_bps = atoi(value);
+    } else if (strcmp(arg, "--tx-buffer") == 0) {
+      options.tx_buffer = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--flush-deadline-ms") == 0) {
+      options.flush_deadline_ms = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--slow-timeout-s") == 0) {
+      options.slow_timeout_ms = strtoul(value, NULL, 10) * 1000;
+    } else if (strcmp(arg, "--server-sndbuf") == 0) {
+      options.server_sndbuf = atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return options.clients > 0 && options.slow <= options.clients &&
+         options.rate > 0 && options.seconds > 0;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    fprintf(stderr, "Invalid arguments; see the top of %s\n", __FILE__);
+    return 1;
+  }
+
+  ReactESP app;
+  NetworkLoop loop;
+  Networking networking;
+  StreamingTCPServer server(kPort, &networking, &loop);
+  server.set_name("bench");
+  server.set_tx_buffer(options.tx_buffer, TXOverflowPolicy::kDropOldest);
+  server.set_coalescing(kDefaultTCPFlushThreshold, options.flush_deadline_ms);
+  server.set_slow_client_policy(kDefaultSlowClientQueuePercent,
+                                options.slow_timeout_ms);
+  auto bridge = new TaskBridge<OriginString>(kCrossTaskQueueSize, &loop);
+  bridge->connect_to(&server);
+  Startable::start_all();
+  app.tick();
+
+  std::atomic<bool> stop_server{false};
+  std::atomic<double> server_cpu{0};
+  std::thread server_thread([&]() {
+    double cpu_start = ThreadCPUSeconds();
+    while (!stop_server) {
+      loop.run_once();
+    }
+    server_cpu = ThreadCPUSeconds() - cpu_start;
+  });
+  usleep(100000);
+
+  std::vector<TestClient> clients(options.clients);
+  int num_connected = 0;
+  for (int i = 0; i < options.clients; i++) {
+    // the slow clients connect last, so that a refusal hits them first
+    clients[i].slow = i >= options.clients - options.slow;
+    clients[i].fd = Connect(clients[i].slow);
+    clients[i].connected = clients[i].fd >= 0;
+    num_connected += clients[i].connected;
+    usleep(5000);
+  }
+  usleep(100000);
+  if (options.server_sndbuf > 0) {
+    SetServerSendBuffers(options.server_sndbuf);
+  }
+
+  std::atomic<bool> stop_clients{false};
+  std::thread client_thread(
+      [&]() { RunClients(options, clients, stop_clients); });
+
+  int64_t start = NowMicros();
+  double interval_us = 1e6 / options.rate;
+  uint32_t num_lines = options.rate * options.seconds;
+  for (uint32_t seq = 0; seq < num_lines; seq++) {
+    int64_t due = start + (int64_t)(seq * interval_us);
+    int64_t wait = due - NowMicros();
+    if (wait > 0) {
+      usleep(wait);
+    }
+    bridge->set_input(
+        OriginString{0, FormatLine(options.nmea0183, seq, NowMicros()),
+                     0x09F80102});
+  }
+  double feed_seconds = (NowMicros() - start) / 1e6;
+  usleep(kDrainSeconds * 1e6);
+
+  stop_clients = true;
+  client_thread.join();
+  String summary = server.get_stats_summary();
+  uint32_t refused = server.get_refused_count();
+  uint32_t evicted = server.get_evicted_count();
+  uint32_t slow_evicted = server.get_slow_evicted_count();
+  stop_server = true;
+  loop.wake();
+  server_thread.join();
+
+  printf("%d clients (%d slow, %d connected), %d lines/s of %s for %.1f s\n",
+         options.clients, options.slow, num_connected, options.rate,
+         options.nmea0183 ? "NMEA 0183" : "YDWG RAW", feed_seconds);
+  printf("server CPU %.1f %%, lines dropped between threads %u, refused %u, "
+         "evicted idle %u, evicted slow %u\n\n",
+         100.0 * server_cpu / (feed_seconds + kDrainSeconds),
+         bridge->get_drop_count(), refused, evicted, slow_evicted);
+
+  printf("%-6s %5s %10s %9s %9s %9s %9s %9s %9s %7s\n", "", "count",
+         "lines", "gaps", "unsent", "malformed", "p50 ms", "p99 ms", "max ms",
+         "closed");
+  for (int slow = 0; slow < 2; slow++) {
+    std::vector<uint32_t> latencies;
+    uint64_t lines = 0, gaps = 0, unsent = 0, malformed = 0;
+    int count = 0, closed = 0;
+    for (auto& client : clients) {
+      if (!client.connected || client.slow != (bool)slow) {
+        continue;
+      }
+      count++;
+      closed += client.disconnected;
+      lines += client.lines;
+      gaps += client.gaps;
+      if (!client.disconnected) {
+        unsent += num_lines - client.next_seq;
+      }
+      malformed += client.malformed;
+      latencies.insert(latencies.end(), client.latencies_us.begin(),
+                       client.latencies_us.end());
+    }
+    if (count == 0) {
+      continue;
+    }
+    Percentiles p = GetPercentiles(latencies);
+    uint64_t total = std::max<uint64_t>(lines + gaps + unsent, 1);
+    printf("%-6s %5d %10llu %8.2f%% %8.2f%% %9llu %9.2f %9.2f %9.2f %7d\n",
+           slow ? "slow" : "fast", count, (unsigned long long)lines,
+           100.0 * gaps / total, 100.0 * unsent / total,
+           (unsigned long long)malformed, p.p50_ms, p.p99_ms, p.max_ms,
+           closed);
+  }
+  printf("\nserver: %s\n", summary.c_str());
+
+  for (auto& client : clients) {
+    if (client.connected) {
+      close(client.fd);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file tcp_rx_bench.cpp
+ * @brief Host benchmark of the TCP client receive path, comparing the
+ * original byte-at-a-time line reader with the bulk read and memchr based
+ * BufferedTCPClient::read_line().
+ *
+ * Build and run on Linux:
+ *
+ *   g++ -O2 -std=gnu++11 -DSH_WG -DSH_WG_LINUX -Isrc/linux/include -Isrc \
+ *     bench/tcp_rx_bench.cpp src/linux/arduino.cpp src/linux/wifi.cpp \
+ *     -pthread -o tcp_rx_bench
+ *   ./tcp_rx_bench
+ *
+ * A sender thread keeps a loopback connection full of YDWG RAW lines, and
+ * the receiver polls the client the way StreamingTCPServer does. Each
+ * WiFiClient call is a system call on Linux, just as it is a trip through
+ * the socket layer on the ESP32, so the ratio carries over even though
+ * the absolute numbers do not.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "buffered_tcp_client.h"
+
+constexpr double kRunSeconds = 2.0;
+static const char kLine[] =
+    "12:34:56.789 R 09F80115 A0 7D E6 18 52 00 FF FF\r\n";
+
+/// The original line reader, for comparison.
+class ByteReader {
+ public:
+  ByteReader(WiFiClientPtr client) : client_{client} {}
+
+  int read_line(String& line) {
+    while (client_->available()) {
+      char c = client_->read();
+      rx_buf_[rx_pos_++] = c;
+      if (rx_pos_ == kRXBufferSize - 1) {
+        rx_pos_ = 0;
+      } else if (c == '\n') {
+        rx_buf_[rx_pos_] = '\0';
+        int received = rx_pos_;
+        rx_pos_ = 0;
+        line = rx_buf_;
+        return received;
+      }
+    }
+    return 0;
+  }
+
+ protected:
+  WiFiClientPtr client_;
+  char rx_buf_[kRXBufferSize];
+  int rx_pos_ = 0;
+};
+
+static void Connect(int& reader_fd, int& writer_fd) {
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr));
+  socklen_t addr_len = sizeof(addr);
+  getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len);
+  listen(listen_fd, 1);
+  writer_fd = socket(AF_INET, SOCK_STREAM, 0);
+  connect(writer_fd, (struct sockaddr*)&addr, sizeof(addr));
+  reader_fd = accept(listen_fd, NULL, NULL);
+  close(listen_fd);
+}
+
+template <typename Reader>
+static double Run(const char* name) {
+  int reader_fd, writer_fd;
+  Connect(reader_fd, writer_fd);
+
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    char buf[64 * (sizeof(kLine) - 1)];
+    for (size_t i = 0; i < sizeof(buf); i += sizeof(kLine) - 1) {
+      memcpy(buf + i, kLine, sizeof(kLine) - 1);
+    }
+    while (!done) {
+      if (send(writer_fd, buf, sizeof(buf), MSG_NOSIGNAL) < 0) {
+        break;
+      }
+    }
+  });
+
+  WiFiClientPtr client(new WiFiClient(reader_fd));
+  Reader reader(client);
+  String line;
+  uint64_t bytes = 0;
+  uint64_t lines = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  while (elapsed < kRunSeconds) {
+    // one poll of the server loop; bounded since the sender never pauses
+    int received;
+    for (int i = 0; i < 100 && (received = reader.read_line(line)) > 0; i++) {
+      bytes += received;
+      lines++;
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+  }
+  done = true;
+  client->stop();
+  writer.join();
+  close(writer_fd);
+
+  double rate = bytes / elapsed;
+  printf("%-22s %10.1f MB/s %12.0f lines/s\n", name, rate / 1e6,
+         lines / elapsed);
+  return rate;
+}
+
+int main() {
+  double before = Run<ByteReader>("byte-at-a-time");
+  double after = Run<BufferedTCPClient>("bulk read + memchr");
+  printf("speedup %.1fx\n", after / before);
+  return 0;
+}
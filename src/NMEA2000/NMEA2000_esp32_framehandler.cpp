@@ -16,6 +16,7 @@
 bool tNMEA2000_esp32_FH::CANGetFrame(unsigned long &id, unsigned char &len,
                                      unsigned char *buf) {
   bool hasFrame = false;
+  UpdateRxQueueStats();
   hasFrame = tNMEA2000_esp32::CANGetFrame(id, len, buf);
 
   RunCANFrameHandlers(hasFrame, id, len, buf);
@@ -23,6 +24,28 @@ bool tNMEA2000_esp32_FH::CANGetFrame(unsigned long &id, unsigned char &len,
   return hasFrame;
 }
 
+/**
+ * @brief Sample the driver RX queue depth before it is drained.
+ *
+ * The queue is filled by the CAN interrupt handler, which silently discards
+ * frames if the queue is full. A full queue is counted once per continuous
+ * full period to avoid counting every poll of the same overflow.
+ */
+void tNMEA2000_esp32_FH::UpdateRxQueueStats() {
+  if (RxQueue == NULL) {
+    return;
+  }
+  uint32_t depth = uxQueueMessagesWaiting(RxQueue);
+  if (depth > rx_queue_high_water_) {
+    rx_queue_high_water_ = depth;
+  }
+  bool full = uxQueueSpacesAvailable(RxQueue) == 0;
+  if (full && !rx_queue_full_) {
+    rx_queue_overflows_++;
+  }
+  rx_queue_full_ = full;
+}
+
 /**
  * @brief Run the frame handlers, possibly modifying the CAN frame.
  *
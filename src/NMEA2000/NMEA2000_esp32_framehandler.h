@@ -25,6 +25,14 @@ class tNMEA2000_esp32_FH : public tNMEA2000_esp32 {
     return tNMEA2000_esp32::CANSendFrame(id, len, buf, wait_sent);
   }
 
+  /// Number of frames the driver RX queue can hold.
+  uint16_t GetRxQueueSize() { return MaxCANReceiveFrames; }
+  /// Highest RX queue depth observed since startup.
+  uint32_t GetRxQueueHighWater() { return rx_queue_high_water_; }
+  /// Number of polls that found the RX queue full. Incoming frames are
+  /// dropped by the driver interrupt handler while the queue is full.
+  uint32_t GetRxQueueOverflows() { return rx_queue_overflows_; }
+
  protected:
   bool CANGetFrame(unsigned long& id, unsigned char& len, unsigned char* buf);
 
@@ -32,6 +40,12 @@ class tNMEA2000_esp32_FH : public tNMEA2000_esp32 {
                           unsigned char& len, unsigned char* buf);
   void RunCANFrameHandlers(bool& hasFrame, unsigned long& canId,
                            unsigned char& len, unsigned char* buf);
+
+  void UpdateRxQueueStats();
+
+  uint32_t rx_queue_high_water_ = 0;
+  uint32_t rx_queue_overflows_ = 0;
+  bool rx_queue_full_ = false;
 };
 
 #endif  // SH_WG_FIRMWARE_NMEA2000_NMEA2000_ESP32_FRAMEHANDLER_H_
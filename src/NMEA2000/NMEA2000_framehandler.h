@@ -0,0 +1,14 @@
+#ifndef SH_WG_FIRMWARE_NMEA2000_NMEA2000_FRAMEHANDLER_H_
+#define SH_WG_FIRMWARE_NMEA2000_NMEA2000_FRAMEHANDLER_H_
+
+// Select the frame handler capable NMEA 2000 backend for the target platform.
+
+#ifdef SH_WG_LINUX
+#include "NMEA2000_socketcan_framehandler.h"
+typedef tNMEA2000_SocketCAN_FH tNMEA2000_FH;
+#else
+#include "NMEA2000_esp32_framehandler.h"
+typedef tNMEA2000_esp32_FH tNMEA2000_FH;
+#endif
+
+#endif  // SH_WG_FIRMWARE_NMEA2000_NMEA2000_FRAMEHANDLER_H_
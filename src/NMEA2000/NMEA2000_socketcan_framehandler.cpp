@@ -0,0 +1,167 @@
+#ifdef SH_WG_LINUX
+
+#include "NMEA2000_socketcan_framehandler.h"
+
+#include <fcntl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+tNMEA2000_SocketCAN_FH::tNMEA2000_SocketCAN_FH(const char* interface_name)
+    : tNMEA2000() {
+  strncpy(interface_name_, interface_name, sizeof(interface_name_) - 1);
+  interface_name_[sizeof(interface_name_) - 1] = '\0';
+}
+
+/**
+ * @brief Open a raw CAN socket bound to the configured interface.
+ *
+ * The socket is non-blocking so that CANGetFrame can be polled from the
+ * event loop.
+ */
+bool tNMEA2000_SocketCAN_FH::CANOpen() {
+  socket_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (socket_ < 0) {
+    perror("CAN socket");
+    return false;
+  }
+
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, interface_name_, IFNAMSIZ - 1);
+  if (ioctl(socket_, SIOCGIFINDEX, &ifr) < 0) {
+    fprintf(stderr, "CAN interface %s not found\n", interface_name_);
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  // report frames dropped due to a full receive queue
+  int enable = 1;
+  setsockopt(socket_, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+
+  struct sockaddr_can addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("CAN bind");
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL, 0) | O_NONBLOCK);
+
+  return true;
+}
+
+bool tNMEA2000_SocketCAN_FH::CANSendFrame(unsigned long id, unsigned char len,
+                                          const unsigned char* buf,
+                                          bool /*wait_sent*/) {
+  if (socket_ < 0 || len > CAN_MAX_DLEN) {
+    return false;
+  }
+  struct can_frame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+  frame.can_dlc = len;
+  memcpy(frame.data, buf, len);
+  return write(socket_, &frame, sizeof(frame)) == sizeof(frame);
+}
+
+/**
+ * @brief Get a CAN frame from the socket and pass it to the frame handler.
+ *
+ * Standard ID, remote and error frames are not NMEA 2000 traffic. They are
+ * skipped, so that the caller, which stops at the first call without a
+ * frame, does not take one for an empty queue.
+ *
+ * @param id
+ * @param len
+ * @param buf
+ * @return true A frame is available for further processing
+ * @return false No frame was acquired
+ */
+bool tNMEA2000_SocketCAN_FH::CANGetFrame(unsigned long& id,
+                                         unsigned char& len,
+                                         unsigned char* buf) {
+  bool hasFrame = false;
+
+  while (socket_ >= 0 && !hasFrame) {
+    struct can_frame frame;
+    char control[CMSG_SPACE(sizeof(uint32_t))];
+    struct iovec iov = {&frame, sizeof(frame)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received = recvmsg(socket_, &msg, 0);
+    if (received <= 0) {
+      // the queue is empty
+      rx_burst_ = 0;
+      break;
+    }
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+        memcpy(&rx_queue_overflows_, CMSG_DATA(cmsg), sizeof(uint32_t));
+      }
+    }
+    rx_burst_++;
+    if (rx_burst_ > rx_queue_high_water_) {
+      rx_queue_high_water_ = rx_burst_;
+    }
+    if (received == sizeof(frame) && (frame.can_id & CAN_EFF_FLAG) &&
+        !(frame.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))) {
+      id = frame.can_id & CAN_EFF_MASK;
+      len = frame.can_dlc;
+      memcpy(buf, frame.data, len);
+      hasFrame = true;
+    }
+  }
+
+  RunCANFrameHandlers(hasFrame, id, len, buf);
+
+  return hasFrame;
+}
+
+/**
+ * @brief Run the frame handlers, possibly modifying the CAN frame.
+ *
+ * @param hasFrame
+ * @param canId
+ * @param len
+ * @param buf
+ */
+void tNMEA2000_SocketCAN_FH::RunCANFrameHandlers(bool& hasFrame,
+                                                 unsigned long& canId,
+                                                 unsigned char& len,
+                                                 unsigned char* buf) {
+  if (CANFrameHandler != NULL) {
+    CANFrameHandler(hasFrame, canId, len, buf);
+  }
+}
+
+/**
+ * @brief Set the frame handler.
+ *
+ * @param _FrameHandler
+ */
+void tNMEA2000_SocketCAN_FH::SetCANFrameHandler(
+    void (*_FrameHandler)(bool& hasFrame, unsigned long& canId,
+                          unsigned char& len, unsigned char* buf)) {
+  CANFrameHandler = _FrameHandler;
+}
+
+#endif  // SH_WG_LINUX
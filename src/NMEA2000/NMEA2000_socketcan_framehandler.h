@@ -0,0 +1,55 @@
+#ifndef SH_WG_FIRMWARE_NMEA2000_NMEA2000_SOCKETCAN_FRAMEHANDLER_H_
+#define SH_WG_FIRMWARE_NMEA2000_NMEA2000_SOCKETCAN_FRAMEHANDLER_H_
+
+#include <NMEA2000.h>
+
+#include <cstdint>
+
+/**
+ * @brief Linux SocketCAN NMEA 2000 backend with frame handler callback
+ * support.
+ *
+ * Provides the same frame interface as tNMEA2000_esp32_FH, so that the
+ * gateway pipeline can run against a physical or a virtual (vcan) CAN
+ * interface on a Linux host.
+ */
+class tNMEA2000_SocketCAN_FH : public tNMEA2000 {
+ public:
+  tNMEA2000_SocketCAN_FH(const char* interface_name = "can0");
+
+  void SetCANFrameHandler(void (*_FrameHandler)(bool& hasFrame,
+                                                unsigned long& canId,
+                                                unsigned char& len,
+                                                unsigned char* buf));
+
+  bool CANSendFrame(unsigned long id, unsigned char len,
+                    const unsigned char* buf, bool wait_sent = true);
+
+  /// CAN socket file descriptor, or -1 if the bus is not open.
+  int GetSocket() { return socket_; }
+
+  uint16_t GetRxQueueSize() { return MaxCANReceiveFrames; }
+  /// Largest number of frames drained from the socket in one burst.
+  uint32_t GetRxQueueHighWater() { return rx_queue_high_water_; }
+  /// Number of frames dropped by the kernel because the socket receive
+  /// queue was full.
+  uint32_t GetRxQueueOverflows() { return rx_queue_overflows_; }
+
+ protected:
+  bool CANOpen();
+  bool CANGetFrame(unsigned long& id, unsigned char& len, unsigned char* buf);
+
+  void (*CANFrameHandler)(bool& hasFrame, unsigned long& canId,
+                          unsigned char& len, unsigned char* buf) = nullptr;
+  void RunCANFrameHandlers(bool& hasFrame, unsigned long& canId,
+                           unsigned char& len, unsigned char* buf);
+
+  char interface_name_[16];
+  int socket_ = -1;
+
+  uint32_t rx_burst_ = 0;
+  uint32_t rx_queue_high_water_ = 0;
+  uint32_t rx_queue_overflows_ = 0;
+};
+
+#endif  // SH_WG_FIRMWARE_NMEA2000_NMEA2000_SOCKETCAN_FRAMEHANDLER_H_
@@ -3,6 +3,18 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <errno.h>
+
+#ifdef SH_WG_LINUX
+#include <netinet/in.h>
+#include <sys/socket.h>
+#else
+#include <lwip/sockets.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 #include "origin_string.h"
 #include "shwg.h"
@@ -12,44 +24,451 @@ using namespace sensesp;
 using WiFiClientPtr = std::shared_ptr<WiFiClient>;
 
 constexpr size_t kRXBufferSize = 512;
+// Payload of a full TCP segment on a WiFi link
+constexpr size_t kTCPSegmentSize = 1436;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/**
+ * @brief What to do when a client's TX buffer cannot fit a new string.
+ */
+enum class TXOverflowPolicy {
+  kDropOldest,  ///< Discard the oldest queued lines to make room
+  kDropNewest,  ///< Discard the new string
+  kDisconnect,  ///< Close the connection
+};
+
+inline TXOverflowPolicy TXOverflowPolicyFromString(const String& policy) {
+  if (policy == "Drop newest") {
+    return TXOverflowPolicy::kDropNewest;
+  } else if (policy == "Disconnect") {
+    return TXOverflowPolicy::kDisconnect;
+  }
+  return TXOverflowPolicy::kDropOldest;
+}
+
+/**
+ * @brief Send data without blocking.
+ *
+ * @return Number of bytes sent, 0 if the socket buffer is full, or -1 if
+ * the connection has failed.
+ */
+inline int SendNonBlocking(WiFiClient& client, const char* buf, size_t size) {
+  int fd = client.fd();
+  if (fd < 0) {
+    return -1;
+  }
+  int sent = send(fd, buf, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (sent < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  return sent;
+}
 
 /**
- * @brief TCP client connection container with RX buffer.
+ * @brief TCP client connection container with RX buffer and TX ring.
+ *
+ * Outgoing strings are queued in a fixed-size ring buffer and written to the
+ * socket only as fast as it accepts them without blocking. A string that
+ * does not fit in the ring is handled according to the overflow policy.
+ *
+ * Queued data is written once a full segment's worth has accumulated or
+ * the oldest queued byte has waited for the flush deadline, so that many
+ * short lines share one TCP segment.
+ *
+ * A container can be reused for consecutive connections with attach() and
+ * detach(). The TX ring is allocated on the first attach() and kept for the
+ * lifetime of the container.
+ *
+ * Traffic statistics are kept per connection and reset by attach().
  */
 class BufferedTCPClient {
  public:
-  BufferedTCPClient(WiFiClientPtr client) : client_{client} {}
+  BufferedTCPClient(
+      WiFiClientPtr client = WiFiClientPtr(new WiFiClient()),
+      size_t tx_buffer_size = 0,
+      TXOverflowPolicy overflow_policy = TXOverflowPolicy::kDropOldest)
+      : client_{client},
+        tx_buf_(tx_buffer_size),
+        tx_buffer_size_{tx_buffer_size},
+        overflow_policy_{overflow_policy} {}
 
   WiFiClientPtr client_;
 
+  /**
+   * @brief Set the TX ring size and overflow policy for the next attach().
+   */
+  void set_tx_buffer(size_t size, TXOverflowPolicy overflow_policy) {
+    tx_buffer_size_ = size;
+    overflow_policy_ = overflow_policy;
+  }
+
+  /**
+   * @brief Set the write coalescing parameters.
+   *
+   * @param flush_threshold Write as soon as this many bytes are queued
+   * @param flush_deadline_ms Maximum time data waits for more to arrive
+   */
+  void set_coalescing(size_t flush_threshold, unsigned long flush_deadline_ms) {
+    flush_threshold_ = flush_threshold;
+    flush_deadline_ms_ = flush_deadline_ms;
+  }
+
+  /**
+   * @brief Set the TX queue fill level, in percent of the ring size, above
+   * which the client is considered slow. The client stays slow until its
+   * queue has been sent completely, so that the bursty partial drains of a
+   * backed up connection don't restart the slow period. Takes effect on the
+   * next attach().
+   */
+  void set_slow_queue_percent(unsigned int percent) {
+    slow_queue_percent_ = percent;
+  }
+
+  /// Take over a newly accepted connection.
+  void attach(const WiFiClient& client) {
+    *client_ = client;
+    // segments are formed by the flush deadline, not by Nagle's algorithm
+    client_->setNoDelay(true);
+    if (tx_buf_.size() != tx_buffer_size_) {
+      tx_buf_.resize(tx_buffer_size_);
+      tx_buf_.shrink_to_fit();
+    }
+    clear_buf();
+    tx_tail_ = 0;
+    tx_len_ = 0;
+    tx_partial_line_ = false;
+    tx_high_water_ = 0;
+    tx_drops_ = 0;
+    tx_writes_ = 0;
+    tx_stalls_ = 0;
+    tx_bytes_ = 0;
+    tx_lines_ = 0;
+    rx_bytes_ = 0;
+    rx_lines_ = 0;
+    slow_queue_threshold_ = tx_buffer_size_ * slow_queue_percent_ / 100;
+    slow_since_ = 0;
+    slow_ = false;
+    set_remote_address();
+    connected_at_ = millis();
+    last_activity_ = connected_at_;
+    in_use_ = true;
+  }
+
+  /// Close the connection and mark the container free.
+  void detach() {
+    client_->stop();
+    in_use_ = false;
+  }
+
+  bool is_in_use() const { return in_use_; }
+
+  /// Time since data was last received from or sent to the client.
+  unsigned long get_idle_ms() const { return millis() - last_activity_; }
+
+  /// Time since the connection was accepted.
+  unsigned long get_age_ms() const { return millis() - connected_at_; }
+
+  /**
+   * @brief Time the client has continuously been slow, or 0 if it
+   * currently is not.
+   */
+  unsigned long get_slow_ms() const {
+    return slow_ ? millis() - slow_since_ : 0;
+  }
+
+  /// Remote IP address and port of the connection.
+  const char* get_remote_address() const { return remote_address_; }
+
   int available() { return client_->available(); }
 
+  /// Socket file descriptor, or -1 if not connected.
+  int fd() const { return client_->fd(); }
+
   void clear_buf() {
-    rx_pos_ = 0;
+    rx_start_ = 0;
+    rx_scan_ = 0;
+    rx_end_ = 0;
   }
 
+  /**
+   * @brief Get the next complete line received from the client.
+   *
+   * Everything available on the socket is read into the RX buffer at once,
+   * and the buffered lines are then returned one by one without further
+   * socket calls.
+   *
+   * @return Length of the line including the line ending, or 0 if no
+   * complete line is available.
+   */
   int read_line(String& line) {
-    while (client_->available()) {
-      char c = client_->read();
-      rx_buf_[rx_pos_++] = c;
-      if (rx_pos_ == kRXBufferSize - 1) {
-        debugW("RX buffer overflow");
-        rx_pos_ = 0;
-      } else if (c == '\n') {
+    while (true) {
+      char* newline = static_cast<char*>(
+          memchr(rx_buf_ + rx_scan_, '\n', rx_end_ - rx_scan_));
+      if (newline != nullptr) {
         // received a full line
-        rx_buf_[rx_pos_] = '\0';
-        int received = rx_pos_;
-        rx_pos_ = 0;
-        line = rx_buf_;
+        char* start = rx_buf_ + rx_start_;
+        int received = newline + 1 - start;
+        char next = newline[1];
+        newline[1] = '\0';
+        line = start;
+        newline[1] = next;
+        rx_lines_++;
+        rx_start_ += received;
+        rx_scan_ = rx_start_;
+        if (rx_start_ == rx_end_) {
+          clear_buf();
+        }
         return received;
       }
+      rx_scan_ = rx_end_;
+
+      if (rx_end_ == kRXBufferSize) {
+        if (rx_start_ > 0) {
+          // make room by moving the incomplete line to the start
+          memmove(rx_buf_, rx_buf_ + rx_start_, rx_end_ - rx_start_);
+          rx_end_ -= rx_start_;
+          rx_scan_ = rx_end_;
+          rx_start_ = 0;
+        } else {
+          debugW("RX buffer overflow");
+          clear_buf();
+        }
+      }
+
+      if (!client_->available()) {
+        return 0;
+      }
+      int received =
+          client_->read(reinterpret_cast<uint8_t*>(rx_buf_ + rx_end_),
+                        kRXBufferSize - rx_end_);
+      if (received <= 0) {
+        return 0;
+      }
+      rx_end_ += received;
+      rx_bytes_ += received;
+      last_activity_ = millis();
+    }
+  }
+
+  /**
+   * @brief Queue a string for transmission.
+   *
+   * @return false if the string did not fit and the overflow policy requires
+   * the client to be disconnected.
+   */
+  bool queue_tx(const String& data) {
+    size_t length = data.length();
+    if (length == 0) {
+      return true;
+    }
+    if (length > tx_buf_.size() - tx_len_) {
+      if (overflow_policy_ == TXOverflowPolicy::kDisconnect) {
+        tx_drops_++;
+        return false;
+      }
+      if (overflow_policy_ == TXOverflowPolicy::kDropNewest ||
+          !drop_oldest(length)) {
+        tx_drops_++;
+        return true;
+      }
+    }
+
+    if (tx_len_ == 0) {
+      tx_pending_since_ = millis();
     }
-    return 0;
+    size_t head = (tx_tail_ + tx_len_) % tx_buf_.size();
+    const char* src = data.c_str();
+    size_t first = std::min(length, tx_buf_.size() - head);
+    memcpy(&tx_buf_[head], src, first);
+    memcpy(&tx_buf_[0], src + first, length - first);
+    tx_len_ += length;
+    tx_lines_++;
+    if (tx_len_ > tx_high_water_) {
+      tx_high_water_ = tx_len_;
+    }
+    update_slow_state();
+    return true;
+  }
+
+  /// millis() by which the queued data is due to be written.
+  unsigned long get_flush_deadline() const {
+    return tx_pending_since_ + flush_deadline_ms_;
+  }
+
+  /// Return true if the queued data should be written now.
+  bool is_flush_due() const {
+    return tx_len_ >= flush_threshold_ ||
+           (tx_len_ > 0 && millis() - tx_pending_since_ >= flush_deadline_ms_);
   }
 
+  /**
+   * @brief Write as much queued data as the socket accepts without blocking.
+   *
+   * @return false if the connection has failed.
+   */
+  bool flush_tx() {
+    bool result = flush_segments();
+    update_slow_state();
+    return result;
+  }
+
+  size_t get_tx_depth() const { return tx_len_; }
+  size_t get_tx_high_water() const { return tx_high_water_; }
+  size_t get_tx_capacity() const { return tx_buf_.size(); }
+  uint32_t get_tx_drop_count() const { return tx_drops_; }
+  /// Number of socket writes, roughly the number of TCP segments sent.
+  uint32_t get_tx_write_count() const { return tx_writes_; }
+  /// Number of times the socket did not accept all data offered to it.
+  uint32_t get_tx_stall_count() const { return tx_stalls_; }
+  uint64_t get_tx_byte_count() const { return tx_bytes_; }
+  /// Number of strings queued for transmission.
+  uint32_t get_tx_line_count() const { return tx_lines_; }
+  uint64_t get_rx_byte_count() const { return rx_bytes_; }
+  uint32_t get_rx_line_count() const { return rx_lines_; }
+
  protected:
-  char rx_buf_[kRXBufferSize];
-  int rx_pos_ = 0;
+  // one extra byte for terminating a line that fills the whole buffer
+  char rx_buf_[kRXBufferSize + 1];
+  size_t rx_start_ = 0;  //< start of the first unreturned line
+  size_t rx_scan_ = 0;   //< bytes before this have no line ending
+  size_t rx_end_ = 0;    //< end of the received data
+
+  std::vector<char> tx_buf_;
+  size_t tx_tail_ = 0;  //< index of the oldest queued byte
+  size_t tx_len_ = 0;   //< number of queued bytes
+  // true if the oldest queued line has already been partially sent
+  bool tx_partial_line_ = false;
+  size_t tx_high_water_ = 0;
+  uint32_t tx_drops_ = 0;
+  uint32_t tx_writes_ = 0;
+  uint32_t tx_stalls_ = 0;
+  uint64_t tx_bytes_ = 0;
+  uint32_t tx_lines_ = 0;
+  uint64_t rx_bytes_ = 0;
+  uint32_t rx_lines_ = 0;
+  unsigned long tx_pending_since_ = 0;  //< when the oldest queued byte came
+  size_t flush_threshold_ = kTCPSegmentSize;
+  unsigned long flush_deadline_ms_ = 0;
+  size_t tx_buffer_size_;
+  TXOverflowPolicy overflow_policy_;
+
+  unsigned int slow_queue_percent_ = 0;
+  size_t slow_queue_threshold_ = 0;
+  bool slow_ = false;
+  unsigned long slow_since_ = 0;
+
+  bool in_use_ = false;
+  unsigned long connected_at_ = 0;
+  unsigned long last_activity_ = 0;
+  char remote_address_[22] = "";
+
+  void set_remote_address() {
+    struct sockaddr_in addr = {};
+    socklen_t addr_len = sizeof(addr);
+    remote_address_[0] = '\0';
+    if (getpeername(fd(), (struct sockaddr*)&addr, &addr_len) == 0) {
+      uint32_t ip = ntohl(addr.sin_addr.s_addr);
+      snprintf(remote_address_, sizeof(remote_address_), "%u.%u.%u.%u:%u",
+               (unsigned)(ip >> 24), (unsigned)(ip >> 16) & 0xFF,
+               (unsigned)(ip >> 8) & 0xFF, (unsigned)ip & 0xFF,
+               (unsigned)ntohs(addr.sin_port));
+    }
+  }
+
+  void update_slow_state() {
+    if (slow_queue_threshold_ == 0) {
+      return;
+    }
+    if (!slow_ && tx_len_ >= slow_queue_threshold_) {
+      slow_ = true;
+      slow_since_ = millis();
+    } else if (slow_ && tx_len_ == 0) {
+      slow_ = false;
+    }
+  }
+
+  bool flush_segments() {
+    char segment[kTCPSegmentSize];
+    while (tx_len_ > 0) {
+      const char* data = &tx_buf_[tx_tail_];
+      size_t chunk = std::min(tx_len_, tx_buf_.size() - tx_tail_);
+      if (chunk < tx_len_ && chunk < kTCPSegmentSize) {
+        // gather the data wrapping around the end of the ring so that it
+        // goes out in one segment instead of two
+        chunk = std::min(tx_len_, kTCPSegmentSize);
+        size_t first = tx_buf_.size() - tx_tail_;
+        memcpy(segment, data, first);
+        memcpy(segment + first, &tx_buf_[0], chunk - first);
+        data = segment;
+      }
+      int sent = SendNonBlocking(*client_, data, chunk);
+      if (sent < 0) {
+        return false;
+      }
+      if (sent == 0) {
+        tx_stalls_++;
+        return true;
+      }
+      tx_writes_++;
+      tx_bytes_ += sent;
+      last_activity_ = millis();
+      tx_partial_line_ = data[sent - 1] != '\n';
+      tx_tail_ = (tx_tail_ + sent) % tx_buf_.size();
+      tx_len_ -= sent;
+      if ((size_t)sent < chunk) {
+        // the socket buffer is full
+        tx_stalls_++;
+        return true;
+      }
+    }
+    return true;
+  }
+
+  /// Find the length of the queued line starting at the given offset.
+  size_t line_length(size_t offset) const {
+    for (size_t i = offset; i < tx_len_; i++) {
+      if (tx_buf_[(tx_tail_ + i) % tx_buf_.size()] == '\n') {
+        return i + 1 - offset;
+      }
+    }
+    return tx_len_ - offset;
+  }
+
+  /**
+   * @brief Discard the oldest complete lines until the given number of
+   * bytes fits. A partially sent line is kept so that the receiver never
+   * sees a truncated line.
+   *
+   * @return false if enough room could not be made.
+   */
+  bool drop_oldest(size_t needed) {
+    if (needed > tx_buf_.size()) {
+      return false;
+    }
+    size_t keep = tx_partial_line_ ? line_length(0) : 0;
+    size_t dropped = 0;
+    uint32_t dropped_lines = 0;
+    while (tx_buf_.size() - (tx_len_ - dropped) < needed) {
+      if (keep + dropped == tx_len_) {
+        return false;
+      }
+      dropped += line_length(keep + dropped);
+      dropped_lines++;
+    }
+    // move the remainder of the partial line up to the first kept line,
+    // copying backwards since the regions may overlap
+    for (size_t i = keep; i > 0; i--) {
+      tx_buf_[(tx_tail_ + dropped + i - 1) % tx_buf_.size()] =
+          tx_buf_[(tx_tail_ + i - 1) % tx_buf_.size()];
+    }
+    tx_tail_ = (tx_tail_ + dropped) % tx_buf_.size();
+    tx_len_ -= dropped;
+    tx_drops_ += dropped_lines;
+    return true;
+  }
 };
 
 #endif  // SH_WG_FIRMWARE_BUFFERED_TCP_CLIENT_H_
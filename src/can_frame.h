@@ -28,4 +28,24 @@ struct CANFrame {
   CANFrameOriginType origin_type;
 };
 
+/**
+ * @brief Get the NMEA 2000 PGN encoded in a 29-bit CAN identifier.
+ *
+ * For PDU1 format PGNs (PF < 240) the PS field holds the destination address
+ * and is not part of the PGN.
+ */
+inline uint32_t CANIdToPGN(uint32_t can_id) {
+  uint32_t pgn = (can_id >> 8) & 0x3FFFF;
+  if (((pgn >> 8) & 0xFF) < 240) {
+    pgn &= 0x3FF00;
+  }
+  return pgn;
+}
+
+/// Get the priority (0 is highest) encoded in a 29-bit CAN identifier.
+inline uint8_t CANIdToPriority(uint32_t can_id) { return (can_id >> 26) & 0x7; }
+
+/// Get the source address encoded in a 29-bit CAN identifier.
+inline uint8_t CANIdToSource(uint32_t can_id) { return can_id & 0xFF; }
+
 #endif  // SH_WG_FIRMWARE_CAN_FRAME_H_
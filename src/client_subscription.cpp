@@ -0,0 +1,87 @@
+#include "client_subscription.h"
+
+#include <cstdlib>
+
+// Longest list accepted in a single command
+constexpr size_t kMaxSubscriptionTokens = 64;
+
+bool ClientSubscription::apply(const String& command, String& reply) {
+  String args = command.substring(4);
+  args.trim();
+  if (args.length() == 0) {
+    reply = "$SUB ERR missing argument\r\n";
+    return false;
+  }
+  if (args.equalsIgnoreCase("ALL")) {
+    clear();
+    reply = "$SUB OK\r\n";
+    return true;
+  }
+  if (args.equalsIgnoreCase("NONE")) {
+    clear();
+    mode_ = Mode::kNone;
+    reply = "$SUB OK\r\n";
+    return true;
+  }
+
+  String pgn_list;
+  std::vector<IdMask> masks;
+  size_t num_pgns = 0;
+  const char* pos = args.c_str();
+  while (*pos != '\0') {
+    if (*pos == ' ' || *pos == ',') {
+      pos++;
+      continue;
+    }
+    if (num_pgns + masks.size() == kMaxSubscriptionTokens) {
+      reply = "$SUB ERR too many entries\r\n";
+      return false;
+    }
+    const char* start = pos;
+    while (*pos != '\0' && *pos != ' ' && *pos != ',') {
+      pos++;
+    }
+    String token = args.substring(start - args.c_str(), pos - args.c_str());
+
+    char* end;
+    int slash = token.indexOf('/');
+    if (slash >= 0) {
+      unsigned long id = strtoul(token.c_str(), &end, 16);
+      bool id_ok = end == token.c_str() + slash && slash > 0;
+      unsigned long mask = strtoul(token.c_str() + slash + 1, &end, 16);
+      if (!id_ok || *end != '\0' || end == token.c_str() + slash + 1 ||
+          id > 0x1FFFFFFF || mask > 0x1FFFFFFF) {
+        reply = "$SUB ERR invalid id/mask " + token + "\r\n";
+        return false;
+      }
+      masks.push_back(IdMask{(uint32_t)(id & mask), (uint32_t)mask});
+    } else {
+      unsigned long pgn = strtoul(token.c_str(), &end, 10);
+      if (*end != '\0' || pgn > 0x1FFFF) {
+        reply = "$SUB ERR invalid PGN " + token + "\r\n";
+        return false;
+      }
+      pgn_list += token + " ";
+      num_pgns++;
+    }
+  }
+
+  mode_ = Mode::kFilter;
+  pgns_ = PGNFilter(PGNFilterMode::kAllow, pgn_list);
+  masks_ = masks;
+  num_pgns_ = num_pgns;
+  reply = "$SUB OK\r\n";
+  return true;
+}
+
+String ClientSubscription::to_string() const {
+  switch (mode_) {
+    case Mode::kAll:
+      return "all";
+    case Mode::kNone:
+      return "none";
+    default:
+      return String(num_pgns_) + " PGNs, " + String(masks_.size()) +
+             " id/mask pairs";
+  }
+}
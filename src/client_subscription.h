@@ -0,0 +1,91 @@
+#ifndef SH_WG_FIRMWARE_CLIENT_SUBSCRIPTION_H_
+#define SH_WG_FIRMWARE_CLIENT_SUBSCRIPTION_H_
+
+#include <Arduino.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "can_frame.h"
+#include "pgn_filter.h"
+
+/**
+ * @brief Selection of the messages a single TCP client receives.
+ *
+ * A client selects its messages by sending a subscription command on its
+ * connection:
+ *
+ *   $SUB ALL                    everything (the default)
+ *   $SUB NONE                   nothing
+ *   $SUB 127250 129025,129026   only the listed PGNs
+ *   $SUB 09F80100/1FFFFF00      CAN identifiers matching an id/mask pair
+ *
+ * PGNs and hexadecimal id/mask pairs can be mixed in one command. A message
+ * is received if it matches any of them. Every command replaces the previous
+ * subscription and is answered with "$SUB OK" or "$SUB ERR <reason>".
+ * Strings not derived from a single CAN frame are always received, except
+ * with $SUB NONE.
+ */
+class ClientSubscription {
+ public:
+  /// True if the line is a subscription command.
+  static bool is_command(const String& line) { return line.startsWith("$SUB"); }
+
+  /**
+   * @brief Apply a subscription command.
+   *
+   * @param command Full command line
+   * @param reply Reply line to send to the client
+   * @return false if the command was invalid; the subscription is unchanged.
+   */
+  bool apply(const String& command, String& reply);
+
+  /// Receive everything again.
+  void clear() {
+    mode_ = Mode::kAll;
+    pgns_ = PGNFilter();
+    masks_.clear();
+    num_pgns_ = 0;
+  }
+
+  bool is_active() const { return mode_ != Mode::kAll; }
+
+  bool accepts(uint32_t can_id) const {
+    if (mode_ == Mode::kAll) {
+      return true;
+    }
+    if (mode_ == Mode::kNone) {
+      return false;
+    }
+    if (can_id == 0) {
+      return true;
+    }
+    if (pgns_.contains(CANIdToPGN(can_id))) {
+      return true;
+    }
+    for (const IdMask& id_mask : masks_) {
+      if ((can_id & id_mask.mask) == id_mask.id) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Human readable description of the subscription.
+  String to_string() const;
+
+ protected:
+  enum class Mode { kAll, kNone, kFilter };
+
+  struct IdMask {
+    uint32_t id;  //< already masked
+    uint32_t mask;
+  };
+
+  Mode mode_ = Mode::kAll;
+  PGNFilter pgns_;
+  std::vector<IdMask> masks_;
+  size_t num_pgns_ = 0;
+};
+
+#endif  // SH_WG_FIRMWARE_CLIENT_SUBSCRIPTION_H_
@@ -4,6 +4,8 @@
 
 #include <Arduino.h>
 
+#ifndef SH_WG_LINUX
+
 // Hardware GPIO pin allocations
 
 constexpr gpio_num_t kCanRxPin = GPIO_NUM_25;
@@ -20,6 +22,8 @@ constexpr int kRedPWMChannel = 0;
 constexpr int kYellowPWMChannel = 1;
 constexpr int kBluePWMChannel = 2;
 
+#endif  // SH_WG_LINUX
+
 constexpr uint16_t kDefaultNMEA0183TCPServerPort = 2222;
 constexpr uint16_t kDefaultYdwgRawTCPServerPort = 2223;
 
@@ -38,6 +42,127 @@ static constexpr int kDelayBetweenFirmwareUpdateChecksMs =
 // WiFi captive portal password
 constexpr char kWiFiCaptivePortalPassword[] = "abcdabcd";
 
+// NMEA 2000 CAN buffer sizes
+
+constexpr uint16_t kDefaultN2kCANMsgBufSize = 8;
+constexpr uint16_t kMaxN2kCANMsgBufSize = 50;
+constexpr uint16_t kDefaultN2kCANReceiveFrameBufSize = 100;
+constexpr uint16_t kMaxN2kCANReceiveFrameBufSize = 1000;
+// Size of a frame in the driver RX queue, used for the heap budget
+constexpr size_t kN2kCANFrameQueueItemSize = 16;
+// Never let the automatically sized RX queue use more than this fraction
+// of the free heap
+constexpr size_t kN2kCANRxQueueHeapDivisor = 8;
+
+// Network output queues
+
+// Task layout: CAN RX/TX and frame routing run in the Arduino loop task,
+// the network servers and clients in a network task on the other core.
+constexpr int kNetworkTaskCore = 0;
+// Capacity of the lock-free queues between the CAN and network tasks
+constexpr size_t kCrossTaskQueueSize = 200;
+// Longest time the network task sleeps waiting for events; bounds the
+// latency of its ReactESP timers
+constexpr int kNetworkLoopMaxSleepMs = 100;
+// The network task yields for a tick after being busy for this long, so
+// that the idle task can feed the watchdog
+constexpr unsigned long kNetworkLoopMaxBusyMs = 100;
+
+// Number of strings queued per network output before shedding starts
+constexpr size_t kOutputQueueSize = 100;
+// A write taking longer than this marks the output congested
+constexpr unsigned long kSlowWriteMicros = 20000;
+// How long an output is considered congested after a failed or slow write
+constexpr unsigned long kCongestionHoldMs = 100;
+
+// Default per-client TX buffer size of the TCP servers, in bytes
+constexpr size_t kDefaultTCPClientTXBufferSize = 4096;
+// Maximum number of servers each upstream TCP client output connects to
+constexpr size_t kMaxTCPClientTargets = 4;
+// Size of the upstream TCP client TX ring, bytes; one per server
+constexpr size_t kTCPClientTXRingSize = 8192;
+// Upstream TCP client timing
+constexpr unsigned long kTCPClientKeepaliveMs = 2000;
+constexpr unsigned long kTCPClientConnectTimeoutMs = 5000;
+// Reconnect delay; doubled after every failed attempt and randomized
+// between half and all of the current value
+constexpr unsigned long kTCPClientMinBackoffMs = 1000;
+constexpr unsigned long kTCPClientMaxBackoffMs = 60000;
+// How long a resolved server address is used before it is looked up again
+constexpr unsigned long kTCPClientDNSCacheTTLMs = 300000;
+// The upstream TCP client task has no periodic work, but wakes up at least
+// this often
+constexpr int kTCPClientLoopMaxSleepMs = 1000;
+// Store-and-forward backlog of the upstream TCP clients. Lines longer than
+// the maximum, which is more than any line the gateway produces, are not
+// stored.
+constexpr size_t kTCPClientBacklogMaxLineLength = 512;
+// Largest backlog sizes that can be configured, per client
+constexpr int kMaxTCPClientBacklogRAMSizeKB = 64;
+constexpr int kMaxTCPClientBacklogFileSizeKB = 1024;
+// Amount of RAM backlog moved to the backlog file in one write
+constexpr size_t kTCPClientBacklogSpillChunkSize = 4096;
+// Backlog files are kept in the SPIFFS partition mounted by SensESP
+#ifdef SH_WG_LINUX
+constexpr char kTCPClientBacklogDir[] = "/tmp";
+#else
+constexpr char kTCPClientBacklogDir[] = "/spiffs";
+#endif
+// Default backlog replay rate after reconnecting, bytes per second
+constexpr size_t kDefaultTCPClientReplayRate = 16384;
+// Largest replay rate that can be configured, kB per second
+constexpr int kMaxTCPClientReplayRateKBps = 1024;
+// Interval of the replay steps
+constexpr unsigned long kTCPClientReplayIntervalMs = 50;
+// TCP client data is written when a segment's worth is queued or the
+// oldest queued byte has waited for the deadline. 5 ms is the knee of the
+// curve measured with bench/tcp_coalescing_bench.cpp: at 1500 lines/s it
+// cuts the writes from 1338/s to 185/s, 10 ms only gets to 97/s.
+constexpr size_t kDefaultTCPFlushThreshold = 1436;
+constexpr unsigned long kDefaultTCPFlushDeadlineMs = 5;
+// How often the TCP servers log the client TX buffer statistics
+constexpr unsigned long kClientStatsLogPeriodMs = 10000;
+// Interval of the slow client check and the client statistics update
+constexpr unsigned long kClientStatsUpdatePeriodMs = 1000;
+// A TCP client whose TX queue gets this full and does not drain completely
+// within the timeout is disconnected
+constexpr unsigned int kDefaultSlowClientQueuePercent = 75;
+constexpr unsigned long kDefaultSlowClientTimeoutMs = 30000;
+
+// Largest UDP payload that fits in a single 1500 byte Ethernet or WiFi
+// frame without IP fragmentation
+constexpr size_t kUDPDatagramPayloadSize = 1472;
+// Maximum time a partially filled UDP datagram waits for more data
+constexpr unsigned long kUDPMaxBatchDelayMs = 100;
+// Organization-local scope multicast group used unless configured otherwise
+constexpr char kDefaultUDPMulticastGroup[] = "239.192.0.1";
+// Maximum number of unicast destinations of each UDP output
+constexpr size_t kMaxUDPDestinations = 8;
+// Interval between attempts to resolve a UDP destination
+constexpr unsigned long kUDPDestinationResolveRetryMs = 30000;
+// How long a resolved destination address is used before it is looked up
+// again
+constexpr unsigned long kUDPDestinationDNSCacheTTLMs = 300000;
+// Number of receive buffers of each UDP server
+constexpr size_t kUDPRXPoolSize = 8;
+static_assert(kUDPRXPoolSize <= 255, "pool buffer indices are 8 bits");
+
+// Number of pooled NMEA 2000 messages shared by the message consumers
+constexpr size_t kN2kMsgPoolSize = 32;
+static_assert(kN2kMsgPoolSize <= 255, "pool slot indices are 8 bits");
+// NMEA 0183 outputs fed from the pooled messages: TCP server, UDP and TCP
+// clients
+constexpr size_t kNumNMEA0183Outputs = 3;
+// Pooled messages kept beyond their dispatch: the last output of the N2K
+// input, of its PGN filter and of the rate limiter of each NMEA 0183 output
+constexpr size_t kN2kMsgPoolMaxRetained = 2 + kNumNMEA0183Outputs;
+// Pooled messages being dispatched at once: the received message and a
+// rate limited message released by a flush
+constexpr size_t kN2kMsgPoolMaxInFlight = 2;
+static_assert(kN2kMsgPoolSize >=
+                  kN2kMsgPoolMaxRetained + kN2kMsgPoolMaxInFlight,
+              "the N2K message pool must hold every retained message");
+
 constexpr size_t kMaxNMEA2000MessageSeasmartSize = 500;
 constexpr size_t kMaxNMEA0183MessageSize = 200;
 
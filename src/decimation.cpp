@@ -0,0 +1,97 @@
+#include "decimation.h"
+
+#include <NMEA2000.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "sensesp.h"
+
+/**
+ * @brief Parse a rate limit rule list.
+ *
+ * @param rule_list Comma separated `PGN[@SOURCE]=RATE` entries
+ */
+DecimationRules::DecimationRules(const String& rule_list) {
+  String list = rule_list;
+  unsigned int start = 0;
+  while (start < list.length()) {
+    int end = list.indexOf(',', start);
+    if (end < 0) {
+      end = list.length();
+    }
+    String entry = list.substring(start, end);
+    start = end + 1;
+    entry.trim();
+    if (entry.length() == 0) {
+      continue;
+    }
+
+    const char* pos = entry.c_str();
+    char* next;
+    unsigned long pgn = strtoul(pos, &next, 10);
+    bool valid = next != pos && pgn <= 0x1FFFF;
+    long source = -1;
+    if (valid && *next == '@') {
+      pos = next + 1;
+      source = strtol(pos, &next, 10);
+      valid = next != pos && source >= 0 && source <= 253;
+    }
+    double rate = 0;
+    if (valid && *next == '=') {
+      pos = next + 1;
+      rate = strtod(pos, &next);
+      valid = next != pos && rate > 0;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      debugW("Ignoring invalid rate limit rule: %s", entry.c_str());
+      continue;
+    }
+
+    DecimationRule rule;
+    rule.pgn = pgn;
+    rule.source = source;
+    rule.interval_ms = static_cast<uint32_t>(1000.0 / rate + 0.5);
+    if (rule.interval_ms == 0) {
+      // faster than one message per millisecond is not a limit at all
+      continue;
+    }
+    rules_.push_back(rule);
+  }
+}
+
+uint32_t DecimationRules::get_interval(uint32_t pgn, uint8_t source) const {
+  uint32_t interval = 0;
+  for (const DecimationRule& rule : rules_) {
+    if (rule.pgn != pgn) {
+      continue;
+    }
+    if (rule.source == source) {
+      return rule.interval_ms;
+    }
+    if (rule.source == -1) {
+      interval = rule.interval_ms;
+    }
+  }
+  return interval;
+}
+
+MessagePart GetMessagePart(const CANFrame& frame) {
+  MessagePart part = {0, 0, 1};
+  if (frame.len < 2 ||
+      !tNMEA2000::IsDefaultFastPacketMessage(CANIdToPGN(frame.id))) {
+    return part;
+  }
+  part.sequence = frame.buf[0] >> 5;
+  part.index = frame.buf[0] & 0x1F;
+  if (part.index == 0) {
+    // the first frame carries 6 data bytes and each following frame 7
+    uint8_t length = frame.buf[1];
+    part.frames = length <= 6 ? 1 : 1 + (length - 6 + 6) / 7;
+  } else {
+    part.frames = 0;
+  }
+  return part;
+}
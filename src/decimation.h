@@ -0,0 +1,220 @@
+#ifndef SH_WG_FIRMWARE_DECIMATION_H_
+#define SH_WG_FIRMWARE_DECIMATION_H_
+
+#include <Arduino.h>
+#include <N2kMsg.h>
+
+#include <map>
+#include <vector>
+
+#include "ReactESP.h"
+#include "can_frame.h"
+#include "n2k_msg_pool.h"
+#include "pgn_filter_transform.h"
+#include "sensesp/transforms/transform.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Rate limit for a PGN, optionally for a single source address.
+ */
+struct DecimationRule {
+  uint32_t pgn;
+  int source;            ///< Source address, or -1 for any source
+  uint32_t interval_ms;  ///< Minimum interval between forwarded messages
+};
+
+/**
+ * @brief Parsed set of per-PGN rate limits.
+ *
+ * The rule list is a comma separated list of `PGN[@SOURCE]=RATE` entries,
+ * where RATE is the maximum number of messages per second. For example,
+ * `127488=1, 127250@3=2` forwards engine rapid updates at most once per
+ * second and heading from source 3 at most twice per second.
+ */
+class DecimationRules {
+ public:
+  DecimationRules() {}
+  DecimationRules(const String& rule_list);
+
+  bool is_active() const { return !rules_.empty(); }
+
+  /**
+   * @brief Get the minimum forwarding interval for a PGN and source.
+   *
+   * A rule for the specific source takes precedence over a rule for any
+   * source. Returns 0 if the messages are not rate limited.
+   */
+  uint32_t get_interval(uint32_t pgn, uint8_t source) const;
+
+ protected:
+  std::vector<DecimationRule> rules_;
+};
+
+/**
+ * @brief Position of a value within a (possibly fast-packet) N2K message.
+ */
+struct MessagePart {
+  uint8_t sequence;  ///< Fast-packet sequence counter
+  uint8_t index;     ///< Frame index; 0 for the first frame
+  uint8_t frames;    ///< Number of frames; only known for the first frame
+};
+
+/// Assembled messages are always complete.
+inline MessagePart GetMessagePart(const tN2kMsg& msg) { return {0, 0, 1}; }
+inline MessagePart GetMessagePart(const N2kMsgRef& msg) { return {0, 0, 1}; }
+
+MessagePart GetMessagePart(const CANFrame& frame);
+
+/**
+ * @brief How DecimationTransform holds back values of type T.
+ *
+ * Pooled messages are held as copies, so that the messages held for any
+ * number of rules and sources never take slots from the shared pool.
+ */
+template <typename T>
+struct HeldValue {
+  typedef T type;
+
+  static const T& hold(const T& value) { return value; }
+  static bool release(const T& held, T& value) {
+    value = held;
+    return true;
+  }
+};
+
+template <>
+struct HeldValue<N2kMsgRef> {
+  typedef tN2kMsg type;
+
+  static const tN2kMsg& hold(const N2kMsgRef& value) { return *value; }
+  /// Put the message back into the pool; false if the pool is exhausted.
+  static bool release(const tN2kMsg& held, N2kMsgRef& value) {
+    value = n2k_msg_pool.allocate(held);
+    return (bool)value;
+  }
+};
+
+/**
+ * @brief Forward at most one message per configured interval for each
+ * PGN and source address, keeping the latest message.
+ *
+ * A message arriving before its interval has elapsed replaces the pending
+ * message, which is forwarded once the interval expires. Messages without
+ * a matching rule pass through unchanged.
+ *
+ * With CAN frame input, the frames of a fast-packet message are always
+ * forwarded or dropped together. Pooled messages are held as copies (see
+ * HeldValue), so a decimator only keeps a pool slot for its last output.
+ */
+template <typename T>
+class DecimationTransform : public Transform<T, T> {
+ public:
+  DecimationTransform(const DecimationRules& rules)
+      : Transform<T, T>(), rules_{rules} {
+    ReactESP::app->onRepeat(kFlushPeriod_, [this]() { this->flush(); });
+  }
+
+  void set_input(T new_value, uint8_t input_channel = 0) override {
+    uint32_t can_id = CANIdOf(new_value);
+    uint32_t pgn = CANIdToPGN(can_id);
+    uint8_t source = CANIdToSource(can_id);
+    uint32_t interval = can_id == 0 ? 0 : rules_.get_interval(pgn, source);
+    if (interval == 0) {
+      this->emit(new_value);
+      return;
+    }
+
+    State& state = states_[(pgn << 8) | source];
+    state.interval = interval;
+
+    MessagePart part = GetMessagePart(new_value);
+    if (part.index == 0) {
+      state.sequence = part.sequence;
+      state.frames = part.frames;
+      state.next_index = 1;
+      state.collecting.clear();
+      if (state.is_due()) {
+        // the new message supersedes any pending one
+        state.pending.clear();
+        state.forwarding = true;
+        state.mark_forwarded();
+        this->emit(new_value);
+      } else {
+        state.forwarding = false;
+        state.collecting.push_back(HeldValue<T>::hold(new_value));
+        if (state.frames == 1) {
+          state.pending.swap(state.collecting);
+          state.collecting.clear();
+        }
+      }
+      return;
+    }
+
+    // continuation frame of a fast-packet message
+    if (part.sequence != state.sequence || part.index != state.next_index) {
+      // a frame was lost; drop the rest of the message
+      state.forwarding = false;
+      state.collecting.clear();
+      state.next_index = 0;
+      return;
+    }
+    state.next_index++;
+    if (state.forwarding) {
+      this->emit(new_value);
+      return;
+    }
+    state.collecting.push_back(HeldValue<T>::hold(new_value));
+    if (state.next_index == state.frames) {
+      state.pending.swap(state.collecting);
+      state.collecting.clear();
+    }
+  }
+
+ protected:
+  typedef typename HeldValue<T>::type Held;
+
+  struct State {
+    uint32_t interval = 0;
+    uint32_t last_forwarded = 0;
+    bool forwarded_once = false;
+    bool forwarding = false;  //< frames of the current message pass through
+    uint8_t sequence = 0;
+    uint8_t frames = 0;
+    uint8_t next_index = 0;
+    std::vector<Held> collecting;  //< frames of an incomplete held message
+    std::vector<Held> pending;     //< latest complete held message
+
+    bool is_due() const {
+      return !forwarded_once || millis() - last_forwarded >= interval;
+    }
+    void mark_forwarded() {
+      last_forwarded = millis();
+      forwarded_once = true;
+    }
+  };
+
+  static const unsigned long kFlushPeriod_ = 10;  // ms
+
+  DecimationRules rules_;
+  std::map<uint32_t, State> states_;
+
+  void flush() {
+    for (auto& it : states_) {
+      State& state = it.second;
+      if (state.pending.empty() || !state.is_due()) {
+        continue;
+      }
+      for (const Held& held : state.pending) {
+        T value;
+        if (HeldValue<T>::release(held, value)) {
+          this->emit(value);
+        }
+      }
+      state.pending.clear();
+      state.mark_forwarded();
+    }
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_DECIMATION_H_
@@ -0,0 +1,107 @@
+#ifndef SH_WG_FIRMWARE_FRAME_PIPELINE_H_
+#define SH_WG_FIRMWARE_FRAME_PIPELINE_H_
+
+#include <vector>
+
+#include "pgn_filter_transform.h"
+#include "sensesp/system/observablevalue.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Building blocks for statically composed processing pipelines.
+ *
+ * A stage is any class with a `process(const T&)` member function. Stages
+ * are nested by value through template parameters, so the compiler sees
+ * the complete pipeline and can inline it into a single function per
+ * input. Values are passed on by const reference and never copied between
+ * stages.
+ *
+ * Only the Emit stage hands values over to dynamically connected
+ * ValueConsumers; use it where the routing depends on the configuration.
+ * Runtime enables are honored with Gate stages.
+ */
+namespace pipeline {
+
+/// Pass each value to two stages in order.
+template <typename First, typename Second>
+struct Tee {
+  First first;
+  Second second;
+
+  template <typename T>
+  void process(const T& value) {
+    first.process(value);
+    second.process(value);
+  }
+};
+
+/// Pass values to the next stage only while enabled. Disabled by default.
+template <typename Next>
+struct Gate {
+  bool enabled = false;
+  Next next;
+
+  template <typename T>
+  void process(const T& value) {
+    if (enabled) {
+      next.process(value);
+    }
+  }
+};
+
+/**
+ * @brief Pass values accepted by at least one of the PGN filters.
+ *
+ * The filters are only evaluated if active is set.
+ */
+template <typename Next>
+struct PGNGate {
+  bool active = false;
+  std::vector<PGNFilter> filters;
+  Next next;
+
+  template <typename T>
+  void process(const T& value) {
+    if (active) {
+      uint32_t can_id = CANIdOf(value);
+      bool accepted = false;
+      for (const PGNFilter& filter : filters) {
+        if (filter.accepts(can_id)) {
+          accepted = true;
+          break;
+        }
+      }
+      if (!accepted) {
+        return;
+      }
+    }
+    next.process(value);
+  }
+};
+
+/// Pass the result of a function object to the next stage.
+template <typename Function, typename Next>
+struct Map {
+  Function function;
+  Next next;
+
+  template <typename T>
+  void process(const T& value) {
+    next.process(function(value));
+  }
+};
+
+/**
+ * @brief Hand values over to the consumers connected to an ObservableValue.
+ */
+template <typename T>
+struct Emit {
+  ObservableValue<T>* output = nullptr;
+
+  void process(const T& value) { output->set(value); }
+};
+
+}  // namespace pipeline
+
+#endif  // SH_WG_FIRMWARE_FRAME_PIPELINE_H_
@@ -0,0 +1,672 @@
+#include "gateway.h"
+
+#include <N2kMessages.h>
+#include <sys/time.h>
+
+#include <cinttypes>
+
+#include "decimation.h"
+#include "frame_pipeline.h"
+#include "firmware_info.h"
+#include "n2k_nmea0183_transform.h"
+#include "output_queue.h"
+#include "pgn_filter_transform.h"
+#include "seasmart_transform.h"
+#include "shwg.h"
+#include "stringtokenizer_transform.h"
+#include "task_bridge.h"
+#include "udp_datagram_packer.h"
+#include "ydwg_raw_output.h"
+#include "ydwg_raw_parser.h"
+
+using namespace sensesp;
+
+// Set the information for other bus devices, which messages we support
+const unsigned long kTransmitMessages[] = {0};
+const unsigned long ReceiveMessages[] = {
+    /*126992L,*/  // System time
+    127250L,      // Heading
+    127258L,      // Magnetic variation
+    128259UL,     // Boat speed
+    128267UL,     // Depth
+    129025UL,     // Position
+    129026L,      // COG and SOG
+    129029L,      // GNSS
+    130306L,      // Wind
+    129038L,      // AIS Class A Position Report, Message Type 1
+    129039L,      // AIS Class B Position Report, Message Type 18
+    12979UL,  // AIS Class A Ship Static and Voyage related data, Message Type 5
+    129809L,  // AIS Class B "CS" Static Data Report, Part A
+    129810L,  // AIS Class B "CS" Static Data Report, Part B
+    0};
+
+tNMEA2000_FH *nmea2000;
+
+StreamingTCPServer *nmea0183_tcp_server;
+StreamingTCPServer *ydwg_raw_tcp_server;
+
+StreamingUDPServer *nmea0183_udp_server;
+StreamingUDPServer *ydwg_raw_udp_server;
+
+UDPUnicastOutput *nmea0183_udp_unicast_output = nullptr;
+UDPUnicastOutput *ydwg_raw_udp_unicast_output = nullptr;
+
+TCPClientGroup *ydwg_raw_tcp_clients;
+TCPClientGroup *nmea0183_tcp_clients;
+
+
+std::atomic<uint32_t> can_frame_rx_counter{0};
+std::atomic<uint32_t> can_frame_tx_counter{0};
+
+// Event loop of the network task
+NetworkLoop *network_loop;
+
+// Messages are delivered to the consumers as handles to pooled slots
+ObservableValue<N2kMsgRef> n2k_msg_input;
+
+// CAN frames formatted as YDWG RAW strings for the outputs without rate
+// limits
+ObservableValue<OriginString> ydwg_raw_strings;
+
+// CAN frames for the rate limited YDWG RAW outputs
+ObservableValue<CANFrame> ydwg_raw_frames;
+
+// Shedding queues in front of the network outputs
+std::vector<OutputQueue *> output_queues;
+
+// Lock-free queues between the CAN and network tasks
+std::vector<TaskBridge<OriginString> *> can_to_network_bridges;
+TaskBridge<CANFrame> *network_to_can_bridge = nullptr;
+
+/**
+ * @brief Pipeline stage sending frames received from the network to the
+ * NMEA 2000 bus.
+ */
+struct CANFrameSender {
+  void process(const CANFrame &frame) {
+    // debugD("Sending CAN Frame with ID %d and length %d", frame.id,
+    // frame.len);
+
+    if (frame.origin_id == origin_id(nmea2000)) {
+      // ignore frames that we just received
+      return;
+    }
+
+    if (frame.origin_type == CANFrameOriginType::kRemoteApp) {
+      // Ignore YDWG RAW messages with 'T' direction
+      return;
+    }
+    can_frame_tx_counter.fetch_add(1, std::memory_order_relaxed);
+    uint32_t frame_id = frame.id;
+    if (frame.origin_type == CANFrameOriginType::kApp) {
+      // Application format messages need to have their source address
+      // replaced with our own source address.
+
+      unsigned char our_source = nmea2000->GetN2kSource(0);
+      // clear existing source address
+      frame_id &= ~0xFF;
+      // set new source address
+      frame_id |= our_source;
+    }
+    nmea2000->CANSendFrame(frame_id, frame.len, frame.buf);
+  }
+};
+
+/// Format a CAN frame as a YDWG RAW string with the current time.
+struct YDWGRawFormatter {
+  OriginString operator()(const CANFrame &frame) const {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return CANFrameToYDWGRaw(frame, tv);
+  }
+};
+
+/**
+ * @brief YDWG RAW branch of the CAN frame router.
+ *
+ * Frames that none of the YDWG RAW outputs accept are dropped before they
+ * are formatted. The remaining frames are passed as is to the rate limited
+ * outputs and formatted once for all other outputs.
+ */
+using YDWGRawStage = pipeline::PGNGate<pipeline::Tee<
+    pipeline::Gate<pipeline::Emit<CANFrame>>,
+    pipeline::Gate<
+        pipeline::Map<YDWGRawFormatter, pipeline::Emit<OriginString>>>>>;
+
+/**
+ * @brief Fixed routing of all CAN frames, whether received from the bus or
+ * from the network.
+ */
+using CANFrameRouter = pipeline::Tee<CANFrameSender, YDWGRawStage>;
+
+static CANFrameRouter can_frame_router;
+
+struct CANFrameRXCounter {
+  void process(const CANFrame &frame) {
+    can_frame_rx_counter.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+struct RouteCANFrame {
+  void process(const CANFrame &frame) { can_frame_router.process(frame); }
+};
+
+/// Processing of the frames received from the NMEA 2000 bus.
+static pipeline::Tee<CANFrameRXCounter, RouteCANFrame> bus_frame_pipeline;
+
+/**
+ * @brief Set the NMEA 2000 device information and message handlers.
+ *
+ * Buffer sizes must be set and the bus opened by the caller.
+ *
+ * @param serial_number Unique device serial number
+ */
+void ConfigureNMEA2000(uint64_t serial_number) {
+  char serial_number_str[33];  // Model serial code in N2K is 32 characters
+  snprintf(serial_number_str, 32, "%" PRIu64, (long unsigned int)serial_number);
+
+  nmea2000->SetProductInformation(
+      serial_number_str,  // Manufacturer's Model serial code
+      130,                // Manufacturer's product code
+      "SH-wg",            // Manufacturer's Model ID
+      kFirmwareVersion,   // Manufacturer's Software version code
+      "1.0.0"             // Manufacturer's Model version
+  );
+  // Det device information
+  nmea2000->SetDeviceInformation(
+      serial_number,  // Unique number. Use e.g. Serial number.
+      130,            // Device function=PC Gateway. See codes on
+            // http://www.nmea.org/Assets/20120726%20nmea%202000%20class%20%26%20function%20codes%20v%202.00.pdf
+      25,  // Device class=Inter/Intranetwork Device. See codes on
+           // http://www.nmea.org/Assets/20120726%20nmea%202000%20class%20%26%20function%20codes%20v%202.00.pdf
+      2046  // Just choosen free from code list on
+            // http://www.nmea.org/Assets/20121020%20nmea%202000%20registration%20list.pdf
+  );
+
+  nmea2000->SetForwardType(
+      tNMEA2000::fwdt_Text);  // Show in clear text. Leave uncommented for
+                              // default Actisense format.
+  nmea2000->SetMode(tNMEA2000::N2km_ListenAndNode, 32);
+  // nmea2000->EnableForward(false);
+
+  nmea2000->ExtendTransmitMessages(kTransmitMessages);
+  nmea2000->ExtendReceiveMessages(ReceiveMessages);
+
+  nmea2000->SetCANFrameHandler([](bool &has_frame, unsigned long &can_id,
+                                  unsigned char &len, unsigned char *buf) {
+    struct CANFrame frame;
+    if (has_frame) {
+      frame.id = can_id;
+      frame.len = len;
+      memcpy(frame.buf, buf, len);
+      frame.origin_type = CANFrameOriginType::kLocal;
+      frame.origin_id = origin_id(nmea2000);
+      bus_frame_pipeline.process(frame);
+    }
+  });
+  nmea2000->SetMsgHandler(
+      [](const tN2kMsg &n2k_msg) {
+        N2kMsgRef msg_ref = n2k_msg_pool.allocate(n2k_msg);
+        if (msg_ref) {
+          n2k_msg_input.set(msg_ref);
+        }
+      });
+}
+
+static LambdaTransform<CANFrame, OriginString> *NewCANToYDWGRawTransform() {
+  return new LambdaTransform<CANFrame, OriginString>(
+      [](CANFrame frame) { return YDWGRawFormatter()(frame); });
+}
+
+/**
+ * @brief Return a producer emitting the output of the given producer that
+ * passes the PGN filter. If the filter is off, the producer itself is
+ * returned.
+ */
+static ValueProducer<OriginString> *FilterOutput(
+    ValueProducer<OriginString> *producer, const PGNFilter &filter) {
+  if (!filter.is_active()) {
+    return producer;
+  }
+  auto filter_transform = new PGNFilterTransform<OriginString>(filter);
+  producer->connect_to(filter_transform);
+  return filter_transform;
+}
+
+/**
+ * @brief Create a shedding queue in front of a network output.
+ *
+ * The returned consumer is fed in the CAN task. The strings are passed to
+ * the network task through a lock-free queue, and queued and shed there.
+ *
+ * @param name Output name for the statistics
+ * @param output Consumer receiving the queued strings in the network task
+ * @param ready Function returning true when the output can take more data
+ */
+static ValueConsumer<OriginString> *NewOutputQueue(
+    const String &name, ValueConsumer<OriginString> *output,
+    std::function<bool()> ready) {
+  auto queue = new OutputQueue(name, kOutputQueueSize, ready, network_loop);
+  queue->connect_to(output);
+  output_queues.push_back(queue);
+
+  auto bridge =
+      new TaskBridge<OriginString>(kCrossTaskQueueSize, network_loop);
+  bridge->connect_to(queue);
+  can_to_network_bridges.push_back(bridge);
+  return bridge;
+}
+
+/**
+ * @brief Return the YDWG RAW producer for a single output.
+ *
+ * Outputs without rate limits share ydwg_raw_strings. Rate limited
+ * outputs get their own formatter behind a decimator, so that the
+ * decimation doesn't affect the other outputs.
+ */
+static ValueProducer<OriginString> *YDWGRawOutput(
+    ValueProducer<CANFrame> *frames, const DecimationRules &rate_limits,
+    const PGNFilter &filter) {
+  ValueProducer<OriginString> *producer = &ydwg_raw_strings;
+  if (rate_limits.is_active()) {
+    auto decimator = new DecimationTransform<CANFrame>(rate_limits);
+    auto formatter = NewCANToYDWGRawTransform();
+    frames->connect_to(decimator);
+    decimator->connect_to(formatter);
+    producer = formatter;
+  }
+  return FilterOutput(producer, filter);
+}
+
+/**
+ * @brief Connect the NMEA 0183 and Seasmart transforms to a single output.
+ *
+ * Either transform may be null if the translation is disabled. Rate limited
+ * outputs get their own translators behind a decimator, which retains a
+ * pooled message; the calls are counted in kNumNMEA0183Outputs.
+ */
+static void ConnectNMEA0183Output(ValueProducer<N2kMsgRef> *n2k_msgs,
+                                  ValueProducer<OriginString> *n2k_to_0183,
+                                  ValueProducer<OriginString> *n2k_to_seasmart,
+                                  const DecimationRules &rate_limits,
+                                  const PGNFilter &filter,
+                                  ValueConsumer<OriginString> *output) {
+  static size_t num_outputs = 0;
+  if (++num_outputs > kNumNMEA0183Outputs) {
+    debugE("More NMEA 0183 outputs than kNumNMEA0183Outputs, the N2K "
+           "message pool may run out");
+  }
+  if (rate_limits.is_active()) {
+    auto decimator = new DecimationTransform<N2kMsgRef>(rate_limits);
+    n2k_msgs->connect_to(decimator);
+    if (n2k_to_0183 != nullptr) {
+      auto transform = new N2KTo0183Transform(nmea2000);
+      decimator->connect_to(transform);
+      n2k_to_0183 = transform;
+    }
+    if (n2k_to_seasmart != nullptr) {
+      auto transform = new SeasmartTransform(nmea2000);
+      decimator->connect_to(transform);
+      n2k_to_seasmart = transform;
+    }
+  }
+  if (n2k_to_0183 != nullptr) {
+    FilterOutput(n2k_to_0183, filter)->connect_to(output);
+  }
+  if (n2k_to_seasmart != nullptr) {
+    FilterOutput(n2k_to_seasmart, filter)->connect_to(output);
+  }
+}
+
+/**
+ * @brief Give each upstream TCP client of a group a store-and-forward
+ * backlog, if enabled in the configuration.
+ */
+static void SetBacklog(TCPClientGroup *clients, const GatewayConfig &config,
+                       const char *file_prefix) {
+  if (config.tcp_client_backlog_size == 0) {
+    return;
+  }
+  int index = 0;
+  for (auto client : clients->get_clients()) {
+    auto backlog = new TCPClientBacklog(
+        config.tcp_client_backlog_size, config.tcp_client_backlog_file_size,
+        String(kTCPClientBacklogDir) + "/" + file_prefix + "_" +
+            String(index++) + ".bin");
+    client->set_backlog(backlog, config.tcp_client_replay_rate);
+  }
+}
+
+void SetupConnections(const GatewayConfig &config, Networking *networking) {
+  // Everything from the output queues on, and everything receiving data
+  // from the network, runs in the network task.
+  network_loop = new NetworkLoop();
+
+  auto string_tokenizer = new StringTokenizer("\r\n");
+
+  auto n2k_to_0183_transform = new N2KTo0183Transform(nmea2000);
+  auto n2k_to_seasmart_transform = new SeasmartTransform(nmea2000);
+  auto ydwg_raw_to_can_transform = new YDWGRawToCANFrameTransform();
+
+  // Frames that none of the YDWG RAW outputs accept are dropped before they
+  // are formatted.
+  std::vector<PGNFilter> ydwg_raw_filters;
+  if (config.ydwg_raw_tcp_tx_enabled) {
+    ydwg_raw_filters.push_back(config.ydwg_raw_tcp_filter);
+  }
+  if (config.ydwg_raw_udp_tx_enabled) {
+    ydwg_raw_filters.push_back(config.ydwg_raw_udp_filter);
+  }
+  if (config.ydwg_raw_tcp_client_enabled) {
+    ydwg_raw_filters.push_back(config.ydwg_raw_tcp_client_filter);
+  }
+  YDWGRawStage &ydwg_raw_stage = can_frame_router.second;
+  ydwg_raw_stage.active = AnyPGNFilterRestricts(ydwg_raw_filters);
+  ydwg_raw_stage.filters = ydwg_raw_filters;
+
+  // Unformatted frames are only needed by rate limited outputs, and the
+  // shared formatter only by the outputs without rate limits.
+  auto &ydwg_raw_frame_output = ydwg_raw_stage.next.first;
+  auto &ydwg_raw_string_output = ydwg_raw_stage.next.second;
+  ydwg_raw_frame_output.next.output = &ydwg_raw_frames;
+  ydwg_raw_string_output.next.next.output = &ydwg_raw_strings;
+  ydwg_raw_frame_output.enabled = false;
+  ydwg_raw_string_output.enabled = false;
+  auto enable_ydwg_raw_output = [&](bool enabled,
+                                    const DecimationRules &rate_limits) {
+    if (!enabled) {
+      return;
+    }
+    if (rate_limits.is_active()) {
+      ydwg_raw_frame_output.enabled = true;
+    } else {
+      ydwg_raw_string_output.enabled = true;
+    }
+  };
+  enable_ydwg_raw_output(config.ydwg_raw_tcp_tx_enabled,
+                         config.ydwg_raw_tcp_rate_limits);
+  enable_ydwg_raw_output(config.ydwg_raw_udp_tx_enabled,
+                         config.ydwg_raw_udp_rate_limits);
+  enable_ydwg_raw_output(config.ydwg_raw_tcp_client_enabled,
+                         config.ydwg_raw_tcp_client_rate_limits);
+
+  string_tokenizer->connect_to(ydwg_raw_to_can_transform);
+
+  //////
+  // N2K message routing
+
+  // if configured, connect the N2K input to NMEA 0183 transform
+
+  // Messages that none of the NMEA 0183 outputs accept are dropped before
+  // they are translated.
+  std::vector<PGNFilter> nmea0183_filters;
+  if (config.nmea0183_tcp_enabled) {
+    nmea0183_filters.push_back(config.nmea0183_tcp_filter);
+  }
+  if (config.nmea0183_udp_enabled) {
+    nmea0183_filters.push_back(config.nmea0183_udp_filter);
+  }
+  if (config.nmea0183_tcp_client_enabled) {
+    nmea0183_filters.push_back(config.nmea0183_tcp_client_filter);
+  }
+  ValueProducer<N2kMsgRef> *n2k_msg_source = &n2k_msg_input;
+  if (AnyPGNFilterRestricts(nmea0183_filters)) {
+    debugD("Filtering N2K input by PGN");
+    auto n2k_msg_filter =
+        new PGNFilterTransform<N2kMsgRef>(nmea0183_filters);
+    n2k_msg_input.connect_to(n2k_msg_filter);
+    n2k_msg_source = n2k_msg_filter;
+  }
+
+  if (config.translate_to_nmea0183) {
+    // the message handler called within this consumer will write its output
+    // to nmea0183_msg_observable
+    debugD("Connecting N2K to NMEA 0183");
+    n2k_msg_source->connect_to(n2k_to_0183_transform);
+  }
+
+  // if configured, connect the N2K input to Seasmart transform
+
+  if (config.translate_to_seasmart) {
+    debugD("Connecting N2K to Seasmart");
+    n2k_msg_source->connect_to(n2k_to_seasmart_transform);
+  }
+
+  //////
+  // CAN frame routing
+
+  // frames received from the network join the frames from the bus
+  network_to_can_bridge =
+      new TaskBridge<CANFrame>(kCrossTaskQueueSize, ReactESP::app);
+  ydwg_raw_to_can_transform->connect_to(network_to_can_bridge);
+  network_to_can_bridge->connect_to(new LambdaConsumer<CANFrame>(
+      [](CANFrame frame) { can_frame_router.process(frame); }));
+
+  // set up the YDWG RAW TCP server
+
+  debugD("Setting up YDWG RAW TCP server");
+  ydwg_raw_tcp_server = new StreamingTCPServer(config.ydwg_raw_tcp_port,
+                                               networking, network_loop);
+  ydwg_raw_tcp_server->set_tx_buffer(config.tcp_tx_buffer_size,
+                                     config.tcp_tx_overflow_policy);
+  ydwg_raw_tcp_server->set_name("YDWG RAW TCP");
+  ydwg_raw_tcp_server->set_evict_idlest(config.tcp_evict_idlest_client);
+  ydwg_raw_tcp_server->set_slow_client_policy(
+      config.tcp_slow_client_queue_percent, config.tcp_slow_client_timeout_ms);
+  ydwg_raw_tcp_server->set_subscriptions_enabled(true);
+  ydwg_raw_tcp_server->set_coalescing(kDefaultTCPFlushThreshold,
+                                      config.tcp_flush_deadline_ms);
+  if (!config.ydwg_raw_tcp_tx_enabled && !config.ydwg_raw_tcp_rx_enabled) {
+    ydwg_raw_tcp_server->set_enabled(false);
+  }
+
+  // set up the YDWG RAW UDP server
+
+  debugD("Setting up YDWG RAW UDP server");
+  ydwg_raw_udp_server =
+      new StreamingUDPServer(config.ydwg_raw_udp_port, networking,
+                             network_loop);
+  if (config.ydwg_raw_udp_mode == UDPMode::kMulticast) {
+    ydwg_raw_udp_server->set_multicast(config.ydwg_raw_udp_multicast_group);
+  }
+  if (!config.ydwg_raw_udp_tx_enabled && !config.ydwg_raw_udp_rx_enabled) {
+    ydwg_raw_udp_server->set_enabled(false);
+  }
+
+  // strings are queued before they are packed into datagrams, so that they
+  // can be shed by class
+  ValueConsumer<OriginString> *ydwg_raw_udp_output;
+  if (config.ydwg_raw_udp_mode == UDPMode::kUnicast) {
+    ydwg_raw_udp_unicast_output = new UDPUnicastOutput(
+        "YDWG RAW UDP", ydwg_raw_udp_server,
+        config.ydwg_raw_udp_destinations, network_loop);
+    ydwg_raw_udp_output = ydwg_raw_udp_unicast_output;
+  } else {
+    ydwg_raw_udp_output =
+        new UDPDatagramPacker(ydwg_raw_udp_server, kUDPDatagramPayloadSize,
+                              kUDPMaxBatchDelayMs, network_loop);
+  }
+  auto ydwg_raw_udp_queue =
+      NewOutputQueue("YDWG RAW UDP", ydwg_raw_udp_output,
+                     []() { return !ydwg_raw_udp_server->is_congested(); });
+  if (config.ydwg_raw_udp_tx_enabled) {
+    debugD("Connecting YDWG RAW to UDP TX");
+    YDWGRawOutput(&ydwg_raw_frames, config.ydwg_raw_udp_rate_limits,
+                  config.ydwg_raw_udp_filter)
+        ->connect_to(ydwg_raw_udp_queue);
+  }
+
+  // set up the NMEA 0183 TCP server
+
+  debugD("Setting up NMEA 0183 TCP server");
+  nmea0183_tcp_server = new StreamingTCPServer(config.nmea0183_tcp_port,
+                                               networking, network_loop);
+  nmea0183_tcp_server->set_tx_buffer(config.tcp_tx_buffer_size,
+                                     config.tcp_tx_overflow_policy);
+  nmea0183_tcp_server->set_name("NMEA 0183 TCP");
+  nmea0183_tcp_server->set_evict_idlest(config.tcp_evict_idlest_client);
+  nmea0183_tcp_server->set_slow_client_policy(
+      config.tcp_slow_client_queue_percent, config.tcp_slow_client_timeout_ms);
+  nmea0183_tcp_server->set_coalescing(kDefaultTCPFlushThreshold,
+                                      config.tcp_flush_deadline_ms);
+  nmea0183_tcp_server->set_enabled(config.nmea0183_tcp_enabled);
+
+  // set up the NMEA 0183 UDP server
+
+  debugD("Setting up NMEA 0183 UDP server");
+  nmea0183_udp_server =
+      new StreamingUDPServer(config.nmea0183_udp_port, networking,
+                             network_loop);
+  if (config.nmea0183_udp_mode == UDPMode::kMulticast) {
+    nmea0183_udp_server->set_multicast(config.nmea0183_udp_multicast_group);
+  }
+  // the server only transmits, and only translated NMEA 0183 output
+  nmea0183_udp_server->set_enabled(config.nmea0183_udp_enabled &&
+                                   config.translate_to_nmea0183);
+  ValueConsumer<OriginString> *nmea0183_udp_output;
+  if (config.nmea0183_udp_mode == UDPMode::kUnicast) {
+    nmea0183_udp_unicast_output = new UDPUnicastOutput(
+        "NMEA 0183 UDP", nmea0183_udp_server,
+        config.nmea0183_udp_destinations, network_loop);
+    nmea0183_udp_output = nmea0183_udp_unicast_output;
+  } else {
+    nmea0183_udp_output =
+        new UDPDatagramPacker(nmea0183_udp_server, kUDPDatagramPayloadSize,
+                              kUDPMaxBatchDelayMs, network_loop);
+  }
+
+  auto nmea0183_tcp_queue =
+      NewOutputQueue("NMEA 0183 TCP", nmea0183_tcp_server,
+                     []() { return !nmea0183_tcp_server->is_congested(); });
+  auto nmea0183_udp_queue =
+      NewOutputQueue("NMEA 0183 UDP", nmea0183_udp_output,
+                     []() { return !nmea0183_udp_server->is_congested(); });
+
+  // send the generated NMEA 0183 and SeaSmart messages
+  ValueProducer<OriginString> *n2k_to_0183 = nullptr;
+  if (config.translate_to_nmea0183) {
+    debugD("Connecting NMEA 0183 to consumers");
+    n2k_to_0183 = n2k_to_0183_transform;
+  }
+  ValueProducer<OriginString> *n2k_to_seasmart = nullptr;
+  if (config.translate_to_seasmart) {
+    debugD("Connecting Seasmart to consumers");
+    n2k_to_seasmart = n2k_to_seasmart_transform;
+  }
+  ConnectNMEA0183Output(n2k_msg_source, n2k_to_0183, n2k_to_seasmart,
+                        config.nmea0183_tcp_rate_limits,
+                        config.nmea0183_tcp_filter, nmea0183_tcp_queue);
+  ConnectNMEA0183Output(n2k_msg_source, n2k_to_0183, n2k_to_seasmart,
+                        config.nmea0183_udp_rate_limits,
+                        config.nmea0183_udp_filter, nmea0183_udp_queue);
+
+  // set up the YDWG RAW TCP clients
+  if (config.ydwg_raw_tcp_client_enabled &&
+      !config.ydwg_raw_tcp_client_targets.empty()) {
+    ydwg_raw_tcp_clients = new TCPClientGroup(
+        config.ydwg_raw_tcp_client_targets, networking, network_loop);
+    ydwg_raw_tcp_clients->set_name("YDWG RAW TCP client");
+    SetBacklog(ydwg_raw_tcp_clients, config, "ydwg_raw_backlog");
+    auto ydwg_raw_tcp_client_queue =
+        NewOutputQueue("YDWG RAW TCP client", ydwg_raw_tcp_clients, []() {
+          return !ydwg_raw_tcp_clients->is_congested();
+        });
+    YDWGRawOutput(&ydwg_raw_frames, config.ydwg_raw_tcp_client_rate_limits,
+                  config.ydwg_raw_tcp_client_filter)
+        ->connect_to(ydwg_raw_tcp_client_queue);
+    ydwg_raw_tcp_clients->connect_to(string_tokenizer);
+  }
+
+  // set up the NMEA 0183 TCP clients
+  if (config.nmea0183_tcp_client_enabled &&
+      !config.nmea0183_tcp_client_targets.empty()) {
+    nmea0183_tcp_clients = new TCPClientGroup(
+        config.nmea0183_tcp_client_targets, networking, network_loop);
+    nmea0183_tcp_clients->set_name("NMEA 0183 TCP client");
+    SetBacklog(nmea0183_tcp_clients, config, "nmea0183_backlog");
+    auto nmea0183_tcp_client_queue =
+        NewOutputQueue("NMEA 0183 TCP client", nmea0183_tcp_clients, []() {
+          return !nmea0183_tcp_clients->is_congested();
+        });
+    ConnectNMEA0183Output(n2k_msg_source, n2k_to_0183, nullptr,
+                          config.nmea0183_tcp_client_rate_limits,
+                          config.nmea0183_tcp_client_filter,
+                          nmea0183_tcp_client_queue);
+  }
+
+  if (config.ydwg_raw_tcp_tx_enabled) {
+    debugD("Connecting YDWG RAW TX to TCP server");
+    auto ydwg_raw_tcp_queue =
+        NewOutputQueue("YDWG RAW TCP", ydwg_raw_tcp_server,
+                       []() { return !ydwg_raw_tcp_server->is_congested(); });
+    YDWGRawOutput(&ydwg_raw_frames, config.ydwg_raw_tcp_rate_limits,
+                  config.ydwg_raw_tcp_filter)
+        ->connect_to(ydwg_raw_tcp_queue);
+  }
+
+  if (config.ydwg_raw_tcp_rx_enabled) {
+    debugD("Connecting TCP server to YDWG RAW RX");
+    ydwg_raw_tcp_server->connect_to(ydwg_raw_to_can_transform);
+  }
+
+  if (config.ydwg_raw_udp_rx_enabled) {
+    debugD("Connecting UDP RX to YDWG RAW");
+    // the server emits the datagrams line by line
+    ydwg_raw_udp_server->connect_to(ydwg_raw_to_can_transform);
+  }
+}
+
+String GetClientStatsJSON() {
+  String json = "{\"uptime_s\":" + String(millis() / 1000) + ",\"servers\":[";
+  if (ydwg_raw_tcp_server != nullptr) {
+    json += ydwg_raw_tcp_server->get_stats_json();
+  }
+  if (nmea0183_tcp_server != nullptr) {
+    if (ydwg_raw_tcp_server != nullptr) {
+      json += ",";
+    }
+    json += nmea0183_tcp_server->get_stats_json();
+  }
+  return json + "]}";
+}
+
+String GetUDPStatsJSON() {
+  String json = "{\"uptime_s\":" + String(millis() / 1000) + ",\"outputs\":[";
+  if (ydwg_raw_udp_unicast_output != nullptr) {
+    json += ydwg_raw_udp_unicast_output->get_stats_json();
+  }
+  if (nmea0183_udp_unicast_output != nullptr) {
+    if (ydwg_raw_udp_unicast_output != nullptr) {
+      json += ",";
+    }
+    json += nmea0183_udp_unicast_output->get_stats_json();
+  }
+  return json + "]}";
+}
+
+String GetUpstreamStatsJSON() {
+  String json = "{\"uptime_s\":" + String(millis() / 1000) + ",\"clients\":[";
+  if (ydwg_raw_tcp_clients != nullptr) {
+    json += ydwg_raw_tcp_clients->get_stats_json();
+  }
+  if (nmea0183_tcp_clients != nullptr) {
+    if (ydwg_raw_tcp_clients != nullptr) {
+      json += ",";
+    }
+    json += nmea0183_tcp_clients->get_stats_json();
+  }
+  return json + "]}";
+}
+
+static void ExecuteNetworkTask(void *task_args) {
+  // the loop sleeps in select() or epoll while idle, and yields by itself
+  // if it stays busy for long
+  while (true) {
+    network_loop->run_once();
+  }
+}
+
+void StartNetworkTask() {
+  xTaskCreatePinnedToCore(ExecuteNetworkTask, "network_task", 8192, NULL, 1,
+                          NULL, kNetworkTaskCore);
+}
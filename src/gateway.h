@@ -0,0 +1,143 @@
+#ifndef SH_WG_FIRMWARE_GATEWAY_H_
+#define SH_WG_FIRMWARE_GATEWAY_H_
+
+#include <N2kMsg.h>
+
+#include <atomic>
+
+#include "NMEA2000/NMEA2000_framehandler.h"
+#include "can_frame.h"
+#include "decimation.h"
+#include "n2k_msg_pool.h"
+#include "network_loop.h"
+#include "origin_string.h"
+#include "output_queue.h"
+#include "pgn_filter.h"
+#include "sensesp/net/networking.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/transforms/lambda_transform.h"
+#include "streaming_tcp_client.h"
+#include "streaming_tcp_server.h"
+#include "streaming_udp_server.h"
+#include "task_bridge.h"
+#include "udp_unicast_output.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Gateway routing configuration.
+ *
+ * The platform entry point fills this in from its own configuration source
+ * (web UI on the device, command line on Linux) before calling
+ * SetupConnections().
+ *
+ * Each output has its own PGN filter and rate limits. Both are off by
+ * default.
+ */
+struct GatewayConfig {
+  bool ydwg_raw_tcp_tx_enabled = true;
+  bool ydwg_raw_tcp_rx_enabled = false;
+  uint16_t ydwg_raw_tcp_port = 0;
+  PGNFilter ydwg_raw_tcp_filter;
+  DecimationRules ydwg_raw_tcp_rate_limits;
+
+  bool ydwg_raw_udp_tx_enabled = true;
+  bool ydwg_raw_udp_rx_enabled = false;
+  uint16_t ydwg_raw_udp_port = 0;
+  UDPMode ydwg_raw_udp_mode = UDPMode::kBroadcast;
+  IPAddress ydwg_raw_udp_multicast_group;
+  std::vector<UDPDestination> ydwg_raw_udp_destinations;
+  PGNFilter ydwg_raw_udp_filter;
+  DecimationRules ydwg_raw_udp_rate_limits;
+
+  bool nmea0183_tcp_enabled = true;
+  uint16_t nmea0183_tcp_port = 0;
+  PGNFilter nmea0183_tcp_filter;
+  DecimationRules nmea0183_tcp_rate_limits;
+
+  bool nmea0183_udp_enabled = true;
+  uint16_t nmea0183_udp_port = 0;
+  UDPMode nmea0183_udp_mode = UDPMode::kBroadcast;
+  IPAddress nmea0183_udp_multicast_group;
+  std::vector<UDPDestination> nmea0183_udp_destinations;
+  PGNFilter nmea0183_udp_filter;
+  DecimationRules nmea0183_udp_rate_limits;
+
+  bool translate_to_nmea0183 = true;
+  bool translate_to_seasmart = false;
+
+  // servers the upstream TCP clients connect to
+  bool ydwg_raw_tcp_client_enabled = false;
+  std::vector<HostPort> ydwg_raw_tcp_client_targets;
+  PGNFilter ydwg_raw_tcp_client_filter;
+  DecimationRules ydwg_raw_tcp_client_rate_limits;
+
+  bool nmea0183_tcp_client_enabled = false;
+  std::vector<HostPort> nmea0183_tcp_client_targets;
+  PGNFilter nmea0183_tcp_client_filter;
+  DecimationRules nmea0183_tcp_client_rate_limits;
+
+  // per-client TX buffering of the TCP servers
+  size_t tcp_tx_buffer_size = kDefaultTCPClientTXBufferSize;
+  TXOverflowPolicy tcp_tx_overflow_policy = TXOverflowPolicy::kDropOldest;
+  // when all client slots are in use, evict the idlest client or refuse
+  bool tcp_evict_idlest_client = true;
+  // maximum time TCP client data is held back for write coalescing
+  unsigned long tcp_flush_deadline_ms = kDefaultTCPFlushDeadlineMs;
+  // disconnect clients whose TX queue fills past the percentage of its
+  // capacity and does not drain within the timeout; 0 disables either
+  int tcp_slow_client_queue_percent = kDefaultSlowClientQueuePercent;
+  unsigned long tcp_slow_client_timeout_ms = kDefaultSlowClientTimeoutMs;
+
+  // store-and-forward backlog of the upstream TCP clients, in bytes; a RAM
+  // size of 0 disables the backlog and a file size of 0 keeps it in RAM
+  size_t tcp_client_backlog_size = 0;
+  size_t tcp_client_backlog_file_size = 0;
+  // backlog replay rate in bytes per second; 0 is unlimited
+  size_t tcp_client_replay_rate = kDefaultTCPClientReplayRate;
+};
+
+extern tNMEA2000_FH *nmea2000;
+
+extern StreamingTCPServer *nmea0183_tcp_server;
+extern StreamingTCPServer *ydwg_raw_tcp_server;
+
+extern StreamingUDPServer *nmea0183_udp_server;
+extern StreamingUDPServer *ydwg_raw_udp_server;
+
+// only set if the UDP output is in unicast mode
+extern UDPUnicastOutput *nmea0183_udp_unicast_output;
+extern UDPUnicastOutput *ydwg_raw_udp_unicast_output;
+
+extern TCPClientGroup *ydwg_raw_tcp_clients;
+extern TCPClientGroup *nmea0183_tcp_clients;
+
+/// Statistics of the TCP servers as JSON; may be called from any task.
+String GetClientStatsJSON();
+/// Statistics of the UDP unicast outputs as JSON.
+String GetUDPStatsJSON();
+/// Statistics of the upstream TCP clients as JSON.
+String GetUpstreamStatsJSON();
+
+// incremented in the CAN task, read from anywhere
+extern std::atomic<uint32_t> can_frame_rx_counter;
+extern std::atomic<uint32_t> can_frame_tx_counter;
+
+extern NetworkLoop *network_loop;
+
+extern ObservableValue<N2kMsgRef> n2k_msg_input;
+
+extern ObservableValue<OriginString> ydwg_raw_strings;
+extern ObservableValue<CANFrame> ydwg_raw_frames;
+
+extern std::vector<OutputQueue *> output_queues;
+
+extern std::vector<TaskBridge<OriginString> *> can_to_network_bridges;
+extern TaskBridge<CANFrame> *network_to_can_bridge;
+
+void ConfigureNMEA2000(uint64_t serial_number);
+void SetupConnections(const GatewayConfig &config, Networking *networking);
+void StartNetworkTask();
+
+#endif  // SH_WG_FIRMWARE_GATEWAY_H_
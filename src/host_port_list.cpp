@@ -0,0 +1,44 @@
+#include "host_port_list.h"
+
+#include "sensesp.h"
+
+bool ParseHostPortList(const String& list, uint16_t default_port,
+                       size_t max_entries, const char* kind,
+                       std::vector<HostPort>& entries) {
+  bool ok = true;
+  int start = 0;
+  int length = list.length();
+  while (start < length) {
+    int end = start;
+    while (end < length && list[end] != ',' && list[end] != ' ') {
+      end++;
+    }
+    String entry = list.substring(start, end);
+    start = end + 1;
+    if (entry.length() == 0) {
+      continue;
+    }
+
+    HostPort host_port;
+    host_port.port = default_port;
+    int colon = entry.indexOf(':');
+    if (colon < 0) {
+      host_port.host = entry;
+    } else {
+      host_port.host = entry.substring(0, colon);
+      host_port.port = atoi(entry.substring(colon + 1).c_str());
+    }
+    if (host_port.host.length() == 0 || host_port.port == 0) {
+      debugW("Invalid %s: %s", kind, entry.c_str());
+      ok = false;
+      continue;
+    }
+    if (entries.size() >= max_entries) {
+      debugW("Too many %ss, skipping %s", kind, entry.c_str());
+      ok = false;
+      continue;
+    }
+    entries.push_back(host_port);
+  }
+  return ok;
+}
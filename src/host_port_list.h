@@ -0,0 +1,29 @@
+#ifndef SH_WG_FIRMWARE_HOST_PORT_LIST_H_
+#define SH_WG_FIRMWARE_HOST_PORT_LIST_H_
+
+#include <Arduino.h>
+
+#include <vector>
+
+/**
+ * @brief Network endpoint given by host name or address and port.
+ */
+struct HostPort {
+  String host;
+  uint16_t port;
+};
+
+/**
+ * @brief Parse a comma or space separated list of host[:port] entries.
+ *
+ * Entries without a port use the default port. Invalid entries and entries
+ * beyond max_entries are skipped with a warning that refers to them as
+ * kind.
+ *
+ * @return false if any entry was skipped.
+ */
+bool ParseHostPortList(const String& list, uint16_t default_port,
+                       size_t max_entries, const char* kind,
+                       std::vector<HostPort>& entries);
+
+#endif  // SH_WG_FIRMWARE_HOST_PORT_LIST_H_
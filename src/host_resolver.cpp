@@ -0,0 +1,67 @@
+#include "host_resolver.h"
+
+#include <WiFi.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace {
+
+struct ResolveRequest {
+  String host;
+  NetworkLoop* loop;
+  ResolveCallback callback;
+};
+
+struct ResolverQueue {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<ResolveRequest> requests;
+};
+
+void ExecuteResolverTask(void* task_args) {
+  ResolverQueue* queue = (ResolverQueue*)task_args;
+
+  while (true) {
+    ResolveRequest request;
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      queue->cv.wait(lock, [queue]() { return !queue->requests.empty(); });
+      request = queue->requests.front();
+      queue->requests.pop_front();
+    }
+
+    IPAddress address;
+    bool resolved = WiFi.hostByName(request.host.c_str(), address) == 1;
+    ResolveCallback callback = request.callback;
+    request.loop->post(
+        [callback, resolved, address]() { callback(resolved, address); });
+  }
+}
+
+ResolverQueue* GetResolverQueue() {
+  // never destroyed; the resolver task waits on it until the program exits
+  static ResolverQueue* queue = []() {
+    ResolverQueue* queue = new ResolverQueue();
+    xTaskCreate(ExecuteResolverTask, "resolver_task", 4096, queue, 1, NULL);
+    return queue;
+  }();
+  return queue;
+}
+
+}  // namespace
+
+void ResolveHostAsync(const String& host, NetworkLoop* loop,
+                      ResolveCallback callback) {
+  IPAddress address;
+  if (address.fromString(host)) {
+    loop->post([callback, address]() { callback(true, address); });
+    return;
+  }
+
+  ResolverQueue* queue = GetResolverQueue();
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->requests.push_back(ResolveRequest{host, loop, callback});
+  queue->cv.notify_one();
+}
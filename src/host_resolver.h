@@ -0,0 +1,28 @@
+#ifndef SH_WG_FIRMWARE_HOST_RESOLVER_H_
+#define SH_WG_FIRMWARE_HOST_RESOLVER_H_
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "network_loop.h"
+
+/// Called with the result of ResolveHostAsync().
+typedef std::function<void(bool resolved, const IPAddress& address)>
+    ResolveCallback;
+
+/**
+ * @brief Resolve a host name without blocking the calling task.
+ *
+ * WiFi.hostByName() waits for the DNS server for up to its timeout, which
+ * would stall every socket served by a NetworkLoop. The lookups are instead
+ * run one at a time in a resolver task of their own, created on the first
+ * request, and the callback is posted to the given loop with the result.
+ * IP address literals are resolved without a lookup.
+ *
+ * May be called from any task.
+ */
+void ResolveHostAsync(const String& host, NetworkLoop* loop,
+                      ResolveCallback callback);
+
+#endif  // SH_WG_FIRMWARE_HOST_RESOLVER_H_
@@ -0,0 +1,73 @@
+#ifdef SH_WG_LINUX
+
+#include <Arduino.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <thread>
+
+#include "sensesp.h"
+#include "sensesp/system/startable.h"
+
+static uint64_t MonotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t millis() { return MonotonicMicros() / 1000; }
+
+uint32_t micros() { return MonotonicMicros(); }
+
+void delay(uint32_t ms) { usleep(1000 * ms); }
+
+long random(long howbig) { return howbig <= 0 ? 0 : ::random() % howbig; }
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+int xTaskCreate(TaskFunction_t task_function, const char* /*name*/,
+                uint32_t /*stack_depth*/, void* parameters,
+                unsigned int /*priority*/, TaskHandle_t* /*created_task*/) {
+  std::thread(task_function, parameters).detach();
+  return 1;
+}
+
+int xTaskCreatePinnedToCore(TaskFunction_t task_function, const char* name,
+                            uint32_t stack_depth, void* parameters,
+                            unsigned int priority, TaskHandle_t* created_task,
+                            int /*core_id*/) {
+  // leave CPU placement to the Linux scheduler
+  return xTaskCreate(task_function, name, stack_depth, parameters, priority,
+                     created_task);
+}
+
+void LinuxDebugPrint(char level, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "(%c) ", level);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+namespace sensesp {
+
+std::vector<Startable*> Startable::startables_;
+
+void Startable::start_all() {
+  std::stable_sort(startables_.begin(), startables_.end(),
+                   [](const Startable* a, const Startable* b) {
+                     return a->priority_ > b->priority_;
+                   });
+  for (Startable* startable : startables_) {
+    startable->start();
+  }
+}
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX
@@ -0,0 +1,151 @@
+#ifdef SH_WG_LINUX
+
+#include <AsyncUDP.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "sensesp.h"
+
+// Largest UDP payload accepted by the receive path
+static constexpr size_t kMaxUDPPacketSize = 1500;
+
+static std::vector<uint32_t> GetLocalAddresses() {
+  std::vector<uint32_t> addresses;
+  struct ifaddrs* ifaddr;
+  if (getifaddrs(&ifaddr) < 0) {
+    return addresses;
+  }
+  for (struct ifaddrs* ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr != nullptr && ifa->ifa_addr->sa_family == AF_INET) {
+      addresses.push_back(
+          ((struct sockaddr_in*)ifa->ifa_addr)->sin_addr.s_addr);
+    }
+  }
+  freeifaddrs(ifaddr);
+  return addresses;
+}
+
+bool AsyncUDP::listen(uint16_t port) {
+  close();
+
+  fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  int enable = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  setsockopt(fd_, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+  port_ = port;
+  local_addresses_ = GetLocalAddresses();
+
+  reaction_ =
+      reactesp::ReactESP::app->onReadable(fd_, [this]() { this->receive(); });
+  return true;
+}
+
+bool AsyncUDP::listenMulticast(const IPAddress addr, uint16_t port,
+                               uint8_t ttl) {
+  if (!listen(port)) {
+    return false;
+  }
+  struct ip_mreq mreq = {};
+  mreq.imr_multiaddr.s_addr = (uint32_t)addr;
+  mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) <
+      0) {
+    close();
+    return false;
+  }
+  int multicast_ttl = ttl;
+  setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &multicast_ttl,
+             sizeof(multicast_ttl));
+  // lwIP does not loop multicast back to the sender either; without this,
+  // a server receiving on its own group would read back its own output
+  int loop = 0;
+  setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  return true;
+}
+
+void AsyncUDP::close() {
+  if (reaction_ != nullptr) {
+    reaction_->remove();
+    reaction_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+/**
+ * @brief Receive all pending datagrams.
+ *
+ * Unlike on the ESP32, Linux loops our own broadcasts back to the socket.
+ * Those are discarded so that transmitted data is not received again.
+ */
+void AsyncUDP::receive() {
+  uint8_t buf[kMaxUDPPacketSize];
+  struct sockaddr_in src_addr;
+  socklen_t src_addr_len = sizeof(src_addr);
+  ssize_t len;
+  while ((len = recvfrom(fd_, buf, sizeof(buf), 0,
+                         (struct sockaddr*)&src_addr, &src_addr_len)) >= 0) {
+    src_addr_len = sizeof(src_addr);
+    bool own_packet = ntohs(src_addr.sin_port) == port_ &&
+                      std::find(local_addresses_.begin(),
+                                local_addresses_.end(),
+                                src_addr.sin_addr.s_addr) !=
+                          local_addresses_.end();
+    if (!own_packet && handler_) {
+      AsyncUDPPacket packet(buf, len);
+      handler_(packet);
+    }
+  }
+}
+
+size_t AsyncUDP::broadcastTo(uint8_t* data, size_t len, uint16_t port) {
+  if (fd_ < 0) {
+    return 0;
+  }
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+  addr.sin_port = htons(port);
+  ssize_t sent =
+      sendto(fd_, data, len, 0, (struct sockaddr*)&addr, sizeof(addr));
+  return sent < 0 ? 0 : sent;
+}
+
+size_t AsyncUDP::writeTo(const uint8_t* data, size_t len, const IPAddress addr,
+                         uint16_t port) {
+  if (fd_ < 0) {
+    return 0;
+  }
+  struct sockaddr_in dest_addr = {};
+  dest_addr.sin_family = AF_INET;
+  dest_addr.sin_addr.s_addr = (uint32_t)addr;
+  dest_addr.sin_port = htons(port);
+  ssize_t sent = sendto(fd_, data, len, 0, (struct sockaddr*)&dest_addr,
+                        sizeof(dest_addr));
+  return sent < 0 ? 0 : sent;
+}
+
+#endif  // SH_WG_LINUX
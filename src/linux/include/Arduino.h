@@ -0,0 +1,38 @@
+#ifndef SH_WG_LINUX_ARDUINO_H_
+#define SH_WG_LINUX_ARDUINO_H_
+
+// Minimal Arduino core API for building the gateway on a Linux host.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "IPAddress.h"
+#include "WString.h"
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// pseudo-random numbers in [0, howbig) and [howsmall, howbig)
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+// FreeRTOS task creation, implemented with detached POSIX threads
+
+typedef void (*TaskFunction_t)(void*);
+typedef void* TaskHandle_t;
+
+int xTaskCreate(TaskFunction_t task_function, const char* name,
+                uint32_t stack_depth, void* parameters, unsigned int priority,
+                TaskHandle_t* created_task);
+
+int xTaskCreatePinnedToCore(TaskFunction_t task_function, const char* name,
+                            uint32_t stack_depth, void* parameters,
+                            unsigned int priority, TaskHandle_t* created_task,
+                            int core_id);
+
+#endif  // SH_WG_LINUX_ARDUINO_H_
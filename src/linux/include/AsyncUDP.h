@@ -0,0 +1,60 @@
+#ifndef SH_WG_LINUX_ASYNCUDP_H_
+#define SH_WG_LINUX_ASYNCUDP_H_
+
+// Arduino AsyncUDP implemented on a POSIX socket watched by the ReactESP
+// event loop.
+
+#include <Arduino.h>
+
+#include <functional>
+#include <vector>
+
+#include "ReactESP.h"
+
+class AsyncUDPPacket {
+ public:
+  AsyncUDPPacket(uint8_t* data, size_t length)
+      : data_{data}, length_{length} {}
+
+  uint8_t* data() { return data_; }
+  size_t length() { return length_; }
+
+ protected:
+  uint8_t* data_;
+  size_t length_;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+ public:
+  ~AsyncUDP() { close(); }
+
+  bool listen(uint16_t port);
+  /// Listen on the port and join the multicast group on all interfaces.
+  bool listenMulticast(const IPAddress addr, uint16_t port, uint8_t ttl = 1);
+  void close();
+
+  void onPacket(AuPacketHandlerFunction cb) { handler_ = cb; }
+
+  size_t broadcast(const char* data) {
+    return broadcast((uint8_t*)data, strlen(data));
+  }
+  size_t broadcast(uint8_t* data, size_t len) {
+    return broadcastTo(data, len, port_);
+  }
+  size_t broadcastTo(uint8_t* data, size_t len, uint16_t port);
+  size_t writeTo(const uint8_t* data, size_t len, const IPAddress addr,
+                 uint16_t port);
+
+ protected:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  AuPacketHandlerFunction handler_;
+  reactesp::Reaction* reaction_ = nullptr;
+  std::vector<uint32_t> local_addresses_;
+
+  void receive();
+};
+
+#endif  // SH_WG_LINUX_ASYNCUDP_H_
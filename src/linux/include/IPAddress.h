@@ -0,0 +1,57 @@
+#ifndef SH_WG_LINUX_IPADDRESS_H_
+#define SH_WG_LINUX_IPADDRESS_H_
+
+// Arduino IPv4 address class.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "WString.h"
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    bytes_[0] = a;
+    bytes_[1] = b;
+    bytes_[2] = c;
+    bytes_[3] = d;
+  }
+  /// Address in network byte order, as in struct in_addr.
+  IPAddress(uint32_t address) { memcpy(bytes_, &address, 4); }
+
+  bool fromString(const char* address) {
+    unsigned a, b, c, d;
+    char extra;
+    if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 ||
+        a > 255 || b > 255 || c > 255 || d > 255) {
+      return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  bool fromString(const String& address) {
+    return fromString(address.c_str());
+  }
+
+  /// Address in network byte order.
+  operator uint32_t() const {
+    uint32_t address;
+    memcpy(&address, bytes_, 4);
+    return address;
+  }
+  uint8_t operator[](int index) const { return bytes_[index]; }
+
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2],
+             bytes_[3]);
+    return buf;
+  }
+
+ private:
+  uint8_t bytes_[4] = {0, 0, 0, 0};
+};
+
+#endif  // SH_WG_LINUX_IPADDRESS_H_
@@ -0,0 +1,82 @@
+#ifndef SH_WG_LINUX_REACTESP_H_
+#define SH_WG_LINUX_REACTESP_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace reactesp {
+
+typedef std::function<void()> react_callback;
+
+class ReactESP;
+
+/**
+ * @brief A scheduled callback: a timer, a per-tick callback or a file
+ * descriptor readiness callback.
+ */
+class Reaction {
+ public:
+  enum class Type { kDelay, kRepeat, kTick, kReadable };
+
+  Reaction(ReactESP* app, Type type, uint64_t interval_us, react_callback cb)
+      : app_{app}, type_{type}, interval_us_{interval_us}, callback_{cb} {}
+
+  void remove();
+
+ protected:
+  ReactESP* app_;
+  Type type_;
+  uint64_t interval_us_;
+  uint64_t next_us_ = 0;
+  int fd_ = -1;
+  bool removed_ = false;
+  react_callback callback_;
+
+  friend class ReactESP;
+};
+
+typedef Reaction DelayReaction;
+typedef Reaction RepeatReaction;
+typedef Reaction TickReaction;
+
+/**
+ * @brief Linux implementation of the ReactESP event loop.
+ *
+ * Timers are kept in a list and file descriptors are watched with epoll.
+ * tick() sleeps in epoll_wait until the next timer is due or a watched
+ * descriptor becomes readable. Each instance must only be ticked and
+ * modified by a single thread.
+ */
+class ReactESP {
+ public:
+  ReactESP(bool singleton = true);
+
+  static ReactESP* app;
+
+  void tick();
+  /// Like tick(), but wait for at most max_wait_ms. Linux only.
+  void tick(int max_wait_ms);
+
+  DelayReaction* onDelay(uint32_t t, react_callback cb);
+  DelayReaction* onDelayMicros(uint64_t t, react_callback cb);
+  RepeatReaction* onRepeat(uint32_t t, react_callback cb);
+  RepeatReaction* onRepeatMicros(uint64_t t, react_callback cb);
+  TickReaction* onTick(react_callback cb);
+
+  /// Call cb whenever fd is readable. Linux only.
+  Reaction* onReadable(int fd, react_callback cb);
+
+  void remove(Reaction* reaction);
+
+ protected:
+  int epoll_fd_;
+  std::vector<Reaction*> reactions_;
+
+  Reaction* add(Reaction* reaction);
+  int get_timeout_ms(uint64_t now_us);
+};
+
+}  // namespace reactesp
+
+#endif  // SH_WG_LINUX_REACTESP_H_
@@ -0,0 +1,131 @@
+#ifndef SH_WG_LINUX_WSTRING_H_
+#define SH_WG_LINUX_WSTRING_H_
+
+#include <strings.h>
+
+#include <cstring>
+#include <string>
+
+/**
+ * @brief Subset of the Arduino String API used by the gateway, backed by
+ * std::string.
+ */
+class String {
+ public:
+  String() {}
+  String(const char* str) : str_(str == nullptr ? "" : str) {}
+  String(const std::string& str) : str_(str) {}
+  explicit String(char c) : str_(1, c) {}
+  explicit String(int value) : str_(std::to_string(value)) {}
+  explicit String(unsigned int value) : str_(std::to_string(value)) {}
+  explicit String(long value) : str_(std::to_string(value)) {}
+  explicit String(unsigned long value) : str_(std::to_string(value)) {}
+
+  const char* c_str() const { return str_.c_str(); }
+  unsigned int length() const { return str_.length(); }
+  bool reserve(unsigned int size) {
+    str_.reserve(size);
+    return true;
+  }
+
+  char operator[](unsigned int index) const { return str_[index]; }
+  char& operator[](unsigned int index) { return str_[index]; }
+
+  String& operator+=(const String& rhs) {
+    str_ += rhs.str_;
+    return *this;
+  }
+  String& operator+=(const char* rhs) {
+    str_ += rhs;
+    return *this;
+  }
+  String& operator+=(char rhs) {
+    str_ += rhs;
+    return *this;
+  }
+  bool concat(const char* str, unsigned int len) {
+    str_.append(str, len);
+    return true;
+  }
+
+  bool operator==(const String& rhs) const { return str_ == rhs.str_; }
+  bool operator==(const char* rhs) const { return str_ == rhs; }
+  bool operator!=(const String& rhs) const { return str_ != rhs.str_; }
+  bool operator!=(const char* rhs) const { return str_ != rhs; }
+
+  bool startsWith(const String& prefix) const {
+    return str_.compare(0, prefix.str_.length(), prefix.str_) == 0;
+  }
+  bool equalsIgnoreCase(const String& rhs) const {
+    return strcasecmp(str_.c_str(), rhs.str_.c_str()) == 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    return to_index(str_.find(c, from));
+  }
+  int indexOf(const String& str, unsigned int from = 0) const {
+    return to_index(str_.find(str.str_, from));
+  }
+
+  String substring(unsigned int begin) const {
+    if (begin > str_.length()) {
+      return String();
+    }
+    return String(str_.substr(begin));
+  }
+  String substring(unsigned int begin, unsigned int end) const {
+    if (begin > end) {
+      std::swap(begin, end);
+    }
+    if (begin > str_.length()) {
+      return String();
+    }
+    return String(str_.substr(begin, end - begin));
+  }
+
+  void trim() {
+    const char* whitespace = " \t\r\n\f\v";
+    size_t begin = str_.find_first_not_of(whitespace);
+    if (begin == std::string::npos) {
+      str_.clear();
+      return;
+    }
+    size_t end = str_.find_last_not_of(whitespace);
+    str_ = str_.substr(begin, end - begin + 1);
+  }
+
+  void replace(const String& find, const String& replace) {
+    if (find.length() == 0) {
+      return;
+    }
+    size_t pos = 0;
+    while ((pos = str_.find(find.str_, pos)) != std::string::npos) {
+      str_.replace(pos, find.length(), replace.str_);
+      pos += replace.length();
+    }
+  }
+
+  long toInt() const { return strtol(str_.c_str(), nullptr, 10); }
+
+  friend String operator+(const String& lhs, const String& rhs) {
+    return String(lhs.str_ + rhs.str_);
+  }
+  friend String operator+(const String& lhs, const char* rhs) {
+    return String(lhs.str_ + rhs);
+  }
+  friend String operator+(const char* lhs, const String& rhs) {
+    return String(lhs + rhs.str_);
+  }
+  friend String operator+(const String& lhs, char rhs) {
+    return String(lhs.str_ + rhs);
+  }
+
+ private:
+  static int to_index(size_t pos) {
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+  }
+
+  std::string str_;
+};
+
+#endif  // SH_WG_LINUX_WSTRING_H_
@@ -0,0 +1,92 @@
+#ifndef SH_WG_LINUX_WIFI_H_
+#define SH_WG_LINUX_WIFI_H_
+
+// Arduino WiFiClient and WiFiServer implemented on POSIX sockets.
+
+#include <Arduino.h>
+
+#include <memory>
+
+/**
+ * @brief Owner of a socket file descriptor. Closes the socket on destruction.
+ */
+class SocketHandle {
+ public:
+  SocketHandle(int fd) : fd_{fd} {}
+  ~SocketHandle();
+
+  int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+/**
+ * @brief TCP client connection. Copies share the same underlying socket,
+ * like on the ESP32.
+ */
+class WiFiClient {
+ public:
+  WiFiClient() {}
+  WiFiClient(int fd);
+
+  int connect(const char* host, uint16_t port, int32_t timeout_ms = 3000);
+  void stop();
+
+  uint8_t connected();
+  operator bool() { return connected(); }
+
+  int available();
+  int read();
+  int read(uint8_t* buf, size_t size);
+
+  size_t write(uint8_t data) { return write(&data, 1); }
+  size_t write(const char* str) {
+    return write((const uint8_t*)str, strlen(str));
+  }
+  size_t write(const uint8_t* buf, size_t size);
+
+  void flush() {}
+
+  int setNoDelay(bool nodelay);
+
+  /// Socket file descriptor, or -1 if not connected.
+  int fd() const { return socket_ ? socket_->fd() : -1; }
+
+ protected:
+  std::shared_ptr<SocketHandle> socket_;
+};
+
+/**
+ * @brief Non-blocking TCP listening socket.
+ */
+class WiFiServer {
+ public:
+  WiFiServer(uint16_t port) : port_{port} {}
+
+  void begin();
+  void end();
+
+  /// Accept a pending connection. The returned client is false if none.
+  WiFiClient available();
+
+  /// Listening socket file descriptor, or -1 if not started.
+  int fd() const { return listen_fd_; }
+
+ protected:
+  uint16_t port_;
+  int listen_fd_ = -1;
+};
+
+/**
+ * @brief Subset of the ESP32 global WiFi object.
+ */
+class WiFiClass {
+ public:
+  /// Resolve a host name to an IPv4 address. Returns 1 on success.
+  int hostByName(const char* hostname, IPAddress& result);
+};
+
+extern WiFiClass WiFi;
+
+#endif  // SH_WG_LINUX_WIFI_H_
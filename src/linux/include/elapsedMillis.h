@@ -0,0 +1,34 @@
+#ifndef SH_WG_LINUX_ELAPSEDMILLIS_H_
+#define SH_WG_LINUX_ELAPSEDMILLIS_H_
+
+#include <Arduino.h>
+
+class elapsedMillis {
+ public:
+  elapsedMillis() : ms_(millis()) {}
+  elapsedMillis(unsigned long val) : ms_(millis() - val) {}
+  operator unsigned long() const { return millis() - ms_; }
+  elapsedMillis& operator=(unsigned long val) {
+    ms_ = millis() - val;
+    return *this;
+  }
+
+ private:
+  uint32_t ms_;
+};
+
+class elapsedMicros {
+ public:
+  elapsedMicros() : us_(micros()) {}
+  elapsedMicros(unsigned long val) : us_(micros() - val) {}
+  operator unsigned long() const { return micros() - us_; }
+  elapsedMicros& operator=(unsigned long val) {
+    us_ = micros() - val;
+    return *this;
+  }
+
+ private:
+  uint32_t us_;
+};
+
+#endif  // SH_WG_LINUX_ELAPSEDMILLIS_H_
@@ -0,0 +1,25 @@
+#ifndef SH_WG_LINUX_SENSESP_H_
+#define SH_WG_LINUX_SENSESP_H_
+
+// Subset of the SensESP API used by the gateway pipeline, for Linux builds.
+
+#include <Arduino.h>
+
+#include <cstdio>
+
+#include "ReactESP.h"
+
+namespace sensesp {
+using namespace reactesp;
+}  // namespace sensesp
+
+void LinuxDebugPrint(char level, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#define debugE(fmt, ...) LinuxDebugPrint('E', fmt, ##__VA_ARGS__)
+#define debugW(fmt, ...) LinuxDebugPrint('W', fmt, ##__VA_ARGS__)
+#define debugI(fmt, ...) LinuxDebugPrint('I', fmt, ##__VA_ARGS__)
+#define debugD(fmt, ...) LinuxDebugPrint('D', fmt, ##__VA_ARGS__)
+#define debugV(fmt, ...) LinuxDebugPrint('V', fmt, ##__VA_ARGS__)
+
+#endif  // SH_WG_LINUX_SENSESP_H_
@@ -0,0 +1,37 @@
+#ifndef SH_WG_LINUX_SENSESP_NET_NETWORKING_H_
+#define SH_WG_LINUX_SENSESP_NET_NETWORKING_H_
+
+#include "ReactESP.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/startable.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+enum class WiFiState {
+  kWifiNoAP = 0,
+  kWifiDisconnected,
+  kWifiConnectedToAP,
+  kWifiManagerActivated,
+  kWifiAPModeActivated
+};
+
+typedef WiFiState WifiState;
+
+/**
+ * @brief Network state provider for Linux. The host network is assumed to be
+ * up, so a connected state is emitted once everything has been started.
+ */
+class Networking : public ValueProducer<WiFiState>, public Startable {
+ public:
+  Networking() : ValueProducer<WiFiState>(WiFiState::kWifiNoAP), Startable(0) {}
+
+  void start() override {
+    ReactESP::app->onDelay(
+        0, [this]() { this->emit(WiFiState::kWifiConnectedToAP); });
+  }
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_NET_NETWORKING_H_
@@ -0,0 +1,25 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
+
+#include <functional>
+
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+template <typename IN>
+class LambdaConsumer : public ValueConsumer<IN> {
+ public:
+  LambdaConsumer(std::function<void(IN)> function) : function_{function} {}
+
+  void set_input(IN input, uint8_t /*input_channel*/ = 0) override {
+    function_(input);
+  }
+
+ protected:
+  std::function<void(IN)> function_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
@@ -0,0 +1,30 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_OBSERVABLE_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_OBSERVABLE_H_
+
+#include <functional>
+#include <vector>
+
+namespace sensesp {
+
+/**
+ * @brief A class that notifies attached observers of changes.
+ */
+class Observable {
+ public:
+  void attach(std::function<void()> observer) {
+    observers_.push_back(observer);
+  }
+
+  void notify() {
+    for (auto& observer : observers_) {
+      observer();
+    }
+  }
+
+ private:
+  std::vector<std::function<void()> > observers_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_OBSERVABLE_H_
@@ -0,0 +1,24 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
+
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+template <class T>
+class ObservableValue : public ValueProducer<T> {
+ public:
+  ObservableValue() : ValueProducer<T>() {}
+  ObservableValue(const T& value) : ValueProducer<T>(value) {}
+
+  void set(const T& value) { this->emit(value); }
+
+  const T& operator=(const T& value) {
+    set(value);
+    return value;
+  }
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_OBSERVABLEVALUE_H_
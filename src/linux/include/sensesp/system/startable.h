@@ -0,0 +1,31 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_STARTABLE_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_STARTABLE_H_
+
+#include <vector>
+
+namespace sensesp {
+
+/**
+ * @brief Base class for objects that are started once the application has
+ * been set up. Higher priority objects are started first.
+ */
+class Startable {
+ public:
+  Startable(int priority = 0) : priority_{priority} {
+    startables_.push_back(this);
+  }
+
+  virtual void start() = 0;
+
+  static void start_all();
+
+ protected:
+  int priority_;
+
+ private:
+  static std::vector<Startable*> startables_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_STARTABLE_H_
@@ -0,0 +1,57 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_TASK_QUEUE_PRODUCER_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_TASK_QUEUE_PRODUCER_H_
+
+#include <deque>
+#include <mutex>
+
+#include "ReactESP.h"
+#include "sensesp/system/observablevalue.h"
+
+namespace sensesp {
+
+/**
+ * @brief Producer that passes values from one thread to another through a
+ * bounded queue. The values are emitted in the consumer event loop.
+ */
+template <class T>
+class TaskQueueProducer : public ObservableValue<T> {
+ public:
+  TaskQueueProducer(const T& value, ReactESP* consumer_app = ReactESP::app,
+                    int queue_size = 1, unsigned int poll_rate = 990)
+      : ObservableValue<T>(value), queue_size_{(size_t)queue_size} {
+    consumer_app->onRepeatMicros(poll_rate, [this]() {
+      T value;
+      while (this->pop(value)) {
+        this->emit(value);
+      }
+    });
+  }
+
+  virtual bool set(const T& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= queue_size_) {
+      return false;
+    }
+    queue_.push_back(value);
+    return true;
+  }
+
+ protected:
+  std::mutex mutex_;
+  std::deque<T> queue_;
+  size_t queue_size_;
+
+  bool pop(T& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.empty()) {
+      return false;
+    }
+    value = queue_.front();
+    queue_.pop_front();
+    return true;
+  }
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_TASK_QUEUE_PRODUCER_H_
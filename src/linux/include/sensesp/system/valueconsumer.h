@@ -0,0 +1,22 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_VALUECONSUMER_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_VALUECONSUMER_H_
+
+#include <cstdint>
+
+#include "sensesp.h"
+
+namespace sensesp {
+
+template <typename T>
+class ValueConsumer {
+ public:
+  typedef T input_type;
+
+  virtual ~ValueConsumer() {}
+
+  virtual void set_input(T /*new_value*/, uint8_t /*input_channel*/ = 0) {}
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_VALUECONSUMER_H_
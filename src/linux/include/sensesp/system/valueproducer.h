@@ -0,0 +1,39 @@
+#ifndef SH_WG_LINUX_SENSESP_SYSTEM_VALUEPRODUCER_H_
+#define SH_WG_LINUX_SENSESP_SYSTEM_VALUEPRODUCER_H_
+
+#include "sensesp/system/observable.h"
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+/**
+ * @brief A value producer that emits values to connected consumers.
+ */
+template <typename T>
+class ValueProducer : virtual public Observable {
+ public:
+  typedef T output_type;
+
+  ValueProducer() {}
+  ValueProducer(const T& initial_value) : output(initial_value) {}
+
+  virtual const T& get() const { return output; }
+
+  void connect_to(ValueConsumer<T>* consumer, uint8_t input_channel = 0) {
+    this->attach([this, consumer, input_channel]() {
+      consumer->set_input(this->output, input_channel);
+    });
+  }
+
+  void emit(T new_value) {
+    this->output = new_value;
+    this->notify();
+  }
+
+ protected:
+  T output;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_SYSTEM_VALUEPRODUCER_H_
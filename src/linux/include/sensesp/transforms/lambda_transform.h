@@ -0,0 +1,26 @@
+#ifndef SH_WG_LINUX_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
+#define SH_WG_LINUX_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
+
+#include <functional>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+template <class IN, class OUT>
+class LambdaTransform : public Transform<IN, OUT> {
+ public:
+  LambdaTransform(std::function<OUT(IN)> function, String config_path = "")
+      : Transform<IN, OUT>(config_path), function_{function} {}
+
+  void set_input(IN input, uint8_t /*input_channel*/ = 0) override {
+    this->emit(function_(input));
+  }
+
+ protected:
+  std::function<OUT(IN)> function_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
@@ -0,0 +1,37 @@
+#ifndef SH_WG_LINUX_SENSESP_TRANSFORMS_TRANSFORM_H_
+#define SH_WG_LINUX_SENSESP_TRANSFORMS_TRANSFORM_H_
+
+#include "sensesp.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+/**
+ * @brief Base class for transforms. The Linux build has no persistent
+ * configuration, so the config path is ignored.
+ */
+class TransformBase {
+ public:
+  TransformBase(String /*config_path*/ = "") {}
+
+  void load_configuration() {}
+};
+
+template <typename C, typename P>
+class Transform : public TransformBase,
+                  public ValueConsumer<C>,
+                  public ValueProducer<P> {
+ public:
+  Transform(String config_path = "") : TransformBase(config_path) {}
+};
+
+template <typename T>
+class SymmetricTransform : public Transform<T, T> {
+ public:
+  SymmetricTransform(String config_path = "") : Transform<T, T>(config_path) {}
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_TRANSFORMS_TRANSFORM_H_
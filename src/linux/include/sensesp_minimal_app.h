@@ -0,0 +1,23 @@
+#ifndef SH_WG_LINUX_SENSESP_MINIMAL_APP_H_
+#define SH_WG_LINUX_SENSESP_MINIMAL_APP_H_
+
+#include "sensesp.h"
+#include "sensesp/system/startable.h"
+
+namespace sensesp {
+
+class SensESPMinimalApp {
+ public:
+  SensESPMinimalApp(const String& hostname) : hostname_{hostname} {}
+
+  const String& get_hostname() { return hostname_; }
+
+  void start() { Startable::start_all(); }
+
+ protected:
+  String hostname_;
+};
+
+}  // namespace sensesp
+
+#endif  // SH_WG_LINUX_SENSESP_MINIMAL_APP_H_
@@ -0,0 +1,355 @@
+#ifdef SH_WG_LINUX
+
+// Linux entry point: runs the gateway pipeline as a daemon on a SocketCAN
+// interface. Example, using a virtual CAN interface:
+//
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+//   .pio/build/linux/program --can-interface vcan0
+
+#include <getopt.h>
+#include <signal.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "config.h"
+#include "gateway.h"
+#include "shwg.h"
+
+using namespace sensesp;
+
+reactesp::ReactESP app;
+
+SensESPMinimalApp *sensesp_app;
+
+Networking *networking;
+
+static volatile sig_atomic_t quit_requested = 0;
+
+static void HandleSignal(int /*signal*/) { quit_requested = 1; }
+
+static void PrintUsage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --can-interface NAME         SocketCAN interface (default can0)\n"
+          "  --serial-number N            NMEA 2000 unique number\n"
+          "  --ydwg-raw-tcp-port PORT     YDWG RAW TCP server port\n"
+          "  --ydwg-raw-tcp-rx            Receive YDWG RAW over TCP\n"
+          "  --ydwg-raw-udp-port PORT     YDWG RAW UDP port\n"
+          "  --ydwg-raw-udp-rx            Receive YDWG RAW over UDP\n"
+          "  --ydwg-raw-udp-multicast GROUP\n"
+          "                               Multicast YDWG RAW to GROUP\n"
+          "  --ydwg-raw-udp-unicast HOST[:PORT],...\n"
+          "                               Send YDWG RAW to the listed hosts\n"
+          "  --nmea0183-tcp-port PORT     NMEA 0183 TCP server port\n"
+          "  --nmea0183-udp-port PORT     NMEA 0183 UDP port\n"
+          "  --nmea0183-udp-multicast GROUP\n"
+          "                               Multicast NMEA 0183 to GROUP\n"
+          "  --nmea0183-udp-unicast HOST[:PORT],...\n"
+          "                               Send NMEA 0183 to the listed hosts\n"
+          "  --no-nmea0183                Disable NMEA 0183 translation\n"
+          "  --seasmart                   Enable SeaSmart.Net translation\n"
+          "  --ydwg-raw-tcp-client HOST[:PORT],...\n"
+          "                               Send YDWG RAW to the listed TCP\n"
+          "                               servers\n"
+          "  --nmea0183-tcp-client HOST[:PORT],...\n"
+          "                               Send NMEA 0183 to the listed TCP\n"
+          "                               servers\n"
+          "  --tcp-tx-buffer BYTES        TX buffer size per TCP client\n"
+          "  --tcp-tx-overflow POLICY     drop-oldest, drop-newest or "
+          "disconnect\n"
+          "  --tcp-refuse-when-full       Refuse new TCP clients instead of\n"
+          "                               evicting the idlest one\n"
+          "  --tcp-flush-deadline-ms MS   Maximum TCP write coalescing "
+          "delay\n"
+          "  --tcp-slow-client-percent PERCENT\n"
+          "                               TX buffer fill above which a TCP\n"
+          "                               client counts as slow\n"
+          "  --tcp-slow-client-timeout SECONDS\n"
+          "                               Disconnect clients slow for longer\n"
+          "  --tcp-client-backlog KB      Store-and-forward backlog of the\n"
+          "                               upstream TCP clients\n"
+          "  --tcp-client-backlog-file KB Spill the backlog to a file in "
+          "/tmp\n"
+          "  --tcp-client-replay-rate KBPS\n"
+          "                               Backlog replay rate (0 = "
+          "unlimited)\n"
+          "A port number of 0 disables the corresponding server.\n",
+          program);
+}
+
+int main(int argc, char **argv) {
+  enum {
+    kOptCANInterface = 1000,
+    kOptSerialNumber,
+    kOptYdwgRawTCPPort,
+    kOptYdwgRawTCPRx,
+    kOptYdwgRawUDPPort,
+    kOptYdwgRawUDPRx,
+    kOptYdwgRawUDPMulticast,
+    kOptYdwgRawUDPUnicast,
+    kOptNMEA0183TCPPort,
+    kOptNMEA0183UDPPort,
+    kOptNMEA0183UDPMulticast,
+    kOptNMEA0183UDPUnicast,
+    kOptNoNMEA0183,
+    kOptSeasmart,
+    kOptYdwgRawTCPClient,
+    kOptNMEA0183TCPClient,
+    kOptTCPTXBuffer,
+    kOptTCPTXOverflow,
+    kOptTCPRefuseWhenFull,
+    kOptTCPFlushDeadline,
+    kOptTCPSlowClientPercent,
+    kOptTCPSlowClientTimeout,
+    kOptTCPClientBacklog,
+    kOptTCPClientBacklogFile,
+    kOptTCPClientReplayRate,
+  };
+  static const struct option long_options[] = {
+      {"can-interface", required_argument, NULL, kOptCANInterface},
+      {"serial-number", required_argument, NULL, kOptSerialNumber},
+      {"ydwg-raw-tcp-port", required_argument, NULL, kOptYdwgRawTCPPort},
+      {"ydwg-raw-tcp-rx", no_argument, NULL, kOptYdwgRawTCPRx},
+      {"ydwg-raw-udp-port", required_argument, NULL, kOptYdwgRawUDPPort},
+      {"ydwg-raw-udp-rx", no_argument, NULL, kOptYdwgRawUDPRx},
+      {"ydwg-raw-udp-multicast", required_argument, NULL,
+       kOptYdwgRawUDPMulticast},
+      {"ydwg-raw-udp-unicast", required_argument, NULL, kOptYdwgRawUDPUnicast},
+      {"nmea0183-tcp-port", required_argument, NULL, kOptNMEA0183TCPPort},
+      {"nmea0183-udp-port", required_argument, NULL, kOptNMEA0183UDPPort},
+      {"nmea0183-udp-multicast", required_argument, NULL,
+       kOptNMEA0183UDPMulticast},
+      {"nmea0183-udp-unicast", required_argument, NULL,
+       kOptNMEA0183UDPUnicast},
+      {"no-nmea0183", no_argument, NULL, kOptNoNMEA0183},
+      {"seasmart", no_argument, NULL, kOptSeasmart},
+      {"ydwg-raw-tcp-client", required_argument, NULL, kOptYdwgRawTCPClient},
+      {"nmea0183-tcp-client", required_argument, NULL, kOptNMEA0183TCPClient},
+      {"tcp-tx-buffer", required_argument, NULL, kOptTCPTXBuffer},
+      {"tcp-tx-overflow", required_argument, NULL, kOptTCPTXOverflow},
+      {"tcp-refuse-when-full", no_argument, NULL, kOptTCPRefuseWhenFull},
+      {"tcp-flush-deadline-ms", required_argument, NULL, kOptTCPFlushDeadline},
+      {"tcp-slow-client-percent", required_argument, NULL,
+       kOptTCPSlowClientPercent},
+      {"tcp-slow-client-timeout", required_argument, NULL,
+       kOptTCPSlowClientTimeout},
+      {"tcp-client-backlog", required_argument, NULL, kOptTCPClientBacklog},
+      {"tcp-client-backlog-file", required_argument, NULL,
+       kOptTCPClientBacklogFile},
+      {"tcp-client-replay-rate", required_argument, NULL,
+       kOptTCPClientReplayRate},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+
+  const char *can_interface = "can0";
+  // parsed after all options, since they depend on the port options
+  String ydwg_raw_udp_destinations;
+  String nmea0183_udp_destinations;
+  uint64_t serial_number = 1;
+
+  GatewayConfig config;
+  config.ydwg_raw_tcp_port = kDefaultYdwgRawTCPServerPort;
+  config.ydwg_raw_udp_port = kDefaultYdwgRawUDPServerPort;
+  config.nmea0183_tcp_port = kDefaultNMEA0183TCPServerPort;
+  config.nmea0183_udp_port = kDefaultNMEA0183UDPServerPort;
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+    switch (opt) {
+      case kOptCANInterface:
+        can_interface = optarg;
+        break;
+      case kOptSerialNumber:
+        serial_number = strtoull(optarg, NULL, 10);
+        break;
+      case kOptYdwgRawTCPPort:
+        config.ydwg_raw_tcp_port = atoi(optarg);
+        break;
+      case kOptYdwgRawTCPRx:
+        config.ydwg_raw_tcp_rx_enabled = true;
+        break;
+      case kOptYdwgRawUDPPort:
+        config.ydwg_raw_udp_port = atoi(optarg);
+        break;
+      case kOptYdwgRawUDPRx:
+        config.ydwg_raw_udp_rx_enabled = true;
+        break;
+      case kOptYdwgRawUDPMulticast:
+        if (!config.ydwg_raw_udp_multicast_group.fromString(optarg)) {
+          fprintf(stderr, "Invalid multicast group: %s\n", optarg);
+          return 1;
+        }
+        config.ydwg_raw_udp_mode = UDPMode::kMulticast;
+        break;
+      case kOptYdwgRawUDPUnicast:
+        ydwg_raw_udp_destinations = optarg;
+        config.ydwg_raw_udp_mode = UDPMode::kUnicast;
+        break;
+      case kOptNMEA0183TCPPort:
+        config.nmea0183_tcp_port = atoi(optarg);
+        break;
+      case kOptNMEA0183UDPPort:
+        config.nmea0183_udp_port = atoi(optarg);
+        break;
+      case kOptNMEA0183UDPMulticast:
+        if (!config.nmea0183_udp_multicast_group.fromString(optarg)) {
+          fprintf(stderr, "Invalid multicast group: %s\n", optarg);
+          return 1;
+        }
+        config.nmea0183_udp_mode = UDPMode::kMulticast;
+        break;
+      case kOptNMEA0183UDPUnicast:
+        nmea0183_udp_destinations = optarg;
+        config.nmea0183_udp_mode = UDPMode::kUnicast;
+        break;
+      case kOptNoNMEA0183:
+        config.translate_to_nmea0183 = false;
+        break;
+      case kOptSeasmart:
+        config.translate_to_seasmart = true;
+        break;
+      case kOptYdwgRawTCPClient:
+        config.ydwg_raw_tcp_client_enabled = true;
+        if (!ParseHostPortList(optarg, kDefaultYdwgRawTCPServerPort,
+                               kMaxTCPClientTargets, "TCP client server",
+                               config.ydwg_raw_tcp_client_targets)) {
+          fprintf(stderr, "Invalid TCP client servers: %s\n", optarg);
+          return 1;
+        }
+        break;
+      case kOptNMEA0183TCPClient:
+        config.nmea0183_tcp_client_enabled = true;
+        if (!ParseHostPortList(optarg, kDefaultNMEA0183TCPServerPort,
+                               kMaxTCPClientTargets, "TCP client server",
+                               config.nmea0183_tcp_client_targets)) {
+          fprintf(stderr, "Invalid TCP client servers: %s\n", optarg);
+          return 1;
+        }
+        break;
+      case kOptTCPTXBuffer:
+        config.tcp_tx_buffer_size = strtoul(optarg, NULL, 10);
+        break;
+      case kOptTCPTXOverflow:
+        if (strcmp(optarg, "drop-oldest") == 0) {
+          config.tcp_tx_overflow_policy = TXOverflowPolicy::kDropOldest;
+        } else if (strcmp(optarg, "drop-newest") == 0) {
+          config.tcp_tx_overflow_policy = TXOverflowPolicy::kDropNewest;
+        } else if (strcmp(optarg, "disconnect") == 0) {
+          config.tcp_tx_overflow_policy = TXOverflowPolicy::kDisconnect;
+        } else {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        break;
+      case kOptTCPRefuseWhenFull:
+        config.tcp_evict_idlest_client = false;
+        break;
+      case kOptTCPFlushDeadline:
+        config.tcp_flush_deadline_ms = strtoul(optarg, NULL, 10);
+        break;
+      case kOptTCPSlowClientPercent:
+        config.tcp_slow_client_queue_percent = atoi(optarg);
+        break;
+      case kOptTCPSlowClientTimeout:
+        config.tcp_slow_client_timeout_ms = strtoul(optarg, NULL, 10) * 1000;
+        break;
+      case kOptTCPClientBacklog:
+        config.tcp_client_backlog_size = strtoul(optarg, NULL, 10) * 1024;
+        break;
+      case kOptTCPClientBacklogFile:
+        config.tcp_client_backlog_file_size =
+            strtoul(optarg, NULL, 10) * 1024;
+        break;
+      case kOptTCPClientReplayRate:
+        config.tcp_client_replay_rate = strtoul(optarg, NULL, 10) * 1024;
+        break;
+      default:
+        PrintUsage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (config.ydwg_raw_tcp_port == 0) {
+    config.ydwg_raw_tcp_tx_enabled = false;
+    config.ydwg_raw_tcp_rx_enabled = false;
+  }
+  if (config.ydwg_raw_udp_port == 0) {
+    config.ydwg_raw_udp_tx_enabled = false;
+    config.ydwg_raw_udp_rx_enabled = false;
+  }
+  config.nmea0183_tcp_enabled = config.nmea0183_tcp_port != 0;
+  config.nmea0183_udp_enabled = config.nmea0183_udp_port != 0;
+  if (!ParseUDPDestinations(ydwg_raw_udp_destinations,
+                            config.ydwg_raw_udp_port,
+                            config.ydwg_raw_udp_destinations) ||
+      !ParseUDPDestinations(nmea0183_udp_destinations,
+                            config.nmea0183_udp_port,
+                            config.nmea0183_udp_destinations)) {
+    fprintf(stderr, "Invalid UDP destinations\n");
+    return 1;
+  }
+
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  sensesp_app = new SensESPMinimalApp("sh-wg");
+  networking = new Networking();
+
+  nmea2000 = new tNMEA2000_FH(can_interface);
+  nmea2000->SetN2kCANMsgBufSize(kDefaultN2kCANMsgBufSize);
+  nmea2000->SetN2kCANReceiveFrameBufSize(kDefaultN2kCANReceiveFrameBufSize);
+  ConfigureNMEA2000(serial_number);
+  if (!nmea2000->Open()) {
+    fprintf(stderr, "Could not open CAN interface %s\n", can_interface);
+    return 1;
+  }
+
+  SetupConnections(config, networking);
+
+  app.onRepeat(1000, []() {
+    debugD("Uptime: %lu, CAN RX: %d CAN TX: %d RX burst peak: %d drops: %d",
+           (unsigned long)millis() / 1000, can_frame_rx_counter.load(),
+           can_frame_tx_counter.load(), nmea2000->GetRxQueueHighWater(),
+           nmea2000->GetRxQueueOverflows());
+  });
+
+  app.onRepeat(10000, []() {
+    for (auto queue : output_queues) {
+      debugD("%s queue: peak %u dropped AIS static %u, AIS dynamic %u, "
+             "other %u, navigation %u",
+             queue->get_name().c_str(), (unsigned)queue->get_high_water(),
+             queue->get_drop_count(TrafficClass::kAISStatic),
+             queue->get_drop_count(TrafficClass::kAISDynamic),
+             queue->get_drop_count(TrafficClass::kOther),
+             queue->get_drop_count(TrafficClass::kNavigation));
+    }
+    for (auto bridge : can_to_network_bridges) {
+      debugD("CAN to network queue: peak %u dropped %u",
+             (unsigned)bridge->get_high_water(), bridge->get_drop_count());
+    }
+    if (network_to_can_bridge != nullptr) {
+      debugD("Network to CAN queue: peak %u dropped %u",
+             (unsigned)network_to_can_bridge->get_high_water(),
+             network_to_can_bridge->get_drop_count());
+    }
+  });
+
+  // Handle incoming NMEA 2000 frames as soon as they arrive, and run the
+  // library's periodic tasks even when the bus is quiet.
+  app.onReadable(nmea2000->GetSocket(), []() { nmea2000->ParseMessages(); });
+  app.onRepeat(10, []() { nmea2000->ParseMessages(); });
+
+  sensesp_app->start();
+  StartNetworkTask();
+
+  while (!quit_requested) {
+    app.tick();
+  }
+
+  return 0;
+}
+
+#endif  // SH_WG_LINUX
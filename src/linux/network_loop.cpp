@@ -0,0 +1,80 @@
+#ifdef SH_WG_LINUX
+
+// epoll based implementation of the NetworkLoop platform functions, with an
+// eventfd as the wake signal.
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+
+#include "network_loop.h"
+
+void NetworkLoop::init_platform() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) < 0) {
+    perror("epoll_ctl");
+  }
+}
+
+static uint32_t EpollEvents(bool write_interest) {
+  return write_interest ? EPOLLIN | EPOLLOUT : EPOLLIN;
+}
+
+void NetworkLoop::add_platform_watch(Watch* watch) {
+  struct epoll_event event = {};
+  event.events = EpollEvents(watch->write_interest);
+  event.data.ptr = watch;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, watch->fd, &event) < 0) {
+    perror("epoll_ctl");
+  }
+}
+
+void NetworkLoop::update_platform_watch(Watch* watch) {
+  struct epoll_event event = {};
+  event.events = EpollEvents(watch->write_interest);
+  event.data.ptr = watch;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, watch->fd, &event);
+}
+
+void NetworkLoop::remove_platform_watch(Watch* watch) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, watch->fd, nullptr);
+}
+
+void NetworkLoop::signal_wake() {
+  uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0) {
+    perror("eventfd write");
+  }
+}
+
+int NetworkLoop::wait(int timeout_ms) {
+  constexpr int kMaxEvents = 32;
+  struct epoll_event events[kMaxEvents];
+
+  int num_events = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+  for (int i = 0; i < num_events; i++) {
+    Watch* watch = static_cast<Watch*>(events[i].data.ptr);
+    if (watch == nullptr) {
+      uint64_t count;
+      if (read(wake_fd_, &count, sizeof(count)) < 0) {
+        perror("eventfd read");
+      }
+      continue;
+    }
+    // removed watches stay allocated until the end of the iteration
+    uint32_t flags = events[i].events;
+    dispatch(watch, flags & (EPOLLIN | EPOLLHUP | EPOLLERR), flags & EPOLLOUT);
+  }
+  return num_events < 0 ? 0 : num_events;
+}
+
+void NetworkLoop::tick_timers() { app_->tick(0); }
+
+#endif  // SH_WG_LINUX
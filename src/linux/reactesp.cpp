@@ -0,0 +1,154 @@
+#ifdef SH_WG_LINUX
+
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#include "Arduino.h"
+#include "ReactESP.h"
+
+namespace reactesp {
+
+ReactESP* ReactESP::app = nullptr;
+
+static uint64_t MonotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void Reaction::remove() { app_->remove(this); }
+
+ReactESP::ReactESP(bool singleton) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (singleton) {
+    app = this;
+  }
+}
+
+Reaction* ReactESP::add(Reaction* reaction) {
+  reaction->next_us_ = MonotonicMicros() + reaction->interval_us_;
+  reactions_.push_back(reaction);
+  return reaction;
+}
+
+DelayReaction* ReactESP::onDelay(uint32_t t, react_callback cb) {
+  return add(new Reaction(this, Reaction::Type::kDelay, 1000ULL * t, cb));
+}
+
+DelayReaction* ReactESP::onDelayMicros(uint64_t t, react_callback cb) {
+  return add(new Reaction(this, Reaction::Type::kDelay, t, cb));
+}
+
+RepeatReaction* ReactESP::onRepeat(uint32_t t, react_callback cb) {
+  return add(new Reaction(this, Reaction::Type::kRepeat, 1000ULL * t, cb));
+}
+
+RepeatReaction* ReactESP::onRepeatMicros(uint64_t t, react_callback cb) {
+  return add(new Reaction(this, Reaction::Type::kRepeat, t, cb));
+}
+
+TickReaction* ReactESP::onTick(react_callback cb) {
+  return add(new Reaction(this, Reaction::Type::kTick, 0, cb));
+}
+
+Reaction* ReactESP::onReadable(int fd, react_callback cb) {
+  Reaction* reaction = new Reaction(this, Reaction::Type::kReadable, 0, cb);
+  reaction->fd_ = fd;
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = reaction;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    perror("epoll_ctl");
+  }
+  return add(reaction);
+}
+
+void ReactESP::remove(Reaction* reaction) {
+  if (reaction->type_ == Reaction::Type::kReadable && !reaction->removed_) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, reaction->fd_, nullptr);
+  }
+  // the reaction is deleted at the end of the current tick
+  reaction->removed_ = true;
+}
+
+int ReactESP::get_timeout_ms(uint64_t now_us) {
+  // never sleep longer than this, so that reactions added from callbacks
+  // are picked up in reasonable time
+  uint64_t timeout_us = 100000;
+  for (Reaction* reaction : reactions_) {
+    if (reaction->removed_ || reaction->type_ == Reaction::Type::kReadable) {
+      continue;
+    }
+    if (reaction->type_ == Reaction::Type::kTick ||
+        reaction->next_us_ <= now_us) {
+      return 0;
+    }
+    timeout_us = std::min(timeout_us, reaction->next_us_ - now_us);
+  }
+  // epoll only has millisecond resolution; spin for sub-millisecond waits
+  return timeout_us < 1000 ? 0 : timeout_us / 1000;
+}
+
+void ReactESP::tick() { tick(get_timeout_ms(MonotonicMicros())); }
+
+void ReactESP::tick(int max_wait_ms) {
+  constexpr int kMaxEvents = 32;
+  struct epoll_event events[kMaxEvents];
+
+  int timeout_ms = std::min(max_wait_ms, get_timeout_ms(MonotonicMicros()));
+  int num_events = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+  for (int i = 0; i < num_events; i++) {
+    Reaction* reaction = static_cast<Reaction*>(events[i].data.ptr);
+    if (!reaction->removed_) {
+      reaction->callback_();
+    }
+  }
+
+  // callbacks may add new reactions; only process the ones present now
+  size_t num_reactions = reactions_.size();
+  for (size_t i = 0; i < num_reactions; i++) {
+    Reaction* reaction = reactions_[i];
+    if (reaction->removed_ || reaction->type_ == Reaction::Type::kReadable) {
+      continue;
+    }
+    uint64_t now_us = MonotonicMicros();
+    if (reaction->type_ != Reaction::Type::kTick &&
+        reaction->next_us_ > now_us) {
+      continue;
+    }
+    reaction->callback_();
+    switch (reaction->type_) {
+      case Reaction::Type::kDelay:
+        reaction->removed_ = true;
+        break;
+      case Reaction::Type::kRepeat:
+        reaction->next_us_ += reaction->interval_us_;
+        if (reaction->next_us_ < now_us) {
+          // don't try to catch up after a stall
+          reaction->next_us_ = now_us + reaction->interval_us_;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  auto removed_end = std::remove_if(
+      reactions_.begin(), reactions_.end(), [](Reaction* reaction) {
+        if (reaction->removed_) {
+          delete reaction;
+          return true;
+        }
+        return false;
+      });
+  reactions_.erase(removed_end, reactions_.end());
+}
+
+}  // namespace reactesp
+
+#endif  // SH_WG_LINUX
@@ -0,0 +1,201 @@
+#ifdef SH_WG_LINUX
+
+#include <WiFi.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "sensesp.h"
+
+// Maximum time a write may block waiting for socket buffer space, as on the
+// ESP32 WiFiClient.
+static constexpr int kWriteTimeoutMs = 3000;
+
+static void SetNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+SocketHandle::~SocketHandle() { close(fd_); }
+
+WiFiClient::WiFiClient(int fd) : socket_{std::make_shared<SocketHandle>(fd)} {
+  SetNonBlocking(fd);
+  int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeout_ms) {
+  stop();
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result;
+  char port_str[8];
+  snprintf(port_str, sizeof(port_str), "%u", port);
+  if (getaddrinfo(host, port_str, &hints, &result) != 0) {
+    debugW("Could not resolve %s", host);
+    return 0;
+  }
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  SetNonBlocking(fd);
+  int retval = ::connect(fd, result->ai_addr, result->ai_addrlen);
+  freeaddrinfo(result);
+  if (retval < 0 && errno != EINPROGRESS) {
+    close(fd);
+    return 0;
+  }
+
+  struct pollfd pfd = {fd, POLLOUT, 0};
+  int error = 0;
+  socklen_t error_len = sizeof(error);
+  if (poll(&pfd, 1, timeout_ms) != 1 ||
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 ||
+      error != 0) {
+    close(fd);
+    return 0;
+  }
+
+  *this = WiFiClient(fd);
+  return 1;
+}
+
+void WiFiClient::stop() { socket_.reset(); }
+
+uint8_t WiFiClient::connected() {
+  if (!socket_) {
+    return 0;
+  }
+  char c;
+  int retval = recv(socket_->fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (retval == 0) {
+    // orderly shutdown by the peer
+    return 0;
+  }
+  if (retval < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    return 0;
+  }
+  return 1;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+  if (!socket_) {
+    return -1;
+  }
+  int enable = nodelay ? 1 : 0;
+  return setsockopt(socket_->fd(), IPPROTO_TCP, TCP_NODELAY, &enable,
+                    sizeof(enable));
+}
+
+int WiFiClient::available() {
+  if (!socket_) {
+    return 0;
+  }
+  int count = 0;
+  if (ioctl(socket_->fd(), FIONREAD, &count) < 0) {
+    return 0;
+  }
+  return count;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  if (read(&c, 1) == 1) {
+    return c;
+  }
+  return -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+  if (!socket_) {
+    return -1;
+  }
+  return recv(socket_->fd(), buf, size, MSG_DONTWAIT);
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+  if (!socket_) {
+    return 0;
+  }
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t retval =
+        send(socket_->fd(), buf + sent, size - sent, MSG_NOSIGNAL);
+    if (retval > 0) {
+      sent += retval;
+    } else if (retval < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct pollfd pfd = {socket_->fd(), POLLOUT, 0};
+      if (poll(&pfd, 1, kWriteTimeoutMs) != 1) {
+        break;
+      }
+    } else {
+      break;
+    }
+  }
+  return sent;
+}
+
+void WiFiServer::begin() {
+  if (listen_fd_ >= 0) {
+    return;
+  }
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  int enable = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port_);
+  if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(listen_fd_, 8) < 0) {
+    debugE("Could not listen on port %d: %s", port_, strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return;
+  }
+  SetNonBlocking(listen_fd_);
+}
+
+void WiFiServer::end() {
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+}
+
+WiFiClient WiFiServer::available() {
+  if (listen_fd_ < 0) {
+    return WiFiClient();
+  }
+  int fd = accept(listen_fd_, nullptr, nullptr);
+  if (fd < 0) {
+    return WiFiClient();
+  }
+  return WiFiClient(fd);
+}
+
+WiFiClass WiFi;
+
+int WiFiClass::hostByName(const char* hostname, IPAddress& result) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  struct addrinfo* addresses;
+  if (getaddrinfo(hostname, NULL, &hints, &addresses) != 0) {
+    return 0;
+  }
+  result =
+      IPAddress(((struct sockaddr_in*)addresses->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(addresses);
+  return 1;
+}
+
+#endif  // SH_WG_LINUX
@@ -15,17 +15,14 @@
 #include <memory>
 
 #include "N2kMessages.h"
-#include "NMEA2000/NMEA2000_esp32_framehandler.h"
+#include "NMEA2000/NMEA2000_framehandler.h"
 #include "NMEA2000_CAN.h"
 #include "can_frame.h"
-#include "concatenate_strings.h"
 #include "config.h"
-#include "filter_transform.h"
 #include "firmware_info.h"
-#include "n2k_nmea0183_transform.h"
+#include "gateway.h"
 #include "origin_string.h"
 #include "ota_update_task.h"
-#include "seasmart_transform.h"
 #include "sensesp/net/discovery.h"
 #include "sensesp/net/http_server.h"
 #include "sensesp/net/networking.h"
@@ -37,47 +34,11 @@
 #include "shwg.h"
 #include "shwg_button.h"
 #include "shwg_factory_test.h"
-#include "streaming_tcp_client.h"
-#include "streaming_tcp_server.h"
-#include "streaming_udp_server.h"
-#include "stringtokenizer_transform.h"
 #include "time_string.h"
 #include "ui_controls.h"
-#include "ydwg_raw_output.h"
-#include "ydwg_raw_parser.h"
 
 using namespace sensesp;
 
-// Set the information for other bus devices, which messages we support
-const unsigned long kTransmitMessages[] = {0};
-const unsigned long ReceiveMessages[] = {
-    /*126992L,*/  // System time
-    127250L,      // Heading
-    127258L,      // Magnetic variation
-    128259UL,     // Boat speed
-    128267UL,     // Depth
-    129025UL,     // Position
-    129026L,      // COG and SOG
-    129029L,      // GNSS
-    130306L,      // Wind
-    129038L,      // AIS Class A Position Report, Message Type 1
-    129039L,      // AIS Class B Position Report, Message Type 18
-    12979UL,  // AIS Class A Ship Static and Voyage related data, Message Type 5
-    129809L,  // AIS Class B "CS" Static Data Report, Part A
-    129810L,  // AIS Class B "CS" Static Data Report, Part B
-    0};
-
-tNMEA2000_esp32_FH *nmea2000;
-
-StreamingTCPServer *nmea0183_tcp_server;
-StreamingTCPServer *ydwg_raw_tcp_server;
-
-StreamingUDPServer *nmea0183_udp_server;
-StreamingUDPServer *ydwg_raw_udp_server;
-
-StreamingTCPClient *ydwg_raw_tcp_client;
-StreamingTCPClient *nmea0183_tcp_client;
-
 // time elapsed since last system time update
 elapsedMillis elapsed_since_last_system_time_update = kTimeUpdatePeriodMs;
 
@@ -90,12 +51,15 @@ Networking *networking;
 CheckboxConfig *checkbox_config_enable_firmware_updates;
 BiDiPortConfig *port_config_ydwg_raw_tcp;
 HostPortConfig *port_config_ydwg_raw_tcp_client;
-BiDiPortConfig *port_config_ydwg_raw_udp;
+UDPBiDiPortConfig *port_config_ydwg_raw_udp;
 CheckboxConfig *checkbox_config_translate_to_seasmart;
 CheckboxConfig *checkbox_config_translate_to_nmea0183;
 PortConfig *port_config_nmea0183_tcp_tx;
 HostPortConfig *port_config_nmea0183_tcp_client;
-PortConfig *port_config_nmea0183_udp_tx;
+UDPPortConfig *port_config_nmea0183_udp_tx;
+CANBufferConfig *can_buffer_config;
+TCPClientBufferConfig *tcp_client_buffer_config;
+TCPClientBacklogConfig *tcp_client_backlog_config;
 
 UIOutput<String> ui_output_firmware_name("Firmware name", kFirmwareName,
                                          "Firmware", 100);
@@ -115,17 +79,139 @@ UILambdaOutput<String> ui_output_wifi_ssid =
 UILambdaOutput<int8_t> ui_output_wifi_rssi = UILambdaOutput<int8_t>(
     "WiFi signal strength (dB)", []() { return WiFi.RSSI(); }, "WiFi", 240);
 
-uint32_t can_frame_rx_counter = 0;
-uint32_t can_frame_tx_counter = 0;
-
 UILambdaOutput<uint32_t> ui_output_can_frame_rx_counter(
-    "CAN frame RX counter", []() { return can_frame_rx_counter; }, "NMEA 2000",
+    "CAN frame RX counter",
+    []() { return can_frame_rx_counter.load(); }, "NMEA 2000",
     300);
 
 UILambdaOutput<uint32_t> ui_output_can_frame_tx_counter(
-    "CAN frame TX counter", []() { return can_frame_tx_counter; }, "NMEA 2000",
+    "CAN frame TX counter",
+    []() { return can_frame_tx_counter.load(); }, "NMEA 2000",
     310);
 
+UILambdaOutput<uint16_t> ui_output_can_rx_queue_size(
+    "CAN RX buffer size", []() { return nmea2000->GetRxQueueSize(); },
+    "NMEA 2000", 320);
+
+UILambdaOutput<uint32_t> ui_output_can_rx_queue_high_water(
+    "CAN RX buffer high-water",
+    []() { return nmea2000->GetRxQueueHighWater(); }, "NMEA 2000", 330);
+
+UILambdaOutput<uint32_t> ui_output_can_rx_queue_overflows(
+    "CAN RX buffer overflows",
+    []() { return nmea2000->GetRxQueueOverflows(); }, "NMEA 2000", 340);
+
+UILambdaOutput<uint16_t> ui_output_n2k_msg_pool_high_water(
+    "N2K message pool high-water",
+    []() { return (uint16_t)n2k_msg_pool.get_high_water(); }, "NMEA 2000",
+    342);
+
+UILambdaOutput<uint32_t> ui_output_n2k_msg_pool_exhausted(
+    "N2K messages dropped (pool exhausted)",
+    []() { return n2k_msg_pool.get_exhausted_count(); }, "NMEA 2000", 344);
+
+UILambdaOutput<uint32_t> ui_output_udp_rx_dropped(
+    "UDP packets dropped (buffers exhausted)",
+    []() {
+      return ydwg_raw_udp_server == nullptr
+                 ? 0
+                 : ydwg_raw_udp_server->get_rx_drop_count();
+    },
+    "Network inputs", 346);
+
+UILambdaOutput<uint32_t> ui_output_dropped_ais_static(
+    "Dropped AIS static",
+    []() {
+      return OutputQueue::get_total_drop_count(TrafficClass::kAISStatic);
+    },
+    "Network outputs", 350);
+
+UILambdaOutput<uint32_t> ui_output_dropped_ais_dynamic(
+    "Dropped AIS dynamic",
+    []() {
+      return OutputQueue::get_total_drop_count(TrafficClass::kAISDynamic);
+    },
+    "Network outputs", 360);
+
+UILambdaOutput<uint32_t> ui_output_dropped_other(
+    "Dropped other",
+    []() { return OutputQueue::get_total_drop_count(TrafficClass::kOther); },
+    "Network outputs", 370);
+
+UILambdaOutput<uint32_t> ui_output_dropped_navigation(
+    "Dropped navigation",
+    []() {
+      return OutputQueue::get_total_drop_count(TrafficClass::kNavigation);
+    },
+    "Network outputs", 380);
+
+UILambdaOutput<uint32_t> ui_output_dropped_between_tasks(
+    "Dropped between CAN and network tasks",
+    []() {
+      uint32_t drops = network_to_can_bridge == nullptr
+                           ? 0
+                           : network_to_can_bridge->get_drop_count();
+      for (auto bridge : can_to_network_bridges) {
+        drops += bridge->get_drop_count();
+      }
+      return drops;
+    },
+    "Network outputs", 390);
+
+UILambdaOutput<String> ui_output_ydwg_raw_tcp_clients(
+    "YDWG RAW TCP clients",
+    []() {
+      return ydwg_raw_tcp_server == nullptr
+                 ? String("")
+                 : ydwg_raw_tcp_server->get_stats_summary();
+    },
+    "TCP clients", 392);
+
+UILambdaOutput<String> ui_output_nmea0183_tcp_clients(
+    "NMEA 0183 TCP clients",
+    []() {
+      return nmea0183_tcp_server == nullptr
+                 ? String("")
+                 : nmea0183_tcp_server->get_stats_summary();
+    },
+    "TCP clients", 394);
+
+UILambdaOutput<String> ui_output_ydwg_raw_udp_destinations(
+    "YDWG RAW UDP destinations",
+    []() {
+      return ydwg_raw_udp_unicast_output == nullptr
+                 ? String("Not in unicast mode")
+                 : ydwg_raw_udp_unicast_output->get_stats_summary();
+    },
+    "UDP destinations", 395);
+
+UILambdaOutput<String> ui_output_nmea0183_udp_destinations(
+    "NMEA 0183 UDP destinations",
+    []() {
+      return nmea0183_udp_unicast_output == nullptr
+                 ? String("Not in unicast mode")
+                 : nmea0183_udp_unicast_output->get_stats_summary();
+    },
+    "UDP destinations", 396);
+
+UILambdaOutput<String> ui_output_ydwg_raw_tcp_client(
+    "YDWG RAW TCP client",
+    []() {
+      return ydwg_raw_tcp_clients == nullptr
+                 ? String("Disabled")
+                 : ydwg_raw_tcp_clients->get_stats_summary();
+    },
+    "Upstream TCP", 397);
+
+UILambdaOutput<String> ui_output_nmea0183_tcp_client(
+    "NMEA 0183 TCP client",
+    []() {
+      return nmea0183_tcp_clients == nullptr
+                 ? String("Disabled")
+                 : nmea0183_tcp_clients->get_stats_summary();
+    },
+    "Upstream TCP", 398);
+
 UILambdaOutput<int> ui_output_uptime(
     "Uptime", []() { return millis() / 1000; }, "Runtime", 400);
 
@@ -172,71 +258,50 @@ void SetSystemTime(const tN2kMsg &n2k_msg) {
   }
 }
 
-ObservableValue<tN2kMsg> n2k_msg_input;
-ObservableValue<CANFrame> can_frame_input;
-
-// All CAN frame producers and consumers connect to the clearinghouse
-LambdaTransform<CANFrame, CANFrame> *can_frame_clearinghouse;
-
-// Consumer that will send CAN frames to the NMEA 2000 bus
-LambdaConsumer<CANFrame> *can_frame_sender;
+/**
+ * @brief Get the CAN receive frame buffer size.
+ *
+ * With automatic sizing, the buffer is made twice as large as the peak queue
+ * depth seen so far, but never smaller than the default and never larger than
+ * a fixed fraction of the free heap. Either size is limited to
+ * kMaxN2kCANReceiveFrameBufSize.
+ */
+uint16_t GetN2kCANReceiveFrameBufSize() {
+  size_t size;
+  if (!can_buffer_config->get_auto_size()) {
+    size = can_buffer_config->get_rx_frame_buf_size();
+  } else {
+    size = 2 * can_buffer_config->get_observed_peak();
+    if (size < kDefaultN2kCANReceiveFrameBufSize) {
+      size = kDefaultN2kCANReceiveFrameBufSize;
+    }
+    size_t heap_budget = ESP.getFreeHeap() / kN2kCANRxQueueHeapDivisor /
+                         kN2kCANFrameQueueItemSize;
+    if (size > heap_budget) {
+      size = heap_budget;
+    }
+  }
+  if (size > kMaxN2kCANReceiveFrameBufSize) {
+    size = kMaxN2kCANReceiveFrameBufSize;
+  }
+  // the driver can't create an empty queue
+  if (size < 1) {
+    size = 1;
+  }
+  return size;
+}
 
 void InitNMEA2000() {
-  nmea2000->SetN2kCANMsgBufSize(8);
-  nmea2000->SetN2kCANReceiveFrameBufSize(100);
+  uint16_t rx_frame_buf_size = GetN2kCANReceiveFrameBufSize();
+  debugD("CAN RX frame buffer size: %d", rx_frame_buf_size);
+  nmea2000->SetN2kCANMsgBufSize(can_buffer_config->get_msg_buf_size());
+  nmea2000->SetN2kCANReceiveFrameBufSize(rx_frame_buf_size);
   //  nmea2000->SetForwardStream(&Serial);  // PC output on due native port
   //  nmea2000->SetForwardType(tNMEA2000::fwdt_Text); // Show in clear text
   // nmea2000->EnableForward(false);                 // Disable all msg
   // forwarding to USB (=Serial)
 
-  char serial_number_str[33];  // Model serial code in N2K is 32 characters
-  uint64_t serial_number = GetBoardSerialNumber();
-  snprintf(serial_number_str, 32, "%" PRIu64, (long unsigned int)serial_number);
-
-  nmea2000->SetProductInformation(
-      serial_number_str,  // Manufacturer's Model serial code
-      130,                // Manufacturer's product code
-      "SH-wg",            // Manufacturer's Model ID
-      kFirmwareVersion,   // Manufacturer's Software version code
-      "1.0.0"             // Manufacturer's Model version
-  );
-  // Det device information
-  nmea2000->SetDeviceInformation(
-      serial_number,  // Unique number. Use e.g. Serial number.
-      130,            // Device function=PC Gateway. See codes on
-            // http://www.nmea.org/Assets/20120726%20nmea%202000%20class%20%26%20function%20codes%20v%202.00.pdf
-      25,  // Device class=Inter/Intranetwork Device. See codes on
-           // http://www.nmea.org/Assets/20120726%20nmea%202000%20class%20%26%20function%20codes%20v%202.00.pdf
-      2046  // Just choosen free from code list on
-            // http://www.nmea.org/Assets/20121020%20nmea%202000%20registration%20list.pdf
-  );
-
-  nmea2000->SetForwardType(
-      tNMEA2000::fwdt_Text);  // Show in clear text. Leave uncommented for
-                              // default Actisense format.
-  nmea2000->SetMode(tNMEA2000::N2km_ListenAndNode, 32);
-  // nmea2000->EnableForward(false);
-
-  nmea2000->ExtendTransmitMessages(kTransmitMessages);
-  nmea2000->ExtendReceiveMessages(ReceiveMessages);
-
-  nmea2000->SetCANFrameHandler([](bool &has_frame, unsigned long &can_id,
-                                  unsigned char &len, unsigned char *buf) {
-    struct CANFrame frame;
-    if (has_frame) {
-      frame.id = can_id;
-      frame.len = len;
-      memcpy(frame.buf, buf, len);
-      frame.origin_type = CANFrameOriginType::kLocal;
-      frame.origin_id = origin_id(nmea2000);
-      can_frame_input.set(frame);
-    }
-  });
-  nmea2000->SetMsgHandler(
-      [](const tN2kMsg &n2k_msg) { n2k_msg_input.set(n2k_msg); });
-
-  can_frame_input.connect_to(new LambdaConsumer<CANFrame>(
-      [](CANFrame frame) { can_frame_rx_counter++; }));
+  ConfigureNMEA2000(GetBoardSerialNumber());
 
   nmea2000->Open();
 }
@@ -288,181 +353,93 @@ static void SetupYellowLEDBlinker(
       }));
 }
 
-static void SetupConnections() {
-  can_frame_clearinghouse = new LambdaTransform<CANFrame, CANFrame>(
-      [](const CANFrame &frame) { return frame; });
-
-  auto can_to_ydwg_transform =
-      new LambdaTransform<CANFrame, OriginString>([](CANFrame frame) {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        OriginString origin_string = CANFrameToYDWGRaw(frame, tv);
-        return origin_string;
-      });
-
-  can_frame_sender = new LambdaConsumer<CANFrame>([](CANFrame frame) {
-    // debugD("Sending CAN Frame with ID %d and length %d", frame.id,
-    // frame.len);
-
-    if (frame.origin_id == origin_id(nmea2000)) {
-      // ignore frames that we just received
-      return;
-    }
-
-    if (frame.origin_type == CANFrameOriginType::kRemoteApp) {
-      // Ignore YDWG RAW messages with 'T' direction
-      return;
-    }
-    can_frame_tx_counter++;
-    if (frame.origin_type == CANFrameOriginType::kApp) {
-      // Application format messages need to have their source address
-      // replaced with our own source address.
-
-      unsigned char our_source = nmea2000->GetN2kSource(0);
-      uint32_t frame_id = frame.id;
-      // clear existing source address
-      frame_id &= ~0xFF;
-      // set new source address
-      frame_id |= our_source;
-
-      frame.id = frame_id;
-    }
-    nmea2000->CANSendFrame(frame.id, frame.len, frame.buf);
-  });
-
-  auto concatenate_ydwg_strings = new ConcatenateStrings(100, 1000);
-  auto concatenate_n0183_strings = new ConcatenateStrings(100, 1000);
-
-  auto string_tokenizer = new StringTokenizer("\r\n");
-
-  auto n2k_to_0183_transform = new N2KTo0183Transform(nmea2000);
-  auto n2k_to_seasmart_transform = new SeasmartTransform(nmea2000);
-  auto ydwg_raw_to_can_transform = new YDWGRawToCANFrameTransform();
-
-  can_to_ydwg_transform->connect_to(concatenate_ydwg_strings);
-  string_tokenizer->connect_to(ydwg_raw_to_can_transform);
-
-  //////
-  // N2K message routing
-
-  // if configured, connect the N2K input to NMEA 0183 transform
-
-  if (checkbox_config_translate_to_nmea0183->get_value()) {
-    // the message handler called within this consumer will write its output
-    // to nmea0183_msg_observable
-    debugD("Connecting N2K to NMEA 0183");
-    n2k_msg_input.connect_to(n2k_to_0183_transform);
-  }
-
-  // if configured, connect the N2K input to Seasmart transform
-
-  if (checkbox_config_translate_to_seasmart->get_value()) {
-    debugD("Connecting N2K to Seasmart");
-    n2k_msg_input.connect_to(n2k_to_seasmart_transform);
-  }
-
-  //////
-  // CAN frame routing
-
-  can_frame_input.connect_to(can_frame_clearinghouse);
-  can_frame_clearinghouse->connect_to(can_frame_sender);
-  ydwg_raw_to_can_transform->connect_to(can_frame_clearinghouse);
-
-  // set up the YDWG RAW TCP server
-
-  debugD("Setting up YDWG RAW TCP server");
-  int ydwg_raw_tcp_port = port_config_ydwg_raw_tcp->get_port();
-  ydwg_raw_tcp_server = new StreamingTCPServer(ydwg_raw_tcp_port, networking);
-  if (!port_config_ydwg_raw_tcp->get_tx_enabled() &&
-      !port_config_ydwg_raw_tcp->get_rx_enabled()) {
-    ydwg_raw_tcp_server->set_enabled(false);
-  }
-
-  // set up the YDWG RAW UDP server
-
-  debugD("Setting up YDWG RAW UDP server");
-  int ydwg_raw_udp_port = port_config_ydwg_raw_udp->get_port();
-  ydwg_raw_udp_server = new StreamingUDPServer(ydwg_raw_udp_port, networking);
-  if (!port_config_ydwg_raw_udp->get_tx_enabled() &&
-      !port_config_ydwg_raw_udp->get_rx_enabled()) {
-    ydwg_raw_udp_server->set_enabled(false);
-  }
-
-  // set up the NMEA 0183 TCP server
-
-  debugD("Setting up NMEA 0183 TCP server");
-  int nmea0183_tcp_port = port_config_nmea0183_tcp_tx->get_port();
-  nmea0183_tcp_server = new StreamingTCPServer(nmea0183_tcp_port, networking);
-  nmea0183_tcp_server->set_enabled(port_config_nmea0183_tcp_tx->get_enabled());
-
-  // set up the NMEA 0183 UDP server
-
-  debugD("Setting up NMEA 0183 UDP server");
-  int nmea0183_udp_port = port_config_nmea0183_udp_tx->get_port();
-  nmea0183_udp_server = new StreamingUDPServer(nmea0183_udp_port, networking);
-  nmea0183_udp_server->set_enabled(port_config_nmea0183_udp_tx->get_enabled());
-
-  // send the generated NMEA 0183 message
-  if (checkbox_config_translate_to_nmea0183->get_value()) {
-    debugD("Connecting NMEA 0183 to consumers");
-    n2k_to_0183_transform->connect_to(nmea0183_tcp_server);
-    n2k_to_0183_transform->connect_to(concatenate_n0183_strings);
-    concatenate_n0183_strings->connect_to(nmea0183_udp_server);
-  }
-
-  // send the generated SeaSmart message
-  if (checkbox_config_translate_to_seasmart->get_value()) {
-    debugD("Connecting Seasmart to consumers");
-    n2k_to_seasmart_transform->connect_to(nmea0183_tcp_server);
-    n2k_to_seasmart_transform->connect_to(concatenate_n0183_strings);
-  }
-
-  // set up a YDWG RAW TCP client
-  if (port_config_ydwg_raw_tcp_client->get_enabled()) {
-    String ydwg_raw_tcp_client_host =
-        port_config_ydwg_raw_tcp_client->get_host();
-    int ydwg_raw_tcp_client_port = port_config_ydwg_raw_tcp_client->get_port();
-    ydwg_raw_tcp_client = new StreamingTCPClient(
-        ydwg_raw_tcp_client_host, ydwg_raw_tcp_client_port, networking);
-    can_to_ydwg_transform->connect_to(ydwg_raw_tcp_client);
-    ydwg_raw_tcp_client->connect_to(string_tokenizer);
-  }
-
-  // set up an NMEA 0183 TCP client
-  if (port_config_nmea0183_tcp_client->get_enabled()) {
-    String nmea0183_tcp_client_host =
-        port_config_nmea0183_tcp_client->get_host();
-    int nmea0183_tcp_client_port = port_config_nmea0183_tcp_client->get_port();
-    nmea0183_tcp_client = new StreamingTCPClient(
-        nmea0183_tcp_client_host, nmea0183_tcp_client_port, networking);
-    n2k_to_0183_transform->connect_to(nmea0183_tcp_client);
-  }
-
-  // connect the CAN frame input to the YDWG raw transform
-  debugD("Connecting CAN input to YDWG raw transform");
-  can_frame_clearinghouse->connect_to(can_to_ydwg_transform);
-
-  if (port_config_ydwg_raw_tcp->get_tx_enabled()) {
-    debugD("Connecting YDWG RAW TX to TCP server");
-    can_to_ydwg_transform->connect_to(ydwg_raw_tcp_server);
-  }
-
-  if (port_config_ydwg_raw_tcp->get_rx_enabled()) {
-    debugD("Connecting TCP server to YDWG RAW RX");
-    ydwg_raw_tcp_server->connect_to(ydwg_raw_to_can_transform);
-  }
-
-  if (port_config_ydwg_raw_udp->get_tx_enabled()) {
-    debugD("Connecting YDWG RAW to UDP TX");
-    SetupYellowLEDBlinker(can_to_ydwg_transform);
-
-    concatenate_ydwg_strings->connect_to(ydwg_raw_udp_server);
-  }
-
-  if (port_config_ydwg_raw_udp->get_rx_enabled()) {
-    debugD("Connecting UDP RX to YDWG RAW");
-    ydwg_raw_udp_server->connect_to(string_tokenizer);
-  }
+/**
+ * @brief Collect the gateway routing configuration from the UI controls.
+ */
+static GatewayConfig GetGatewayConfig() {
+  GatewayConfig config;
+
+  config.ydwg_raw_tcp_tx_enabled = port_config_ydwg_raw_tcp->get_tx_enabled();
+  config.ydwg_raw_tcp_rx_enabled = port_config_ydwg_raw_tcp->get_rx_enabled();
+  config.ydwg_raw_tcp_port = port_config_ydwg_raw_tcp->get_port();
+  config.ydwg_raw_tcp_filter = port_config_ydwg_raw_tcp->get_pgn_filter();
+  config.ydwg_raw_tcp_rate_limits = port_config_ydwg_raw_tcp->get_rate_limits();
+
+  config.ydwg_raw_udp_tx_enabled = port_config_ydwg_raw_udp->get_tx_enabled();
+  config.ydwg_raw_udp_rx_enabled = port_config_ydwg_raw_udp->get_rx_enabled();
+  config.ydwg_raw_udp_port = port_config_ydwg_raw_udp->get_port();
+  config.ydwg_raw_udp_mode = port_config_ydwg_raw_udp->get_udp_mode();
+  config.ydwg_raw_udp_multicast_group =
+      port_config_ydwg_raw_udp->get_multicast_group();
+  ParseUDPDestinations(port_config_ydwg_raw_udp->get_destinations(),
+                       config.ydwg_raw_udp_port,
+                       config.ydwg_raw_udp_destinations);
+  config.ydwg_raw_udp_filter = port_config_ydwg_raw_udp->get_pgn_filter();
+  config.ydwg_raw_udp_rate_limits = port_config_ydwg_raw_udp->get_rate_limits();
+
+  config.nmea0183_tcp_enabled = port_config_nmea0183_tcp_tx->get_enabled();
+  config.nmea0183_tcp_port = port_config_nmea0183_tcp_tx->get_port();
+  config.nmea0183_tcp_filter = port_config_nmea0183_tcp_tx->get_pgn_filter();
+  config.nmea0183_tcp_rate_limits =
+      port_config_nmea0183_tcp_tx->get_rate_limits();
+
+  config.nmea0183_udp_enabled = port_config_nmea0183_udp_tx->get_enabled();
+  config.nmea0183_udp_port = port_config_nmea0183_udp_tx->get_port();
+  config.nmea0183_udp_mode = port_config_nmea0183_udp_tx->get_udp_mode();
+  config.nmea0183_udp_multicast_group =
+      port_config_nmea0183_udp_tx->get_multicast_group();
+  ParseUDPDestinations(port_config_nmea0183_udp_tx->get_destinations(),
+                       config.nmea0183_udp_port,
+                       config.nmea0183_udp_destinations);
+  config.nmea0183_udp_filter = port_config_nmea0183_udp_tx->get_pgn_filter();
+  config.nmea0183_udp_rate_limits =
+      port_config_nmea0183_udp_tx->get_rate_limits();
+
+  config.translate_to_nmea0183 =
+      checkbox_config_translate_to_nmea0183->get_value();
+  config.translate_to_seasmart =
+      checkbox_config_translate_to_seasmart->get_value();
+
+  config.ydwg_raw_tcp_client_enabled =
+      port_config_ydwg_raw_tcp_client->get_enabled();
+  ParseHostPortList(port_config_ydwg_raw_tcp_client->get_host(),
+                    port_config_ydwg_raw_tcp_client->get_port(),
+                    kMaxTCPClientTargets, "TCP client server",
+                    config.ydwg_raw_tcp_client_targets);
+  config.ydwg_raw_tcp_client_filter =
+      port_config_ydwg_raw_tcp_client->get_pgn_filter();
+  config.ydwg_raw_tcp_client_rate_limits =
+      port_config_ydwg_raw_tcp_client->get_rate_limits();
+
+  config.nmea0183_tcp_client_enabled =
+      port_config_nmea0183_tcp_client->get_enabled();
+  ParseHostPortList(port_config_nmea0183_tcp_client->get_host(),
+                    port_config_nmea0183_tcp_client->get_port(),
+                    kMaxTCPClientTargets, "TCP client server",
+                    config.nmea0183_tcp_client_targets);
+  config.nmea0183_tcp_client_filter =
+      port_config_nmea0183_tcp_client->get_pgn_filter();
+  config.nmea0183_tcp_client_rate_limits =
+      port_config_nmea0183_tcp_client->get_rate_limits();
+
+  config.tcp_tx_buffer_size = tcp_client_buffer_config->get_tx_buffer_size();
+  config.tcp_tx_overflow_policy =
+      tcp_client_buffer_config->get_overflow_policy();
+  config.tcp_evict_idlest_client =
+      tcp_client_buffer_config->get_evict_idlest();
+  config.tcp_flush_deadline_ms =
+      tcp_client_buffer_config->get_flush_deadline_ms();
+  config.tcp_slow_client_queue_percent =
+      tcp_client_buffer_config->get_slow_client_queue_percent();
+  config.tcp_slow_client_timeout_ms =
+      tcp_client_buffer_config->get_slow_client_timeout_ms();
+
+  config.tcp_client_backlog_size = tcp_client_backlog_config->get_ram_size();
+  config.tcp_client_backlog_file_size =
+      tcp_client_backlog_config->get_file_size();
+  config.tcp_client_replay_rate = tcp_client_backlog_config->get_replay_rate();
+
+  return config;
 }
 
 String MacAddrToString(uint8_t *mac, bool add_colons) {
@@ -480,6 +457,21 @@ String MacAddrToString(uint8_t *mac, bool add_colons) {
   return mac_string;
 }
 
+/**
+ * @brief Serve the JSON document returned by the function on the SensESP
+ * HTTP server. The function is called in the HTTP server task.
+ */
+static void AddJSONHandler(HTTPServer *http_server, const String &uri,
+                           std::function<String()> get_json) {
+  http_server->add_handler(new HTTPRequestHandler(
+      1 << HTTP_GET, uri, [get_json](httpd_req_t *req) {
+        String json = get_json();
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_send(req, json.c_str(), json.length());
+        return ESP_OK;
+      }));
+}
+
 void PrintProductInfo() {
   uint8_t mac[6];
   WiFi.macAddress(mac);
@@ -504,16 +496,23 @@ void SetupUIComponents() {
       1300);
 
   port_config_ydwg_raw_tcp_client = new HostPortConfig(
-      false, "", kDefaultYdwgRawTCPServerPort, "Enabled", "Server hostname",
-      "Server port", "/Network/YDWG RAW TCP Client",
-      "Connect to another TCP server for transmitting and receiving YDWG RAW "
-      "data.",
+      false, "", kDefaultYdwgRawTCPServerPort, "Enabled",
+      "Server hostnames (host[:port], comma separated)", "Default server port",
+      "/Network/YDWG RAW TCP Client",
+      "Connect to up to 4 other TCP servers for transmitting and receiving "
+      "YDWG RAW data. Every server gets the same data.",
       1350);
 
-  port_config_ydwg_raw_udp = new BiDiPortConfig(
+  port_config_ydwg_raw_udp = new UDPBiDiPortConfig(
       true, false, "Transmit to WiFi", "Receive from WiFi",
       kDefaultYdwgRawUDPServerPort, "/Network/YDWG RAW over UDP",
-      "Broadcast and/or receive NMEA 2000 traffic as YDWG RAW over UDP.", 1400);
+      "Broadcast, multicast or unicast and/or receive NMEA 2000 traffic as "
+      "YDWG RAW over UDP. WiFi sends broadcasts at the lowest rate, so "
+      "multicast is preferable for busy buses if the receivers and the "
+      "access point support it. Unicast is sent to each listed destination "
+      "separately, and reaches hosts on other networks. Changes take effect "
+      "after a restart.",
+      1400);
 
   checkbox_config_translate_to_seasmart = new CheckboxConfig(
       false, "Enable", "/Network/Translate to SeaSmart",
@@ -535,15 +534,52 @@ void SetupUIComponents() {
       1800);
 
   port_config_nmea0183_tcp_client = new HostPortConfig(
-      false, "", kDefaultNMEA0183TCPServerPort, "Enabled", "Server hostname",
-      "Server port", "/Network/NMEA 0183 TCP Client",
-      "Connect to another TCP server for transmitting NMEA 0183 and "
-      "SeaSmart.Net data.",
+      false, "", kDefaultNMEA0183TCPServerPort, "Enabled",
+      "Server hostnames (host[:port], comma separated)", "Default server port",
+      "/Network/NMEA 0183 TCP Client",
+      "Connect to up to 4 other TCP servers for transmitting NMEA 0183 and "
+      "SeaSmart.Net data. Every server gets the same data.",
       1850);
 
-  port_config_nmea0183_udp_tx = new PortConfig(
+  tcp_client_backlog_config = new TCPClientBacklogConfig(
+      0, 0, kDefaultTCPClientReplayRate, "/Network/TCP Client Backlog",
+      "Lines that the YDWG RAW and NMEA 0183 TCP clients can't send while "
+      "disconnected from their server, or while it is too slow, are kept in "
+      "a backlog of the given size, and sent at up to the given rate, in "
+      "between the new lines, once the server takes them. The "
+      "oldest lines are dropped when the backlog is full. If a file size "
+      "is given, the older part of the backlog is moved to flash. The "
+      "backlog is lost on restart. Changes take effect after a restart.",
+      1860);
+
+  port_config_nmea0183_udp_tx = new UDPPortConfig(
       true, kDefaultNMEA0183UDPServerPort, "/Network/NMEA 0183 over UDP",
-      "Broadcast NMEA 0183 and SeaSmart.Net data over UDP.", 1900);
+      "Broadcast, multicast or unicast NMEA 0183 and SeaSmart.Net data over "
+      "UDP. Changes take effect after a restart.",
+      1900);
+
+  tcp_client_buffer_config = new TCPClientBufferConfig(
+      kDefaultTCPClientTXBufferSize, "Drop oldest", true,
+      kDefaultTCPFlushDeadlineMs, kDefaultSlowClientQueuePercent,
+      kDefaultSlowClientTimeoutMs, "/Network/TCP Clients",
+      "Each TCP server accepts up to 10 clients. Data waiting to be sent to "
+      "each client is buffered. When a slow client's buffer fills up, the "
+      "oldest or newest data is dropped, or the client is disconnected. "
+      "Short lines are held back for up to the given time to be sent in "
+      "fewer WiFi packets. Clients whose buffer fills past the given "
+      "percentage and does not drain within the given time are disconnected. "
+      "Per-client statistics are available as JSON at "
+      "http://<gateway>/stats/clients. "
+      "Changes take effect after a restart.",
+      1950);
+
+  can_buffer_config = new CANBufferConfig(
+      true, kDefaultN2kCANMsgBufSize, kDefaultN2kCANReceiveFrameBufSize,
+      "/System/NMEA 2000 Buffers",
+      "NMEA 2000 CAN buffer sizes. Automatic sizing derives the RX frame "
+      "buffer size from the observed peak queue depth. Changes take effect "
+      "after a restart.",
+      1200);
 }
 
 // The setup function performs one-time application initialization.
@@ -597,6 +633,11 @@ void setup() {
 
   auto *http_server = new HTTPServer();
 
+  // network statistics; the getters lock the statistics they read
+  AddJSONHandler(http_server, "/stats/clients", GetClientStatsJSON);
+  AddJSONHandler(http_server, "/stats/udp", GetUDPStatsJSON);
+  AddJSONHandler(http_server, "/stats/upstream", GetUpstreamStatsJSON);
+
   if (checkbox_config_enable_firmware_updates->get_value()) {
     xTaskCreate(ExecuteOTAUpdateTask, "OTAUpdateTask", 8000, NULL, 1, NULL);
   } else {
@@ -633,14 +674,25 @@ void setup() {
   InitNMEA2000();
 
   // set the system time whenever PGN 126992 is received
-  n2k_msg_input.connect_to(new LambdaConsumer<tN2kMsg>(
-      [](const tN2kMsg &n2k_msg) { SetSystemTime(n2k_msg); }));
+  n2k_msg_input.connect_to(new LambdaConsumer<N2kMsgRef>(
+      [](N2kMsgRef msg_ref) { SetSystemTime(*msg_ref); }));
 
-  SetupConnections();
+  SetupConnections(GetGatewayConfig(), networking);
+
+  if (port_config_ydwg_raw_udp->get_tx_enabled()) {
+    SetupYellowLEDBlinker(&ydwg_raw_strings);
+  }
 
   app.onRepeat(1000, []() {
-    debugD("Uptime: %lu, CAN RX: %d CAN TX: %d", millis() / 1000,
-           can_frame_rx_counter, can_frame_tx_counter);
+    debugD("Uptime: %lu, CAN RX: %d CAN TX: %d RX queue peak: %d overflows: %d",
+           millis() / 1000, can_frame_rx_counter.load(),
+           can_frame_tx_counter.load(),
+           nmea2000->GetRxQueueHighWater(), nmea2000->GetRxQueueOverflows());
+  });
+
+  // persist the RX queue peak for automatic buffer sizing on the next boot
+  app.onRepeat(60000, []() {
+    can_buffer_config->update_observed_peak(nmea2000->GetRxQueueHighWater());
   });
 
   // Handle incoming NMEA 2000 messages
@@ -654,6 +706,9 @@ void setup() {
   // });
 
   sensesp_app->start();
+
+  // The network task is started only after all reactions have been set up.
+  StartNetworkTask();
 }
 
 void loop() { app.tick(); }
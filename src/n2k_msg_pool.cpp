@@ -0,0 +1,30 @@
+#include "n2k_msg_pool.h"
+
+#include "sensesp.h"
+
+N2kMsgPool n2k_msg_pool;
+
+N2kMsgPool::N2kMsgPool() {
+  for (size_t i = 0; i < kN2kMsgPoolSize; i++) {
+    slots_[i].index = i;
+    slots_[i].pool = this;
+    // hand out the lowest indices first
+    free_[i] = kN2kMsgPoolSize - 1 - i;
+  }
+  num_free_ = kN2kMsgPoolSize;
+}
+
+N2kMsgRef N2kMsgPool::allocate(const tN2kMsg& msg) {
+  if (num_free_ == 0) {
+    if (exhausted_count_++ == 0) {
+      debugW("N2K message pool exhausted, dropping messages");
+    }
+    return N2kMsgRef();
+  }
+  N2kMsgSlot* slot = &slots_[free_[--num_free_]];
+  slot->msg = msg;
+  if (get_in_use() > high_water_) {
+    high_water_ = get_in_use();
+  }
+  return N2kMsgRef(slot);
+}
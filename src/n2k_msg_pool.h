@@ -0,0 +1,121 @@
+#ifndef SH_WG_FIRMWARE_N2K_MSG_POOL_H_
+#define SH_WG_FIRMWARE_N2K_MSG_POOL_H_
+
+#include <N2kMsg.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "config.h"
+
+class N2kMsgPool;
+
+/**
+ * @brief Pool slot holding a single message and its reference count.
+ */
+struct N2kMsgSlot {
+  tN2kMsg msg;
+  uint16_t refs = 0;
+  uint8_t index = 0;
+  N2kMsgPool* pool = nullptr;
+};
+
+/**
+ * @brief Reference counted handle to a pooled tN2kMsg.
+ *
+ * Copying a handle only increments the reference count of the slot; the
+ * slot returns to the pool when the last handle is destroyed. Handles must
+ * only be copied and destroyed in the main task.
+ */
+class N2kMsgRef {
+ public:
+  N2kMsgRef() {}
+  N2kMsgRef(const N2kMsgRef& other) : slot_{other.slot_} { acquire(); }
+  ~N2kMsgRef() { release(); }
+
+  N2kMsgRef& operator=(const N2kMsgRef& other) {
+    if (slot_ != other.slot_) {
+      release();
+      slot_ = other.slot_;
+      acquire();
+    }
+    return *this;
+  }
+
+  /// True if the handle refers to a message.
+  explicit operator bool() const { return slot_ != nullptr; }
+
+  const tN2kMsg& operator*() const { return slot_->msg; }
+  const tN2kMsg* operator->() const { return &slot_->msg; }
+
+ protected:
+  N2kMsgSlot* slot_ = nullptr;
+
+  explicit N2kMsgRef(N2kMsgSlot* slot) : slot_{slot} { acquire(); }
+
+  void acquire() {
+    if (slot_ != nullptr) {
+      slot_->refs++;
+    }
+  }
+  void release();
+
+  friend class N2kMsgPool;
+};
+
+/**
+ * @brief Fixed pool of reference counted tN2kMsg slots.
+ *
+ * The message is copied into a slot once when it enters the gateway; all
+ * consumers then share the slot through N2kMsgRef handles. Most handles
+ * are released when the dispatch of the message returns. Only these keep a
+ * handle beyond it:
+ *
+ * - n2k_msg_input and its PGNFilterTransform, which retain their last
+ *   output like every ValueProducer
+ * - the DecimationTransform of each rate limited NMEA 0183 output, which
+ *   retains its last output; held messages are copies, not handles
+ *
+ * kN2kMsgPoolSize is checked against this count at compile time (see
+ * kN2kMsgPoolMaxRetained). A new component that keeps handles, such as a
+ * queue of messages, must be added to that count.
+ */
+class N2kMsgPool {
+ public:
+  N2kMsgPool();
+
+  /**
+   * @brief Copy a message into a free slot.
+   *
+   * @return N2kMsgRef Handle to the pooled message, or an empty handle if
+   * the pool is exhausted.
+   */
+  N2kMsgRef allocate(const tN2kMsg& msg);
+
+  size_t get_size() const { return kN2kMsgPoolSize; }
+  size_t get_in_use() const { return kN2kMsgPoolSize - num_free_; }
+  size_t get_high_water() const { return high_water_; }
+  uint32_t get_exhausted_count() const { return exhausted_count_; }
+
+ protected:
+  N2kMsgSlot slots_[kN2kMsgPoolSize];
+  uint8_t free_[kN2kMsgPoolSize];  //< stack of free slot indices
+  size_t num_free_ = 0;
+  size_t high_water_ = 0;
+  uint32_t exhausted_count_ = 0;
+
+  void free_slot(N2kMsgSlot* slot) { free_[num_free_++] = slot->index; }
+
+  friend class N2kMsgRef;
+};
+
+inline void N2kMsgRef::release() {
+  if (slot_ != nullptr && --slot_->refs == 0) {
+    slot_->pool->free_slot(slot_);
+  }
+  slot_ = nullptr;
+}
+
+extern N2kMsgPool n2k_msg_pool;
+
+#endif  // SH_WG_FIRMWARE_N2K_MSG_POOL_H_
@@ -11,7 +11,11 @@ const double kPi = 3.14159265358979323846;
 
 const double rad_to_deg = 180.0 / kPi;
 
-void N2KTo0183Transform::set_input(tN2kMsg new_value, uint8_t input_channel) {
+void N2KTo0183Transform::set_input(N2kMsgRef msg_ref, uint8_t input_channel) {
+  const tN2kMsg& new_value = *msg_ref;
+  // tag the sentences generated from this message with its CAN id
+  current_can_id_ = N2ktoCanID(new_value.Priority, new_value.PGN,
+                               new_value.Source, new_value.Destination);
   switch (new_value.PGN) {
     case 127250:
       handle_heading(new_value);
@@ -55,6 +59,7 @@ void N2KTo0183Transform::set_input(tN2kMsg new_value, uint8_t input_channel) {
     default:
       break;
   }
+  current_can_id_ = 0;
 }
 
 void N2KTo0183Transform::handle_heading(const tN2kMsg& msg) {
@@ -383,6 +388,7 @@ void N2KTo0183Transform::emit_0183_string(const tNMEA0183Msg& msg) {
     debugW("Could not get NMEA 0183 message string");
     return;
   }
-  OriginString output = {origin_id(nmea2000_), String(buf) + "\r\n"};
+  OriginString output = {origin_id(nmea2000_), String(buf) + "\r\n",
+                         current_can_id_};
   emit(output);
 }
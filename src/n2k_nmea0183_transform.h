@@ -6,12 +6,13 @@
 
 #include "ReactESP.h"
 #include "elapsedMillis.h"
+#include "n2k_msg_pool.h"
 #include "origin_string.h"
 #include "sensesp/transforms/transform.h"
 
 using namespace sensesp;
 
-class N2KTo0183Transform : public Transform<tN2kMsg, OriginString> {
+class N2KTo0183Transform : public Transform<N2kMsgRef, OriginString> {
  public:
   N2KTo0183Transform(tNMEA2000* nmea2000, String config_path = "")
       : Transform(config_path), nmea2000_{nmea2000} {
@@ -20,10 +21,12 @@ class N2KTo0183Transform : public Transform<tN2kMsg, OriginString> {
     // send RMC periodically
     ReactESP::app->onRepeat(kRMCPeriod_, [this]() { this->send_rmc(); });
   }
-  virtual void set_input(tN2kMsg new_value, uint8_t input_channel = 0) override;
+  virtual void set_input(N2kMsgRef msg_ref,
+                         uint8_t input_channel = 0) override;
 
  protected:
   tNMEA2000* nmea2000_;  //< used to hardcode the origin
+  uint32_t current_can_id_ = 0;  //< CAN id of the message being handled
   static const unsigned long kRMCPeriod_ = 1000;  // ms
   static const unsigned int kMaxNMEA0183MessageSize_ = 164;
 
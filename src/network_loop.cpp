@@ -0,0 +1,219 @@
+#include "network_loop.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+
+#ifndef SH_WG_LINUX
+#include <lwip/sockets.h>
+#endif
+
+#include "config.h"
+#include "sensesp.h"
+
+NetworkLoop::NetworkLoop(int max_sleep_ms) : max_sleep_ms_{max_sleep_ms} {
+  app_ = new ReactESP(false);
+  init_platform();
+}
+
+NetworkLoop::Watch* NetworkLoop::find_watch(int fd) {
+  for (auto watch : watches_) {
+    if (watch->fd == fd && !watch->removed) {
+      return watch;
+    }
+  }
+  return nullptr;
+}
+
+void NetworkLoop::watch(int fd, std::function<void()> on_readable,
+                        std::function<void()> on_writable) {
+  Watch* watch = new Watch{fd, on_readable, on_writable, false, false};
+  watches_.push_back(watch);
+  add_platform_watch(watch);
+}
+
+void NetworkLoop::set_write_interest(int fd, bool enabled) {
+  Watch* watch = find_watch(fd);
+  if (watch == nullptr || watch->write_interest == enabled) {
+    return;
+  }
+  watch->write_interest = enabled;
+  update_platform_watch(watch);
+}
+
+void NetworkLoop::unwatch(int fd) {
+  Watch* watch = find_watch(fd);
+  if (watch == nullptr) {
+    return;
+  }
+  remove_platform_watch(watch);
+  watch->removed = true;
+}
+
+void NetworkLoop::on_wakeup(std::function<void()> callback) {
+  wakeup_callbacks_.push_back(callback);
+}
+
+void NetworkLoop::wake() {
+  // only the first wake() after an iteration needs to signal
+  if (!wake_pending_.exchange(true)) {
+    signal_wake();
+  }
+}
+
+void NetworkLoop::post(std::function<void()> callback) {
+  {
+    std::lock_guard<std::mutex> lock(posted_mutex_);
+    posted_.push_back(callback);
+  }
+  wake();
+}
+
+void NetworkLoop::wake_at(unsigned long time_ms) {
+  if (!deadline_set_ || (long)(time_ms - deadline_ms_) < 0) {
+    deadline_ms_ = time_ms;
+    deadline_set_ = true;
+  }
+}
+
+void NetworkLoop::dispatch(Watch* watch, bool readable, bool writable) {
+  if (readable && !watch->removed) {
+    watch->on_readable();
+  }
+  if (writable && !watch->removed && watch->write_interest &&
+      watch->on_writable) {
+    watch->on_writable();
+  }
+}
+
+void NetworkLoop::run_once() {
+  int timeout = max_sleep_ms_;
+  if (deadline_set_) {
+    long remaining = (long)(deadline_ms_ - millis());
+    timeout = std::max(0L, std::min(remaining, (long)timeout));
+  }
+  if (wait(timeout) == 0) {
+    last_idle_ms_ = millis();
+  }
+
+  // a wake() from now on needs a new signal
+  wake_pending_ = false;
+
+  if (deadline_set_ && (long)(millis() - deadline_ms_) >= 0) {
+    deadline_set_ = false;
+  }
+
+  std::vector<std::function<void()>> posted;
+  {
+    std::lock_guard<std::mutex> lock(posted_mutex_);
+    posted.swap(posted_);
+  }
+  for (auto& callback : posted) {
+    callback();
+  }
+
+  for (auto& callback : wakeup_callbacks_) {
+    callback();
+  }
+
+  tick_timers();
+
+  auto removed_end = std::remove_if(watches_.begin(), watches_.end(),
+                                    [](Watch* watch) {
+                                      if (watch->removed) {
+                                        delete watch;
+                                        return true;
+                                      }
+                                      return false;
+                                    });
+  watches_.erase(removed_end, watches_.end());
+
+  iterations_++;
+
+  if (millis() - last_idle_ms_ > kNetworkLoopMaxBusyMs) {
+    // continuously busy; let the lower priority tasks run
+    delay(1);
+    last_idle_ms_ = millis();
+  }
+}
+
+#ifndef SH_WG_LINUX
+
+// select() based implementation on the lwIP sockets of the ESP32. A UDP
+// socket connected to itself on the loopback interface serves as the wake
+// signal.
+
+void NetworkLoop::init_platform() {
+  wake_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_len = sizeof(addr);
+  if (wake_fd_ < 0 || bind(wake_fd_, (struct sockaddr*)&addr, addr_len) < 0 ||
+      getsockname(wake_fd_, (struct sockaddr*)&addr, &addr_len) < 0 ||
+      connect(wake_fd_, (struct sockaddr*)&addr, addr_len) < 0) {
+    debugE("Could not create the network task wake socket");
+  }
+  fcntl(wake_fd_, F_SETFL, fcntl(wake_fd_, F_GETFL, 0) | O_NONBLOCK);
+}
+
+void NetworkLoop::add_platform_watch(Watch* watch) {}
+
+void NetworkLoop::update_platform_watch(Watch* watch) {}
+
+void NetworkLoop::remove_platform_watch(Watch* watch) {}
+
+void NetworkLoop::signal_wake() {
+  char c = 0;
+  send(wake_fd_, &c, 1, MSG_DONTWAIT);
+}
+
+int NetworkLoop::wait(int timeout_ms) {
+  fd_set read_fds;
+  fd_set write_fds;
+  FD_ZERO(&read_fds);
+  FD_ZERO(&write_fds);
+  FD_SET(wake_fd_, &read_fds);
+  int max_fd = wake_fd_;
+  for (auto watch : watches_) {
+    if (watch->removed) {
+      continue;
+    }
+    FD_SET(watch->fd, &read_fds);
+    if (watch->write_interest) {
+      FD_SET(watch->fd, &write_fds);
+    }
+    max_fd = std::max(max_fd, watch->fd);
+  }
+
+  struct timeval timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_usec = (timeout_ms % 1000) * 1000;
+  int num_ready = select(max_fd + 1, &read_fds, &write_fds, NULL, &timeout);
+  if (num_ready <= 0) {
+    return 0;
+  }
+
+  if (FD_ISSET(wake_fd_, &read_fds)) {
+    char buf[16];
+    while (recv(wake_fd_, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+  }
+
+  // callbacks may add watches; only dispatch the ones present now
+  size_t num_watches = watches_.size();
+  for (size_t i = 0; i < num_watches; i++) {
+    Watch* watch = watches_[i];
+    if (watch->removed) {
+      continue;
+    }
+    dispatch(watch, FD_ISSET(watch->fd, &read_fds),
+             FD_ISSET(watch->fd, &write_fds));
+  }
+  return num_ready;
+}
+
+void NetworkLoop::tick_timers() { app_->tick(); }
+
+#endif  // SH_WG_LINUX
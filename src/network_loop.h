@@ -0,0 +1,121 @@
+#ifndef SH_WG_FIRMWARE_NETWORK_LOOP_H_
+#define SH_WG_FIRMWARE_NETWORK_LOOP_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "ReactESP.h"
+#include "config.h"
+
+using namespace reactesp;
+
+/**
+ * @brief Event loop of the network task.
+ *
+ * run_once() sleeps until a watched socket is ready, another task calls
+ * wake(), a deadline requested with wake_at() passes, or at most the
+ * maximum sleep time has elapsed. It then calls the callbacks of the
+ * ready sockets, the functions passed to post(), the wakeup callbacks and
+ * the timers of its own ReactESP instance, in that order.
+ *
+ * Sockets are waited on with select() on the ESP32 and with epoll on Linux.
+ *
+ * wake() and post() may be called from any task; everything else must only
+ * be called from the network task, or before it has been started.
+ */
+class NetworkLoop {
+ public:
+  /**
+   * @param max_sleep_ms Longest time to wait for events. Loops that only
+   * use wake_at() deadlines, not ReactESP timers, can sleep longer.
+   */
+  NetworkLoop(int max_sleep_ms = kNetworkLoopMaxSleepMs);
+
+  /// Event loop for timers of the network task.
+  ReactESP* get_app() { return app_; }
+
+  /**
+   * @brief Watch a socket.
+   *
+   * @param fd Socket file descriptor
+   * @param on_readable Called when the socket is readable or has failed
+   * @param on_writable Called when the socket is writable, if write
+   * interest has been enabled with set_write_interest()
+   */
+  void watch(int fd, std::function<void()> on_readable,
+             std::function<void()> on_writable = nullptr);
+  /// Enable or disable the writable callback of a watched socket.
+  void set_write_interest(int fd, bool enabled);
+  /// Stop watching a socket. Must be called before the socket is closed.
+  void unwatch(int fd);
+
+  /// Call the callback on every loop iteration.
+  void on_wakeup(std::function<void()> callback);
+
+  /// Wake the loop up. Safe to call from any task.
+  void wake();
+  /// Run a function in the network task. Safe to call from any task.
+  void post(std::function<void()> callback);
+  /// Make sure that the loop wakes up no later than at the given millis().
+  void wake_at(unsigned long time_ms);
+
+  /// Wait for events and run the callbacks once.
+  void run_once();
+
+  /// Number of loop iterations since the start.
+  uint32_t get_iteration_count() const { return iterations_; }
+
+ protected:
+  struct Watch {
+    int fd;
+    std::function<void()> on_readable;
+    std::function<void()> on_writable;
+    bool write_interest;
+    bool removed;
+  };
+
+  ReactESP* app_;
+  const int max_sleep_ms_;
+  // removed watches are deleted only after the current iteration, since
+  // the platform wait may still refer to them
+  std::vector<Watch*> watches_;
+  std::vector<std::function<void()>> wakeup_callbacks_;
+
+  std::atomic<bool> wake_pending_{false};
+  std::mutex posted_mutex_;
+  std::vector<std::function<void()>> posted_;
+
+  bool deadline_set_ = false;
+  unsigned long deadline_ms_ = 0;
+  unsigned long last_idle_ms_ = 0;
+  uint32_t iterations_ = 0;
+
+  // platform specific state and functions
+  int wake_fd_ = -1;
+#ifdef SH_WG_LINUX
+  int epoll_fd_ = -1;
+#endif
+
+  void init_platform();
+  void add_platform_watch(Watch* watch);
+  void update_platform_watch(Watch* watch);
+  void remove_platform_watch(Watch* watch);
+  void signal_wake();
+  /**
+   * @brief Wait for socket readiness and call the socket callbacks.
+   *
+   * @return Number of events, including a wake signal; 0 on timeout.
+   */
+  int wait(int timeout_ms);
+  /// Run the due ReactESP timers without blocking.
+  void tick_timers();
+
+  Watch* find_watch(int fd);
+  void dispatch(Watch* watch, bool readable, bool writable);
+};
+
+#endif  // SH_WG_FIRMWARE_NETWORK_LOOP_H_
@@ -15,6 +15,8 @@ using namespace sensesp;
 struct OriginString {
   uint32_t origin_id;  // string origin identifier
   String data;         // data
+  uint32_t can_id;     // CAN identifier of the source message, or 0 if the
+                       // string has no single NMEA 2000 source
 };
 
 #endif  // SH_WG_FIRMWARE_ORIGIN_STRING_H_
@@ -0,0 +1,193 @@
+#include "output_queue.h"
+
+#include <NMEA2000.h>
+
+#include "can_frame.h"
+#include "sensesp.h"
+
+std::atomic<uint32_t> OutputQueue::total_drop_counts_[kNumTrafficClasses] = {};
+
+const char* TrafficClassName(TrafficClass traffic_class) {
+  switch (traffic_class) {
+    case TrafficClass::kAISStatic:
+      return "AIS static";
+    case TrafficClass::kAISDynamic:
+      return "AIS dynamic";
+    case TrafficClass::kNavigation:
+      return "Navigation";
+    default:
+      return "Other";
+  }
+}
+
+TrafficClass ClassifyCANId(uint32_t can_id) {
+  if (can_id == 0) {
+    return TrafficClass::kOther;
+  }
+  switch (CANIdToPGN(can_id)) {
+    case 129041:  // AIS Aids to Navigation report
+    case 129794:  // AIS Class A static and voyage related data
+    case 129809:  // AIS Class B "CS" static data report, part A
+    case 129810:  // AIS Class B "CS" static data report, part B
+      return TrafficClass::kAISStatic;
+    case 129038:  // AIS Class A position report
+    case 129039:  // AIS Class B position report
+    case 129040:  // AIS Class B extended position report
+    case 129793:  // AIS UTC and date report
+      return TrafficClass::kAISDynamic;
+    case 127245:  // Rudder
+    case 127250:  // Heading
+    case 127251:  // Rate of turn
+    case 127257:  // Attitude
+    case 127258:  // Magnetic variation
+    case 128259:  // Boat speed
+    case 128267:  // Depth
+    case 129025:  // Position, rapid update
+    case 129026:  // COG and SOG, rapid update
+    case 129029:  // GNSS position data
+    case 129283:  // Cross track error
+    case 129284:  // Navigation data
+    case 130306:  // Wind
+      return TrafficClass::kNavigation;
+    default:
+      return TrafficClass::kOther;
+  }
+}
+
+/**
+ * @brief Get the fast-packet sequence counter and frame index of a YDWG RAW
+ * string.
+ *
+ * @return false if the string is not a YDWG RAW frame of a fast-packet PGN
+ */
+static bool GetFastPacketPart(const OriginString& value, uint8_t& sequence,
+                              uint8_t& index) {
+  if (value.can_id == 0 ||
+      !tNMEA2000::IsDefaultFastPacketMessage(CANIdToPGN(value.can_id))) {
+    return false;
+  }
+  // "hh:mm:ss.sss R 09F80102 b0 ..."; the first data byte is at offset 24
+  const String& data = value.data;
+  if (data.length() < 26 || data[12] != ' ' || data[14] != ' ' ||
+      data[23] != ' ') {
+    return false;
+  }
+  unsigned int first_byte;
+  if (sscanf(data.c_str() + 24, "%2x", &first_byte) != 1) {
+    return false;
+  }
+  sequence = first_byte >> 5;
+  index = first_byte & 0x1F;
+  return true;
+}
+
+OutputQueue::OutputQueue(const String& name, size_t capacity,
+                         std::function<bool()> ready, NetworkLoop* loop)
+    : ValueConsumer<OriginString>(),
+      ValueProducer<OriginString>(),
+      name_{name},
+      capacity_{capacity},
+      ready_{ready},
+      loop_{loop} {
+  loop->on_wakeup([this]() { this->drain(); });
+}
+
+void OutputQueue::set_input(OriginString new_value, uint8_t input_channel) {
+  Entry entry;
+  entry.traffic_class = ClassifyCANId(new_value.can_id);
+  // lower priority bits are more important
+  uint8_t priority =
+      new_value.can_id == 0 ? 3 : CANIdToPriority(new_value.can_id);
+  entry.rank = static_cast<uint8_t>(entry.traffic_class) * 8 + (7 - priority);
+  entry.value = new_value;
+  uint8_t index = 0;
+  entry.fast_packet = GetFastPacketPart(new_value, entry.sequence, index);
+
+  if (entry.fast_packet) {
+    auto shed = shed_messages_.find(new_value.can_id);
+    if (shed != shed_messages_.end()) {
+      if (index != 0 && shed->second == entry.sequence) {
+        // the rest of a message that has already been shed
+        count_drop(entry.traffic_class);
+        return;
+      }
+      shed_messages_.erase(shed);
+    }
+  }
+
+  if (queue_.size() >= capacity_) {
+    // find the oldest of the least important queued strings
+    auto victim = queue_.begin();
+    for (auto it = queue_.begin(); it != queue_.end(); it++) {
+      if (it->rank < victim->rank) {
+        victim = it;
+      }
+    }
+    if (entry.rank < victim->rank) {
+      count_drop(entry.traffic_class);
+      if (entry.fast_packet) {
+        shed_message(new_value.can_id, entry.sequence);
+      }
+      return;
+    }
+    if (victim->fast_packet) {
+      uint32_t can_id = victim->value.can_id;
+      uint8_t sequence = victim->sequence;
+      shed_message(can_id, sequence);
+      if (entry.fast_packet && new_value.can_id == can_id &&
+          entry.sequence == sequence) {
+        // the incoming frame belongs to the shed message
+        count_drop(entry.traffic_class);
+        return;
+      }
+    } else {
+      count_drop(victim->traffic_class);
+      queue_.erase(victim);
+    }
+  }
+
+  queue_.push_back(entry);
+  if (queue_.size() > high_water_) {
+    high_water_ = queue_.size();
+  }
+  drain();
+}
+
+void OutputQueue::count_drop(TrafficClass traffic_class) {
+  int index = static_cast<int>(traffic_class);
+  drop_counts_[index]++;
+  total_drop_counts_[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+/// Drop the queued and the remaining frames of a fast-packet message.
+void OutputQueue::shed_message(uint32_t can_id, uint8_t sequence) {
+  for (auto it = queue_.begin(); it != queue_.end();) {
+    if (it->fast_packet && it->value.can_id == can_id &&
+        it->sequence == sequence) {
+      count_drop(it->traffic_class);
+      it = queue_.erase(it);
+    } else {
+      it++;
+    }
+  }
+  shed_messages_[can_id] = sequence;
+}
+
+void OutputQueue::drain() {
+  unsigned long start = micros();
+  while (!queue_.empty()) {
+    if (ready_ && !ready_()) {
+      loop_->wake_at(millis() + kRetryIntervalMs_);
+      return;
+    }
+    // pop before emitting; a consumer may queue more data
+    OriginString value = queue_.front().value;
+    queue_.pop_front();
+    this->emit(value);
+    if (micros() - start > kDrainBudgetMicros_) {
+      // continue after the other work of the network task
+      loop_->wake();
+      return;
+    }
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef SH_WG_FIRMWARE_OUTPUT_QUEUE_H_
+#define SH_WG_FIRMWARE_OUTPUT_QUEUE_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+
+#include "network_loop.h"
+#include "origin_string.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Traffic classes used for shedding, from the first to be dropped
+ * to the last.
+ */
+enum class TrafficClass {
+  kAISStatic,   ///< AIS static and voyage data; repeated every few minutes
+  kAISDynamic,  ///< AIS position reports
+  kOther,       ///< Everything not classified otherwise
+  kNavigation,  ///< Own ship navigation data
+};
+
+constexpr int kNumTrafficClasses = 4;
+
+const char* TrafficClassName(TrafficClass traffic_class);
+
+/// Classify a message by the PGN in its CAN identifier.
+TrafficClass ClassifyCANId(uint32_t can_id);
+
+/**
+ * @brief Bounded output queue that sheds the least important data first.
+ *
+ * Strings are queued in set_input() and forwarded to the consumers while
+ * the ready function reports that the output can take more data. Strings
+ * held back are retried from the given network loop.
+ *
+ * When the queue is full, the least important queued string is dropped.
+ * Importance is determined by the traffic class first and by the NMEA 2000
+ * priority bits second; of strings with equal importance, the oldest one is
+ * dropped. An incoming string less important than anything in the queue is
+ * dropped itself.
+ *
+ * YDWG RAW strings of fast-packet PGNs are shed per message: dropping one
+ * frame also drops the other queued frames of the same message, keyed by the
+ * CAN id (priority, PGN and source) and the fast-packet sequence counter, and
+ * the frames of that message still to arrive. Frames already forwarded
+ * before the shedding are not recalled; the receiver discards the
+ * incomplete message.
+ */
+class OutputQueue : public ValueConsumer<OriginString>,
+                    public ValueProducer<OriginString> {
+ public:
+  OutputQueue(const String& name, size_t capacity,
+              std::function<bool()> ready, NetworkLoop* loop);
+
+  void set_input(OriginString new_value, uint8_t input_channel = 0) override;
+
+  const String& get_name() const { return name_; }
+  size_t get_depth() const { return queue_.size(); }
+  size_t get_high_water() const { return high_water_; }
+  uint32_t get_drop_count(TrafficClass traffic_class) const {
+    return drop_counts_[static_cast<int>(traffic_class)];
+  }
+
+  /// Total drops per traffic class over all output queues.
+  static uint32_t get_total_drop_count(TrafficClass traffic_class) {
+    return total_drop_counts_[static_cast<int>(traffic_class)].load(
+        std::memory_order_relaxed);
+  }
+
+ protected:
+  struct Entry {
+    OriginString value;
+    uint8_t rank;  //< higher is more important
+    TrafficClass traffic_class;
+    bool fast_packet;  //< a YDWG RAW frame of a fast-packet message
+    uint8_t sequence;  //< fast-packet sequence counter
+  };
+
+  // Maximum time spent forwarding queued strings per loop iteration
+  static const unsigned long kDrainBudgetMicros_ = 5000;
+  // Interval of retries while the output is not ready
+  static const unsigned long kRetryIntervalMs_ = 10;
+
+  String name_;
+  size_t capacity_;
+  std::function<bool()> ready_;
+  NetworkLoop* loop_;
+  std::deque<Entry> queue_;
+  size_t high_water_ = 0;
+  uint32_t drop_counts_[kNumTrafficClasses] = {0};
+  // incremented by the queues and read by the UI in another task
+  static std::atomic<uint32_t> total_drop_counts_[kNumTrafficClasses];
+  // sequence counter of the shed fast-packet message per CAN id; an entry
+  // is removed when the first frame of the next message arrives
+  std::map<uint32_t, uint8_t> shed_messages_;
+
+  void count_drop(TrafficClass traffic_class);
+  void shed_message(uint32_t can_id, uint8_t sequence);
+  void drain();
+};
+
+#endif  // SH_WG_FIRMWARE_OUTPUT_QUEUE_H_
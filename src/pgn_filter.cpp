@@ -0,0 +1,57 @@
+#include "pgn_filter.h"
+
+#include <algorithm>
+
+#include "sensesp.h"
+
+/**
+ * @brief Parse a filter mode name as shown in the configuration UI.
+ *
+ * @param mode "Allow", "Deny" or "Off"
+ * @return PGNFilterMode Parsed mode; unknown names disable the filter.
+ */
+PGNFilterMode PGNFilterModeFromString(const String& mode) {
+  if (mode == "Allow") {
+    return PGNFilterMode::kAllow;
+  } else if (mode == "Deny") {
+    return PGNFilterMode::kDeny;
+  }
+  return PGNFilterMode::kOff;
+}
+
+/**
+ * @brief Compile a PGN filter.
+ *
+ * @param mode Filter mode
+ * @param pgn_list Decimal PGNs separated by commas or whitespace
+ */
+PGNFilter::PGNFilter(PGNFilterMode mode, const String& pgn_list)
+    : mode_{mode} {
+  const char* pos = pgn_list.c_str();
+  while (*pos != '\0') {
+    char* end;
+    unsigned long pgn = strtoul(pos, &end, 10);
+    if (end == pos) {
+      // skip separators and anything else that isn't a number
+      pos++;
+      continue;
+    }
+    pos = end;
+    if (pgn > 0x1FFFF) {
+      debugW("Ignoring invalid PGN %lu in filter", pgn);
+      continue;
+    }
+    uint32_t index = pgn >> 8;
+    pf_bitmap_[index >> 5] |= 1UL << (index & 31);
+    if ((index & 0xFF) >= 240) {
+      pdu2_pgns_.push_back(pgn);
+    }
+  }
+  std::sort(pdu2_pgns_.begin(), pdu2_pgns_.end());
+  pdu2_pgns_.erase(std::unique(pdu2_pgns_.begin(), pdu2_pgns_.end()),
+                   pdu2_pgns_.end());
+}
+
+bool PGNFilter::contains_pdu2(uint32_t pgn) const {
+  return std::binary_search(pdu2_pgns_.begin(), pdu2_pgns_.end(), pgn);
+}
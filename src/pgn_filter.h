@@ -0,0 +1,71 @@
+#ifndef SH_WG_FIRMWARE_PGN_FILTER_H_
+#define SH_WG_FIRMWARE_PGN_FILTER_H_
+
+#include <Arduino.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "can_frame.h"
+
+enum class PGNFilterMode {
+  kOff,    ///< Pass all PGNs.
+  kAllow,  ///< Pass only the listed PGNs.
+  kDeny,   ///< Pass all but the listed PGNs.
+};
+
+PGNFilterMode PGNFilterModeFromString(const String& mode);
+
+/**
+ * @brief Compiled PGN allow/deny list.
+ *
+ * The PGN list is compiled into a bitmap indexed by the data page and PDU
+ * format fields. For PDU1 PGNs a set bit identifies the PGN completely. PDU2
+ * PGNs additionally need a lookup in a small sorted table, which is only
+ * consulted if the bit for their PDU format is set.
+ */
+class PGNFilter {
+ public:
+  PGNFilter() {}
+  PGNFilter(PGNFilterMode mode, const String& pgn_list);
+
+  bool is_active() const { return mode_ != PGNFilterMode::kOff; }
+
+  /// True if the PGN is on the filter list.
+  bool contains(uint32_t pgn) const {
+    if (pgn > 0x1FFFF) {
+      return false;
+    }
+    uint32_t index = pgn >> 8;
+    if ((pf_bitmap_[index >> 5] & (1UL << (index & 31))) == 0) {
+      return false;
+    }
+    if ((index & 0xFF) < 240) {
+      return true;
+    }
+    return contains_pdu2(pgn);
+  }
+
+  /**
+   * @brief Check whether a message with the given CAN identifier passes the
+   * filter. Messages without a CAN identifier always pass.
+   */
+  bool accepts(uint32_t can_id) const {
+    if (mode_ == PGNFilterMode::kOff || can_id == 0) {
+      return true;
+    }
+    return contains(CANIdToPGN(can_id)) == (mode_ == PGNFilterMode::kAllow);
+  }
+
+ protected:
+  // One bit per data page and PDU format combination
+  static constexpr int kPFBitmapWords = 512 / 32;
+
+  PGNFilterMode mode_ = PGNFilterMode::kOff;
+  uint32_t pf_bitmap_[kPFBitmapWords] = {0};
+  std::vector<uint32_t> pdu2_pgns_;
+
+  bool contains_pdu2(uint32_t pgn) const;
+};
+
+#endif  // SH_WG_FIRMWARE_PGN_FILTER_H_
@@ -0,0 +1,73 @@
+#ifndef SH_WG_FIRMWARE_PGN_FILTER_TRANSFORM_H_
+#define SH_WG_FIRMWARE_PGN_FILTER_TRANSFORM_H_
+
+#include <N2kMsg.h>
+
+#include <vector>
+
+#include "can_frame.h"
+#include "n2k_msg_pool.h"
+#include "origin_string.h"
+#include "pgn_filter.h"
+#include "sensesp/transforms/transform.h"
+
+using namespace sensesp;
+
+inline uint32_t CANIdOf(const CANFrame& frame) { return frame.id; }
+
+inline uint32_t CANIdOf(const tN2kMsg& msg) {
+  return N2ktoCanID(msg.Priority, msg.PGN, msg.Source, msg.Destination);
+}
+
+inline uint32_t CANIdOf(const N2kMsgRef& msg) { return CANIdOf(*msg); }
+
+inline uint32_t CANIdOf(const OriginString& str) { return str.can_id; }
+
+/**
+ * @brief Pass through only the values accepted by at least one of the
+ * given PGN filters.
+ *
+ * A single filter gates an individual output. Several filters are used in
+ * front of a formatting transform shared by several outputs: a message that
+ * no output wants is dropped before it is formatted at all.
+ */
+template <typename T>
+class PGNFilterTransform : public Transform<T, T> {
+ public:
+  PGNFilterTransform(const PGNFilter& filter) : Transform<T, T>() {
+    filters_.push_back(filter);
+  }
+  PGNFilterTransform(const std::vector<PGNFilter>& filters)
+      : Transform<T, T>(), filters_{filters} {}
+
+  void set_input(T new_value, uint8_t input_channel = 0) override {
+    uint32_t can_id = CANIdOf(new_value);
+    for (const PGNFilter& filter : filters_) {
+      if (filter.accepts(can_id)) {
+        this->emit(new_value);
+        return;
+      }
+    }
+  }
+
+ protected:
+  std::vector<PGNFilter> filters_;
+};
+
+/**
+ * @brief Return true if any of the filters has an effect, i.e. at least
+ * one filter is active and none of them passes everything.
+ */
+inline bool AnyPGNFilterRestricts(const std::vector<PGNFilter>& filters) {
+  if (filters.empty()) {
+    return false;
+  }
+  for (const PGNFilter& filter : filters) {
+    if (!filter.is_active()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif  // SH_WG_FIRMWARE_PGN_FILTER_TRANSFORM_H_
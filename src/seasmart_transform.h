@@ -8,6 +8,7 @@
 #include "Seasmart.h"
 #include "config.h"
 #include "elapsedMillis.h"
+#include "n2k_msg_pool.h"
 #include "origin_string.h"
 #include "sensesp/transforms/transform.h"
 #include "shwg.h"
@@ -24,16 +25,19 @@ String GetSeaSmartString(const tN2kMsg& n2k_msg) {
   }
 }
 
-class SeasmartTransform : public Transform<tN2kMsg, OriginString> {
+class SeasmartTransform : public Transform<N2kMsgRef, OriginString> {
  public:
   SeasmartTransform(tNMEA2000* nmea2000)
-      : Transform<tN2kMsg, OriginString>(), nmea2000_{nmea2000} {}
+      : Transform<N2kMsgRef, OriginString>(), nmea2000_{nmea2000} {}
 
-  void set_input(tN2kMsg input, uint8_t input_channel = 0) override {
+  void set_input(N2kMsgRef msg_ref, uint8_t input_channel = 0) override {
+    const tN2kMsg& input = *msg_ref;
     String seasmart_str = GetSeaSmartString(input);
     // we're assuming that all tN2KMsg objects originate from nmea2000
     if (seasmart_str.length() > 0) {
-      OriginString origin_str = {origin_id(nmea2000_), seasmart_str};
+      uint32_t can_id = N2ktoCanID(input.Priority, input.PGN, input.Source,
+                                   input.Destination);
+      OriginString origin_str = {origin_id(nmea2000_), seasmart_str, can_id};
       this->emit(origin_str);
     }
   }
@@ -12,7 +12,8 @@ void PrintProductInfo();
 // template function that returns a pointer cast to uint32_t
 template <typename T>
 uint32_t origin_id(T *ptr) {
-  return reinterpret_cast<uint32_t>(ptr);
+  // truncated on 64-bit hosts, where only the low bits are used as the id
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
 }
 
 #endif
@@ -0,0 +1,102 @@
+#ifndef SH_WG_FIRMWARE_SPSC_BYTE_RING_H_
+#define SH_WG_FIRMWARE_SPSC_BYTE_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free single-producer, single-consumer byte ring.
+ *
+ * write() must only be called from one task, and peek() and consume() from
+ * one other task. Writes are all or nothing, so that a line is never
+ * queued partially. The consumer reads the queued bytes in place, in the
+ * largest contiguous spans the ring holds, and releases them once they have
+ * been handled.
+ *
+ * The buffer is allocated once in the constructor.
+ */
+class SPSCByteRing {
+ public:
+  SPSCByteRing(size_t capacity) : buf_(capacity + 1) {}
+
+  /// Append data to the ring. Returns false if it does not fit entirely.
+  bool write(const char* data, size_t length) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t used = head >= tail ? head - tail : head + buf_.size() - tail;
+    if (length > buf_.size() - 1 - used) {
+      drops_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    size_t first = std::min(length, buf_.size() - head);
+    memcpy(&buf_[head], data, first);
+    memcpy(&buf_[0], data + first, length - first);
+    size_t next = head + length;
+    if (next >= buf_.size()) {
+      next -= buf_.size();
+    }
+    head_.store(next, std::memory_order_release);
+
+    used += length;
+    if (used > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(used, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Get the oldest contiguous span of queued bytes.
+   *
+   * @return Length of the span, 0 if the ring is empty.
+   */
+  size_t peek(const char*& data) const {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    data = &buf_[tail];
+    return head >= tail ? head - tail : buf_.size() - tail;
+  }
+
+  /// Release the given number of bytes from the start of the peeked span.
+  void consume(size_t length) {
+    size_t next = tail_.load(std::memory_order_relaxed) + length;
+    if (next >= buf_.size()) {
+      next -= buf_.size();
+    }
+    tail_.store(next, std::memory_order_release);
+  }
+
+  bool is_empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  size_t get_capacity() const { return buf_.size() - 1; }
+
+  /// Current number of queued bytes; may be stale by the time it is used.
+  size_t get_depth() const {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return head >= tail ? head - tail : head + buf_.size() - tail;
+  }
+
+  size_t get_high_water() const {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+  /// Number of rejected writes.
+  uint32_t get_drop_count() const {
+    return drops_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  std::vector<char> buf_;
+  std::atomic<size_t> head_{0};  //< next byte to write; owned by producer
+  std::atomic<size_t> tail_{0};  //< next byte to read; owned by consumer
+  std::atomic<size_t> high_water_{0};
+  std::atomic<uint32_t> drops_{0};
+};
+
+#endif  // SH_WG_FIRMWARE_SPSC_BYTE_RING_H_
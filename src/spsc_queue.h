@@ -0,0 +1,80 @@
+#ifndef SH_WG_FIRMWARE_SPSC_QUEUE_H_
+#define SH_WG_FIRMWARE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free single-producer, single-consumer queue.
+ *
+ * push() must only be called from one task and pop() from one other task.
+ * The slots are allocated once in the constructor.
+ */
+template <typename T>
+class SPSCQueue {
+ public:
+  SPSCQueue(size_t capacity) : slots_(capacity + 1) {}
+
+  /// Add a value to the queue. Returns false if the queue is full.
+  bool push(const T& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t next = increment(head);
+    if (next == tail_.load(std::memory_order_acquire)) {
+      drops_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head] = value;
+    head_.store(next, std::memory_order_release);
+
+    size_t depth = get_depth();
+    if (depth > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /// Remove the oldest value from the queue. Returns false if empty.
+  bool pop(T& value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots_[tail]);
+    // release any resources held by the moved-from slot
+    slots_[tail] = T();
+    tail_.store(increment(tail), std::memory_order_release);
+    return true;
+  }
+
+  size_t get_capacity() const { return slots_.size() - 1; }
+
+  /// Current number of queued values; may be stale by the time it is used.
+  size_t get_depth() const {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return head >= tail ? head - tail : head + slots_.size() - tail;
+  }
+
+  size_t get_high_water() const {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+  uint32_t get_drop_count() const {
+    return drops_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  std::vector<T> slots_;
+  std::atomic<size_t> head_{0};  //< next slot to write; owned by producer
+  std::atomic<size_t> tail_{0};  //< next slot to read; owned by consumer
+  std::atomic<size_t> high_water_{0};
+  std::atomic<uint32_t> drops_{0};
+
+  size_t increment(size_t index) const {
+    return index + 1 == slots_.size() ? 0 : index + 1;
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_SPSC_QUEUE_H_
@@ -1,23 +1,290 @@
 #include "streaming_tcp_client.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#ifdef SH_WG_LINUX
+#include <arpa/inet.h>
+#endif
+
 using namespace sensesp;
 
 void ExecuteTCPClientTask(void* this_ptr) {
-  // cast this_ptr into a pointer to a StreamingTCPClient
-  StreamingTCPClient* this_ = (StreamingTCPClient*)this_ptr;
+  // cast this_ptr into a pointer to a TCPClientGroup
+  TCPClientGroup* this_ = (TCPClientGroup*)this_ptr;
 
   this_->execute_client_task();
 }
 
-void StreamingTCPClient::start() {
+void TCPClientGroup::start() {
   if (enabled_) {
     xTaskCreate(ExecuteTCPClientTask, "tcp_client_task", 4096, this, 1, NULL);
 
-    // emit received OriginStrings in the main task
-    rx_queue_producer_->connect_to(
-        new LambdaConsumer<OriginString*>([this](OriginString* origin_str) {
-          this->emit(*origin_str);
-          delete origin_str;
-        }));
+    // emit received OriginStrings in the network task
+    rx_bridge_->connect_to(new LambdaConsumer<OriginString>(
+        [this](OriginString origin_str) { this->emit(origin_str); }));
+  }
+}
+
+void StreamingTCPClient::start_connect() {
+  if (!address_valid_ ||
+      millis() - address_resolved_ms_ >= kTCPClientDNSCacheTTLMs) {
+    request_resolve();
+  }
+  if (!address_valid_) {
+    // on_resolved() continues the attempt
+    state_ = ConnectState::kResolving;
+    return;
+  }
+
+  connect_attempts_++;
+
+  debugD("Connecting to %s:%d...", host_.c_str(), port_);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    fail_connect("no socket");
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = (uint32_t)address_;
+  addr.sin_port = htons(port_);
+  connect_fd_ = fd;
+  connect_started_ms_ = millis();
+  state_ = ConnectState::kConnecting;
+  if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 &&
+      errno != EINPROGRESS) {
+    fail_connect(strerror(errno));
+    return;
+  }
+  // the socket becomes writable when connected, and readable if the
+  // attempt fails
+  loop_->watch(
+      fd, [this]() { this->check_connect(); },
+      [this]() { this->check_connect(); });
+  loop_->set_write_interest(fd, true);
+  loop_->wake_at(connect_started_ms_ + kTCPClientConnectTimeoutMs);
+}
+
+void StreamingTCPClient::check_connect() {
+  int error = 0;
+  socklen_t error_len = sizeof(error);
+  if (getsockopt(connect_fd_, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0) {
+    error = errno;
   }
+  if (error != 0) {
+    fail_connect(strerror(error));
+    return;
+  }
+
+  int fd = connect_fd_;
+  loop_->unwatch(fd);
+  connect_fd_ = -1;
+  // the WiFiClient takes over the socket
+  *client_->client_ = WiFiClient(fd);
+
+  state_ = ConnectState::kConnected;
+  connected_ms_ = millis();
+  last_connect_latency_ms_ = connected_ms_ - connect_started_ms_;
+  max_connect_latency_ms_ =
+      std::max(max_connect_latency_ms_, last_connect_latency_ms_);
+  backoff_ms_ = kTCPClientMinBackoffMs;
+  debugI("Connected to %s:%d in %lu ms", host_.c_str(), port_,
+         last_connect_latency_ms_);
+
+  watched_fd_ = fd;
+  last_tx_ms_ = millis();
+  tx_partial_ = false;
+  last_replay_ms_ = millis();
+  replay_budget_ = 0;
+  loop_->watch(
+      watched_fd_, [this]() { this->receive(); },
+      [this]() { this->service_tx(); });
+  connected_ = true;
+}
+
+void StreamingTCPClient::fail_connect(const char* reason) {
+  debugD("Connecting to %s:%d failed: %s", host_.c_str(), port_, reason);
+  if (connect_fd_ >= 0) {
+    loop_->unwatch(connect_fd_);
+    close(connect_fd_);
+    connect_fd_ = -1;
+  }
+  connect_failures_++;
+  schedule_retry();
+}
+
+void StreamingTCPClient::schedule_retry() {
+  state_ = ConnectState::kWaiting;
+  // random delays keep clients that lost the server at the same time from
+  // retrying in lockstep
+  unsigned long delay_ms = backoff_ms_ / 2 + random(backoff_ms_ / 2 + 1);
+  next_attempt_ms_ = millis() + delay_ms;
+  backoff_ms_ = std::min(backoff_ms_ * 2, kTCPClientMaxBackoffMs);
+  loop_->wake_at(next_attempt_ms_);
+}
+
+void StreamingTCPClient::request_resolve() {
+  if (resolve_pending_) {
+    return;
+  }
+  resolve_pending_ = true;
+  ResolveHostAsync(host_, loop_,
+                   [this](bool resolved, const IPAddress& address) {
+                     this->on_resolved(resolved, address);
+                   });
+}
+
+void StreamingTCPClient::on_resolved(bool resolved,
+                                     const IPAddress& address) {
+  resolve_pending_ = false;
+  if (resolved) {
+    address_ = address;
+    address_valid_ = true;
+    address_resolved_ms_ = millis();
+  } else {
+    // keep using the last known address, if there is one
+    dns_failures_++;
+    debugD("Could not resolve %s", host_.c_str());
+  }
+
+  if (state_ != ConnectState::kResolving) {
+    return;
+  }
+  if (address_valid_) {
+    start_connect();
+  } else {
+    connect_attempts_++;
+    connect_failures_++;
+    schedule_retry();
+  }
+}
+
+void StreamingTCPClient::replay_backlog() {
+  unsigned long now = millis();
+  if (replay_rate_ == 0) {
+    replay_budget_ = kTCPClientTXRingSize;
+  } else {
+    long refill = replay_rate_ * (now - last_replay_ms_) / 1000;
+    if (refill > 0) {
+      replay_budget_ = std::min(replay_budget_ + refill,
+                                (long)kTCPClientTXRingSize);
+      last_replay_ms_ = now;
+    }
+  }
+
+  service_tx();
+  if (!backlog_->is_empty()) {
+    loop_->wake_at(now + kTCPClientReplayIntervalMs);
+  }
+}
+
+void StreamingTCPClient::check_deadlines() {
+  // a line being replayed must stay where peek() found it
+  if (backlog_ != nullptr && replay_length_ == 0) {
+    backlog_->spill();
+  }
+
+  switch (state_) {
+    case ConnectState::kWaiting:
+      if ((long)(millis() - next_attempt_ms_) >= 0) {
+        start_connect();
+      } else {
+        loop_->wake_at(next_attempt_ms_);
+      }
+      return;
+    case ConnectState::kResolving:
+      return;
+    case ConnectState::kConnecting:
+      if (millis() - connect_started_ms_ >= kTCPClientConnectTimeoutMs) {
+        fail_connect("timeout");
+      } else {
+        loop_->wake_at(connect_started_ms_ + kTCPClientConnectTimeoutMs);
+      }
+      return;
+    case ConnectState::kConnected:
+      break;
+  }
+
+  if (backlog_ != nullptr) {
+    replay_backlog();
+  }
+
+  if (millis() - last_tx_ms_ >= kTCPClientKeepaliveMs &&
+      tx_ring_->is_empty() && replay_length_ == 0) {
+    // Send an empty line as a keepalive message. Without this,
+    // disconnection detection takes just about forever. Only the client
+    // task is writing, and neither an empty ring nor the backlog has a
+    // partially sent line.
+    SendNonBlocking(*client_->client_, "\r\n", 2);
+    last_tx_ms_ = millis();
+  }
+  loop_->wake_at(last_tx_ms_ + kTCPClientKeepaliveMs);
+}
+
+void StreamingTCPClient::update_stats() {
+  const char* state = "waiting";
+  unsigned long state_s = 0;
+  if (state_ == ConnectState::kConnected) {
+    state = "connected";
+    state_s = (millis() - connected_ms_) / 1000;
+  } else if (state_ == ConnectState::kResolving) {
+    state = "resolving";
+  } else if (state_ == ConnectState::kConnecting) {
+    state = "connecting";
+  }
+  String address = address_valid_ ? address_.toString() : "";
+
+  char buf[400];
+  snprintf(buf, sizeof(buf),
+           "{\"name\":\"%s\",\"host\":\"%s\",\"port\":%u,\"address\":\"%s\","
+           "\"state\":\"%s\",\"connected_s\":%lu,\"connect_attempts\":%u,"
+           "\"connect_failures\":%u,\"dns_failures\":%u,\"disconnects\":%u,"
+           "\"last_connect_ms\":%lu,\"max_connect_ms\":%lu,"
+           "\"tx_dropped_lines\":%u,\"tx_high_water\":%u}",
+           name_.c_str(), host_.c_str(), (unsigned)port_, address.c_str(),
+           state, state_s, connect_attempts_, connect_failures_,
+           dns_failures_, disconnects_, last_connect_latency_ms_,
+           max_connect_latency_ms_, get_tx_drop_count(),
+           (unsigned)get_tx_high_water());
+  String json = buf;
+  String backlog_summary = "";
+  if (backlog_ != nullptr) {
+    // append to the object
+    json = json.substring(0, json.length() - 1);
+    unsigned long age_s = backlog_->get_oldest_age_ms() / 1000;
+    snprintf(buf, sizeof(buf),
+             ",\"backlog_lines\":%u,\"backlog_ram_bytes\":%u,"
+             "\"backlog_ram_high_water\":%u,\"backlog_file_bytes\":%u,"
+             "\"backlog_age_s\":%lu,\"backlog_dropped_lines\":%u,"
+             "\"replayed_lines\":%u}",
+             (unsigned)backlog_->get_num_records(),
+             (unsigned)backlog_->get_ram_depth(),
+             (unsigned)backlog_->get_ram_high_water(),
+             (unsigned)backlog_->get_file_depth(), age_s,
+             backlog_->get_drop_count(), replayed_lines_);
+    json += buf;
+    snprintf(buf, sizeof(buf), ", backlog %u lines (%lu s), dropped %u",
+             (unsigned)backlog_->get_num_records(), age_s,
+             backlog_->get_drop_count());
+    backlog_summary = buf;
+  }
+  if (state_ == ConnectState::kConnected) {
+    snprintf(buf, sizeof(buf),
+             "Connected to %s for %lu s, connect %lu ms, %u failed "
+             "attempts, dropped %u",
+             address.c_str(), state_s, last_connect_latency_ms_,
+             connect_failures_, get_tx_drop_count());
+  } else {
+    snprintf(buf, sizeof(buf),
+             "Not connected, %u failed attempts (%u DNS), dropped %u",
+             connect_failures_, dns_failures_, get_tx_drop_count());
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_json_ = json;
+  stats_summary_ = String(buf) + backlog_summary;
 }
@@ -4,134 +4,473 @@
 #include <Arduino.h>
 #include <WiFi.h>
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 #include "buffered_tcp_client.h"
+#include "config.h"
+#include "host_port_list.h"
+#include "host_resolver.h"
+#include "network_loop.h"
 #include "origin_string.h"
 #include "sensesp/net/networking.h"
 #include "sensesp/system/lambda_consumer.h"
-#include "sensesp/system/task_queue_producer.h"
 #include "shwg.h"
+#include "spsc_byte_ring.h"
+#include "task_bridge.h"
+#include "tcp_client_backlog.h"
 
 using namespace sensesp;
 
 /**
  * @brief TCP client that is able to receive and transmit continuous data
  * streams.
+ *
+ * The connection is handled in the task running the given NetworkLoop,
+ * which sleeps until there are lines to transmit, the socket has received
+ * or can send more data, or the keepalive or reconnect deadline has passed.
+ * Received lines are passed to the given bridge. The clients are created
+ * and run by a TCPClientGroup.
+ *
+ * Connecting never blocks the task: the connection is opened with a
+ * non-blocking socket, and failed attempts are retried after an
+ * exponentially growing, randomized delay. Host names are looked up in the
+ * resolver task (see ResolveHostAsync()), so a slow or dead DNS server
+ * doesn't hold up the other clients. An address is looked up again once it
+ * is older than kTCPClientDNSCacheTTLMs; until the new lookup completes, and
+ * if it fails, the last known address is used.
+ *
+ * Lines to be transmitted are copied into a lock-free byte ring, and the
+ * client task writes them to the socket without blocking, straight out of
+ * the ring in as large spans as it holds. The producing task is the only
+ * writer of the ring, and the client task the only reader. Lines that don't
+ * fit in the ring, or arrive while the client is not connected, are
+ * dropped.
+ *
+ * If a backlog is set, those lines are stored in it instead, and so are
+ * the whole lines left in the ring when the connection drops. The backlog
+ * is replayed at a limited rate while connected. The client task sends the
+ * replayed lines straight from the backlog, in between the lines of the
+ * ring; new lines are never held back behind the backlog, so it drains at
+ * the replay rate whatever the data rate of the output.
  */
-class StreamingTCPClient : public ValueProducer<OriginString>,
-                           public ValueConsumer<OriginString>,
-                           public Startable {
+class StreamingTCPClient {
  public:
   StreamingTCPClient(const String& host, const uint16_t port,
-                     Networking* networking)
-      : Startable(50), networking_{networking}, host_{host}, port_{port} {
-    task_app_ = new ReactESP(false);
+                     NetworkLoop* loop, TaskBridge<OriginString>* rx_bridge)
+      : host_{host}, port_{port}, loop_{loop}, rx_bridge_{rx_bridge} {
     client_ = new BufferedTCPClient(WiFiClientPtr(new WiFiClient()));
-    tx_queue_producer_ =
-        new TaskQueueProducer<OriginString*>(NULL, task_app_, 200, 491);
-    rx_queue_producer_ =
-        new TaskQueueProducer<OriginString*>(NULL, ReactESP::app, 200, 492);
+    tx_ring_ = new SPSCByteRing(kTCPClientTXRingSize);
   }
 
-  void set_input(OriginString new_value, uint8_t input_channel = 0) override {
-    OriginString* value_ptr = new OriginString(new_value);
-    bool retval = tx_queue_producer_->set(value_ptr);
-    if (retval == false) {
-      debugW("StreamingTCPClient: tx_queue_producer_ full, dropping value");
-      delete value_ptr;
+  /**
+   * @brief Queue a line for transmission. The caller must wake the loop
+   * afterwards.
+   */
+  void write(const OriginString& new_value) {
+    if (new_value.origin_id == origin_id(&client_->client_)) {
+      return;
+    }
+    const char* data = new_value.data.c_str();
+    size_t length = new_value.data.length();
+    if (backlog_ != nullptr) {
+      if (!connected_) {
+        backlog_->push(data, length);
+        return;
+      }
+      if (length > tx_ring_->get_capacity() - tx_ring_->get_depth()) {
+        // replayed once the socket has caught up
+        last_congested_ms_ = millis();
+        backlog_->push(data, length);
+        return;
+      }
+    } else if (!connected_) {
+      return;
+    }
+    if (!tx_ring_->write(data, length)) {
+      last_congested_ms_ = millis();
     }
   }
 
-  void set_enabled(bool enabled) { enabled_ = enabled; }
+  /// Start serving the connection. Must be called in the loop's task.
+  void start() {
+    loop_->on_wakeup([this]() {
+      this->service_tx();
+      this->check_deadlines();
+    });
+    loop_->get_app()->onRepeat(kClientStatsUpdatePeriodMs,
+                               [this]() { this->update_stats(); });
+  }
+
+  const String& get_host() const { return host_; }
+  uint16_t get_port() const { return port_; }
+
+  /// Set the name used in the statistics.
+  void set_name(const String& name) { name_ = name; }
+
+  /**
+   * @brief Store the lines that can't be sent in the backlog, and replay
+   * them at up to replay_rate bytes per second (0 = unlimited) after
+   * reconnecting. Must be called before the client is started.
+   */
+  void set_backlog(TCPClientBacklog* backlog, size_t replay_rate) {
+    backlog_ = backlog;
+    replay_rate_ = replay_rate;
+    replay_buf_ = new char[kTCPClientBacklogMaxLineLength];
+  }
+
+  /**
+   * @brief Return true if the socket or the TX ring has recently been
+   * full.
+   */
+  bool is_congested() {
+    return last_congested_ms_ != 0 &&
+           millis() - last_congested_ms_ < kCongestionHoldMs;
+  }
+
+  /// Number of lines dropped because the TX ring was full.
+  uint32_t get_tx_drop_count() const { return tx_ring_->get_drop_count(); }
+  size_t get_tx_depth() const { return tx_ring_->get_depth(); }
+  size_t get_tx_high_water() const { return tx_ring_->get_high_water(); }
+
+  /// Latest connection statistics as JSON. Safe to call from any task.
+  String get_stats_json() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_json_;
+  }
+
+  /// Latest connection statistics as text. Safe to call from any task.
+  String get_stats_summary() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_summary_;
+  }
 
  protected:
-  Networking* networking_;
+  enum class ConnectState {
+    kWaiting,     ///< Waiting for the next connection attempt
+    kResolving,   ///< Waiting for the first address of the server
+    kConnecting,  ///< Non-blocking connect in progress
+    kConnected,
+  };
+
+  String name_;
   const String host_;
   const uint16_t port_;
 
   BufferedTCPClient* client_;
+  // socket watched in the client loop, or -1
+  int watched_fd_ = -1;
 
-  TaskQueueProducer<OriginString*>* tx_queue_producer_;
-  TaskQueueProducer<OriginString*>* rx_queue_producer_;
+  NetworkLoop* loop_;
+  SPSCByteRing* tx_ring_;
+  TaskBridge<OriginString>* rx_bridge_;
 
-  ObservableValue<OriginString> tx_string_;
+  unsigned long last_tx_ms_ = 0;
+  // the socket has been given only part of the line at the ring front
+  bool tx_partial_ = false;
 
-  ReactESP* task_app_ = nullptr;
+  TCPClientBacklog* backlog_ = nullptr;
+  size_t replay_rate_ = 0;
+  char* replay_buf_ = nullptr;
+  // length and sent bytes of the backlog line being replayed, if any
+  size_t replay_length_ = 0;
+  size_t replay_sent_ = 0;
+  // bytes that may still be replayed; may be overdrawn by one line
+  long replay_budget_ = 0;
+  unsigned long last_replay_ms_ = 0;
+  uint32_t replayed_lines_ = 0;
 
-  bool enabled_ = true;
+  ConnectState state_ = ConnectState::kWaiting;
+  // socket of the connection attempt in progress, or -1
+  int connect_fd_ = -1;
+  unsigned long connect_started_ms_ = 0;
+  unsigned long next_attempt_ms_ = 0;
+  unsigned long backoff_ms_ = kTCPClientMinBackoffMs;
+  unsigned long connected_ms_ = 0;
 
-  void start() override;
+  // cached address of the server
+  IPAddress address_;
+  bool address_valid_ = false;
+  unsigned long address_resolved_ms_ = 0;
+  // a lookup has been requested from the resolver task
+  bool resolve_pending_ = false;
 
-  void execute_client_task() {
-    // Receive strings to be transmitted in the tcp client task.
-    // We don't want consumers to connect to the task queue directly, because
-    // we're responsible for deleting the received string objects.
-    this->tx_queue_producer_->connect_to(
-        new LambdaConsumer<OriginString*>([this](OriginString* origin_str) {
-          this->tx_string_ = *origin_str;
-          delete origin_str;
-        }));
-
-    auto send_data =
-        new LambdaConsumer<OriginString>([this](OriginString origin_str) {
-          if (client_->client_->connected() &&
-              origin_str.origin_id != origin_id(&client_->client_)) {
-            client_->client_->write(origin_str.data.c_str());
-          }
-        });
+  uint32_t connect_attempts_ = 0;
+  uint32_t connect_failures_ = 0;
+  uint32_t dns_failures_ = 0;
+  uint32_t disconnects_ = 0;
+  unsigned long last_connect_latency_ms_ = 0;
+  unsigned long max_connect_latency_ms_ = 0;
 
-    task_app_->onRepeat(2000, [this]() {
-      if (client_->client_->connected()) {
-        // Send an empty line as a keepalive message. Without this,
-        // disconnection detection takes just about forever.
-        client_->client_->write("\r\n");
-      }
-    });
+  std::mutex stats_mutex_;
+  String stats_json_ = "{}";
+  String stats_summary_ = "Not connected";
 
-    task_app_->onRepeat(100, [this]() {
-      // flush the TCP client TX buffer
-      if (client_->client_->connected()) {
-        client_->client_->flush();
+  // written by the client task, read by the producing task
+  std::atomic<bool> connected_{false};
+  // written by both tasks; a lost update only shortens the congestion
+  volatile unsigned long last_congested_ms_ = 0;
+
+  /**
+   * @brief Write as much of the TX ring and the replay budget as the socket
+   * accepts, and wait for the socket to become writable if it didn't take
+   * all of it.
+   *
+   * A backlog line is only started when the ring is empty, so that it
+   * doesn't split a line of the ring, and the ring waits until the line has
+   * been sent completely.
+   */
+  void service_tx() {
+    if (watched_fd_ < 0) {
+      return;
+    }
+    const char* data;
+    size_t length;
+    bool blocked = false;
+    while (true) {
+      bool from_ring = false;
+      if (replay_length_ == 0 && (length = tx_ring_->peek(data)) > 0) {
+        from_ring = true;
+      } else if (next_replay_line()) {
+        data = replay_buf_ + replay_sent_;
+        length = replay_length_ - replay_sent_;
+      } else {
+        break;
       }
-    });
+      int sent = SendNonBlocking(*client_->client_, data, length);
+      if (sent < 0) {
+        debugD("Write to %s:%d failed", host_.c_str(), port_);
+        disconnect();
+        return;
+      }
+      if (sent == 0) {
+        last_congested_ms_ = millis();
+        blocked = true;
+        break;
+      }
+      last_tx_ms_ = millis();
+      if (from_ring) {
+        tx_ring_->consume(sent);
+        tx_partial_ = data[sent - 1] != '\n';
+      } else if ((replay_sent_ += sent) == replay_length_) {
+        backlog_->pop();
+        replay_length_ = 0;
+        replayed_lines_++;
+      }
+    }
+    loop_->set_write_interest(watched_fd_, blocked);
+  }
 
-    tx_string_.connect_to(send_data);
-
-    // receive any data sent to the client
-    task_app_->onRepeat(1, [this]() {
-      if (client_->available() || client_->client_->connected()) {
-        String line;
-        int retval;
-        while (this->client_->read_line(line)) {
-          OriginString* value =
-              new OriginString{origin_id(&client_->client_), line};
-          retval = this->rx_queue_producer_->set(value);
-          if (retval == false) {
-            debugW(
-                "StreamingTCPClient: rx_queue_producer_ full, dropping value");
-            delete value;
+  /**
+   * @brief Make sure that replay_buf_ holds the backlog line to replay next,
+   * if the replay budget allows one.
+   */
+  bool next_replay_line() {
+    if (replay_length_ > 0) {
+      return true;
+    }
+    if (backlog_ == nullptr || replay_budget_ <= 0) {
+      return false;
+    }
+    replay_length_ = backlog_->peek(replay_buf_);
+    replay_sent_ = 0;
+    replay_budget_ -= replay_length_;
+    return replay_length_ > 0;
+  }
+
+  /**
+   * @brief Move the whole lines left in the TX ring to the backlog. A line
+   * the socket has already been given a part of is discarded.
+   */
+  void requeue_tx() {
+    bool skip = tx_partial_;
+    size_t line_length = 0;
+    const char* data;
+    size_t length;
+    while ((length = tx_ring_->peek(data)) > 0) {
+      const char* end = data + length;
+      while (data < end) {
+        const char* newline = (const char*)memchr(data, '\n', end - data);
+        const char* line_end = newline == nullptr ? end : newline + 1;
+        size_t n = line_end - data;
+        if (!skip && line_length + n <= kTCPClientBacklogMaxLineLength) {
+          memcpy(replay_buf_ + line_length, data, n);
+        }
+        line_length += n;
+        if (newline != nullptr) {
+          if (!skip) {
+            // push() drops and counts a line too long for the buffer
+            backlog_->push(replay_buf_, line_length);
           }
+          skip = false;
+          line_length = 0;
         }
+        data = line_end;
       }
-    });
+      tx_ring_->consume(length);
+    }
+    if (!skip && line_length > 0) {
+      backlog_->push(replay_buf_, line_length);
+    }
+    tx_partial_ = false;
+  }
+
+  /// Discard the queued data, which may begin with a partially sent line.
+  void clear_tx() {
+    const char* data;
+    size_t length;
+    while ((length = tx_ring_->peek(data)) > 0) {
+      tx_ring_->consume(length);
+    }
+    tx_partial_ = false;
+  }
 
-    // try to establish a connection to the server
-    task_app_->onRepeat(1000, [this]() {
-      if (!client_->client_->connected()) {
-        client_->client_->stop();
-        client_->clear_buf();
-        debugD("Connecting to %s:%d...", host_.c_str(), port_);
-        client_->client_->connect(host_.c_str(), port_);
-        debugD("Connected");
+  /// Receive any data sent to the client.
+  void receive() {
+    String line;
+    while (client_->read_line(line)) {
+      rx_bridge_->set_input(
+          OriginString{origin_id(&client_->client_), line, 0});
+    }
+    if (!client_->client_->connected()) {
+      debugD("Disconnected from %s:%d", host_.c_str(), port_);
+      disconnect();
+    }
+  }
+
+  void disconnect() {
+    connected_ = false;
+    if (state_ == ConnectState::kConnected) {
+      disconnects_++;
+      // start over with the shortest reconnect delay
+      backoff_ms_ = kTCPClientMinBackoffMs;
+      schedule_retry();
+    }
+    if (watched_fd_ >= 0) {
+      loop_->unwatch(watched_fd_);
+      watched_fd_ = -1;
+    }
+    client_->client_->stop();
+    client_->clear_buf();
+    if (backlog_ != nullptr) {
+      // a partially replayed line stays in the backlog and is sent again
+      replay_length_ = 0;
+      requeue_tx();
+    } else {
+      clear_tx();
+    }
+  }
+
+  void start_connect();
+  void check_connect();
+  void fail_connect(const char* reason);
+  void schedule_retry();
+  void request_resolve();
+  void on_resolved(bool resolved, const IPAddress& address);
+  void replay_backlog();
+  void check_deadlines();
+  void update_stats();
+};
+
+/**
+ * @brief Upstream TCP clients of one output, sharing a single task.
+ *
+ * Every line is encoded once by the producers upstream and copied into the
+ * TX ring of each client; an extra client costs its ring and connection
+ * state, but no task or queue of its own. Lines received from any of the
+ * clients are emitted in the given network loop.
+ */
+class TCPClientGroup : public ValueProducer<OriginString>,
+                       public ValueConsumer<OriginString>,
+                       public Startable {
+ public:
+  TCPClientGroup(const std::vector<HostPort>& targets, Networking* networking,
+                 NetworkLoop* rx_loop)
+      : Startable(50), networking_{networking} {
+    loop_ = new NetworkLoop(kTCPClientLoopMaxSleepMs);
+    // received lines are emitted in the given network loop
+    rx_bridge_ = new TaskBridge<OriginString>(kCrossTaskQueueSize, rx_loop);
+    for (auto& target : targets) {
+      clients_.push_back(
+          new StreamingTCPClient(target.host, target.port, loop_, rx_bridge_));
+    }
+  }
+
+  void set_input(OriginString new_value, uint8_t input_channel = 0) override {
+    for (auto client : clients_) {
+      client->write(new_value);
+    }
+    loop_->wake();
+  }
+
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+
+  /// Set the name used in the statistics of all clients.
+  void set_name(const String& name) {
+    for (auto client : clients_) {
+      client->set_name(name);
+    }
+  }
+
+  const std::vector<StreamingTCPClient*>& get_clients() const {
+    return clients_;
+  }
+
+  /**
+   * @brief Return true if every client is congested. A single slow server
+   * only loses its own lines.
+   */
+  bool is_congested() {
+    for (auto client : clients_) {
+      if (!client->is_congested()) {
+        return false;
       }
-    });
+    }
+    return !clients_.empty();
+  }
 
-    while (true) {
-      task_app_->tick();
+  /// Statistics of the clients as comma separated JSON objects.
+  String get_stats_json() {
+    String json = "";
+    for (auto client : clients_) {
+      if (json.length() > 0) {
+        json += ",";
+      }
+      json += client->get_stats_json();
+    }
+    return json;
+  }
+
+  /// Statistics of the clients as text, one line per server.
+  String get_stats_summary() {
+    String summary = "";
+    for (auto client : clients_) {
+      if (summary.length() > 0) {
+        summary += "\n";
+      }
+      summary += client->get_host() + ":" + String(client->get_port()) +
+                 ": " + client->get_stats_summary();
+    }
+    return summary;
+  }
+
+ protected:
+  Networking* networking_;
+  NetworkLoop* loop_;
+  TaskBridge<OriginString>* rx_bridge_;
+  std::vector<StreamingTCPClient*> clients_;
+  bool enabled_ = true;
 
-      // A small delay required to prevent the task watchdog from triggering.
-      // This also limits the maximum packet rate but greatly reduces
-      // idle CPU load.
-      delay(1);
+  void start() override;
+
+  void execute_client_task() {
+    for (auto client : clients_) {
+      client->start();
+    }
+
+    while (true) {
+      loop_->run_once();
     }
   }
 
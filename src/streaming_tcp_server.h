@@ -3,11 +3,20 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef SH_WG_LINUX
+#include <netinet/in.h>
+#endif
 
-#include <list>
 #include <memory>
+#include <mutex>
 
 #include "buffered_tcp_client.h"
+#include "client_subscription.h"
+#include "config.h"
+#include "network_loop.h"
 #include "origin_string.h"
 #include "sensesp/net/networking.h"
 #include "sensesp/system/lambda_consumer.h"
@@ -22,31 +31,160 @@ constexpr size_t kMaxClients = 10;
  * @brief TCP server that is able to receive and transmit continuous data
  * streams.
  *
+ * Each client has its own TX buffer, so a slow client never blocks the
+ * event loop or the other clients.
+ *
+ * Clients occupy a fixed table of kMaxClients slots. When all slots are in
+ * use, a new connection is either refused or takes over the slot of the
+ * client that has been idle the longest.
+ *
+ * If subscriptions are enabled, each client can select the messages it
+ * receives with the commands described in ClientSubscription.
+ *
+ * A client whose TX queue stays above a fill level for too long is
+ * disconnected, so that it doesn't keep its slot and buffer for data it
+ * never receives. Per-client statistics are published as a JSON document
+ * and a text summary, which may be read from any task.
+ *
+ * The server runs in a NetworkLoop and only does work when a connection
+ * is accepted, a client sends data, a client socket becomes writable again,
+ * or queued data reaches its flush deadline.
  */
 class StreamingTCPServer : public ValueProducer<OriginString>,
                            public ValueConsumer<OriginString>,
                            public Startable {
  public:
-  StreamingTCPServer(const uint16_t port, Networking *networking)
-      : Startable(50), networking_{networking}, port_{port} {
-    server_ = new WiFiServer(port);
+  StreamingTCPServer(const uint16_t port, Networking *networking,
+                     NetworkLoop *loop)
+      : Startable(50), networking_{networking}, port_{port}, loop_{loop} {
+    set_tx_buffer(kDefaultTCPClientTXBufferSize,
+                  TXOverflowPolicy::kDropOldest);
+    set_coalescing(kDefaultTCPFlushThreshold, kDefaultTCPFlushDeadlineMs);
+    set_slow_client_policy(kDefaultSlowClientQueuePercent,
+                           kDefaultSlowClientTimeoutMs);
 
-    ReactESP::app->onRepeatMicros(100, [this]() {
-      this->check_connections();
-      this->check_client_input();
+    loop->on_wakeup([this]() { this->check_client_output(); });
+    loop->get_app()->onRepeat(kClientStatsUpdatePeriodMs, [this]() {
+      this->check_slow_clients();
+      this->update_stats();
     });
+    loop->get_app()->onRepeat(kClientStatsLogPeriodMs,
+                              [this]() { this->log_stats(); });
+  }
+
+  /// Set the name used in the statistics.
+  void set_name(const String &name) { name_ = name; }
+
+  /**
+   * @brief Set the TX buffer size and overflow policy for new clients.
+   */
+  void set_tx_buffer(size_t size, TXOverflowPolicy overflow_policy) {
+    for (auto &client : clients_) {
+      client.set_tx_buffer(size, overflow_policy);
+    }
+  }
+
+  /**
+   * @brief Set how long and up to how many bytes client data is held back
+   * to be sent in fewer, larger TCP segments.
+   */
+  void set_coalescing(size_t flush_threshold, unsigned long flush_deadline_ms) {
+    for (auto &client : clients_) {
+      client.set_coalescing(flush_threshold, flush_deadline_ms);
+    }
+  }
+
+  /**
+   * @brief Evict the idlest client when a new client connects and all slots
+   * are in use. Otherwise, the new client is refused.
+   */
+  void set_evict_idlest(bool evict_idlest) { evict_idlest_ = evict_idlest; }
+
+  /**
+   * @brief Accept subscription commands from the clients. Lines received
+   * from a client that are subscription commands are not emitted.
+   */
+  void set_subscriptions_enabled(bool enabled) {
+    subscriptions_enabled_ = enabled;
+  }
+
+  /**
+   * @brief Disconnect clients whose TX queue reaches the given fill level
+   * and does not drain completely within the timeout. A timeout of 0
+   * disables the check.
+   */
+  void set_slow_client_policy(unsigned int queue_percent,
+                              unsigned long timeout_ms) {
+    slow_client_timeout_ms_ = timeout_ms;
+    for (auto &client : clients_) {
+      client.set_slow_queue_percent(timeout_ms == 0 ? 0 : queue_percent);
+    }
   }
 
   void send_buf(OriginString value) {
-    // debugD("Sending: %s", buf);
-    for (auto it = clients_.begin(); it != clients_.end(); it++) {
-      if ((*it).client_ != NULL && (*it).client_->connected() &&
-          value.origin_id != origin_id(&((*it).client_))) {
-        (*it).client_->write(value.data.c_str());
+    for (size_t i = 0; i < kMaxClients; i++) {
+      BufferedTCPClient &client = clients_[i];
+      if (client.is_in_use() &&
+          value.origin_id != origin_id(&client.client_) &&
+          subscriptions_[i].accepts(value.can_id)) {
+        if (!client.queue_tx(value.data) || !service_tx(client)) {
+          debugW("Disconnecting a client unable to keep up");
+          stop_client(client);
+        }
       }
     }
   }
 
+  /**
+   * @brief Return true if the TX buffers of all clients are nearly full.
+   *
+   * A single slow client does not hold back the others; its own buffer
+   * overflows instead.
+   */
+  bool is_congested() {
+    bool any_client = false;
+    for (auto &client : clients_) {
+      if (!client.is_in_use()) {
+        continue;
+      }
+      if (client.get_tx_depth() < client.get_tx_capacity() * 3 / 4) {
+        return false;
+      }
+      any_client = true;
+    }
+    return any_client;
+  }
+
+  /// Client slot table; check is_in_use() before using a slot.
+  const BufferedTCPClient *get_clients() const { return clients_; }
+  size_t get_num_clients() const {
+    size_t count = 0;
+    for (auto &client : clients_) {
+      if (client.is_in_use()) {
+        count++;
+      }
+    }
+    return count;
+  }
+  const ClientSubscription &get_subscription(size_t slot) const {
+    return subscriptions_[slot];
+  }
+  uint32_t get_refused_count() const { return refused_count_; }
+  uint32_t get_evicted_count() const { return evicted_count_; }
+  uint32_t get_slow_evicted_count() const { return slow_evicted_count_; }
+
+  /// Latest client statistics as a JSON object. Safe to call from any task.
+  String get_stats_json() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_json_;
+  }
+
+  /// Latest client statistics as text. Safe to call from any task.
+  String get_stats_summary() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_summary_;
+  }
+
   void set_input(OriginString new_value, uint8_t input_channel = 0) override {
     send_buf(new_value);
   }
@@ -55,54 +193,250 @@ class StreamingTCPServer : public ValueProducer<OriginString>,
 
  protected:
   Networking *networking_;
-  WiFiServer *server_;
+  String name_;
   const uint16_t port_;
+  NetworkLoop *loop_;
+  int listen_fd_ = -1;
 
   bool enabled_ = true;
+  bool evict_idlest_ = true;
 
-  std::list<BufferedTCPClient> clients_;
+  BufferedTCPClient clients_[kMaxClients];
+  bool subscriptions_enabled_ = false;
+  ClientSubscription subscriptions_[kMaxClients];
+  uint32_t refused_count_ = 0;
+  uint32_t evicted_count_ = 0;
+  unsigned long slow_client_timeout_ms_ = 0;
+  uint32_t slow_evicted_count_ = 0;
+
+  std::mutex stats_mutex_;
+  String stats_json_ = "{}";
+  String stats_summary_ = "No clients";
 
   void add_client(WiFiClient &client) {
+    BufferedTCPClient *slot = nullptr;
+    BufferedTCPClient *idlest = nullptr;
+    for (auto &candidate : clients_) {
+      if (!candidate.is_in_use()) {
+        slot = &candidate;
+        break;
+      }
+      if (idlest == nullptr ||
+          candidate.get_idle_ms() > idlest->get_idle_ms()) {
+        idlest = &candidate;
+      }
+    }
+
+    if (slot == nullptr) {
+      if (!evict_idlest_) {
+        debugW("Refusing client on port %d: all %d slots in use", port_,
+               (int)kMaxClients);
+        refused_count_++;
+        client.stop();
+        return;
+      }
+      debugW("Evicting a client idle for %lu ms on port %d",
+             idlest->get_idle_ms(), port_);
+      evicted_count_++;
+      stop_client(*idlest);
+      slot = idlest;
+    }
+
     debugD("New client connected");
-    clients_.push_back(
-        BufferedTCPClient(WiFiClientPtr(new WiFiClient(client))));
+    slot->attach(client);
+    subscriptions_[slot - clients_].clear();
+    loop_->watch(
+        slot->fd(), [this, slot]() { this->check_client_input(*slot); },
+        [this, slot]() {
+          if (!this->service_tx(*slot)) {
+            this->stop_client(*slot);
+          }
+        });
   }
 
-  void stop_client(std::list<BufferedTCPClient>::iterator &it) {
+  void stop_client(BufferedTCPClient &client) {
     debugD("Client disconnected");
-    (*it).client_->stop();
-    it = clients_.erase(it);
+    loop_->unwatch(client.fd());
+    client.detach();
   }
 
-  void check_connections() {
-    // listen for incoming clients
-    WiFiClient client = server_->available();
+  /// Open the listening socket. Called in the network task.
+  void listen_for_clients() {
+    if (listen_fd_ >= 0) {
+      return;
+    }
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      debugE("Could not create a socket for port %d: errno %d", port_, errno);
+      return;
+    }
+    int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+    if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd_, kMaxClients) < 0) {
+      debugE("Could not listen on port %d: errno %d", port_, errno);
+      close(listen_fd_);
+      listen_fd_ = -1;
+      return;
+    }
+    fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL, 0) | O_NONBLOCK);
+    loop_->watch(listen_fd_, [this]() { this->accept_clients(); });
+  }
 
-    if (client) {
+  void accept_clients() {
+    while (true) {
+      int fd = accept(listen_fd_, NULL, NULL);
+      if (fd < 0) {
+        return;
+      }
+      WiFiClient client(fd);
       add_client(client);
     }
+  }
 
-    for (auto it = clients_.begin(); it != clients_.end(); it++) {
-      if ((*it).client_ != NULL) {
-        if (!(*it).client_->connected()) {
-          stop_client(it);
-        }
-      } else {
-        debugW("Client did not get automatically erased");
-        it = clients_.erase(it);  // Should have been erased by StopClient
+  void check_client_input(BufferedTCPClient &client) {
+    String line;
+    while (client.read_line(line)) {
+      if (subscriptions_enabled_ && ClientSubscription::is_command(line)) {
+        handle_subscription(client, line);
+        continue;
       }
+      OriginString value{origin_id(&client.client_), line, 0};
+      this->emit(value);
+    }
+    if (!client.client_->connected()) {
+      stop_client(client);
     }
   }
 
-  void check_client_input() {
-    for (auto it = clients_.begin(); it != clients_.end(); it++) {
-      if ((*it).client_ != NULL && (*it).client_->connected()) {
-        String line;
-        while ((*it).read_line(line)) {
-          OriginString value{origin_id(&((*it).client_)), line};
-          this->emit(value);
-        }
+  void handle_subscription(BufferedTCPClient &client, const String &command) {
+    size_t slot = &client - clients_;
+    String reply;
+    if (subscriptions_[slot].apply(command, reply)) {
+      debugD("Port %d client %d subscribed to %s", port_, (int)slot,
+             subscriptions_[slot].to_string().c_str());
+    }
+    // the reply goes out with the next flush like any other data
+    client.queue_tx(reply);
+  }
+
+  /**
+   * @brief Write the queued data of a client if it is due, and make sure
+   * that the loop wakes up again when the rest can be written.
+   *
+   * @return false if the connection has failed.
+   */
+  bool service_tx(BufferedTCPClient &client) {
+    if (client.is_flush_due() && !client.flush_tx()) {
+      return false;
+    }
+    // data left over from a due flush is waiting for socket buffer space
+    bool blocked = client.get_tx_depth() > 0 && client.is_flush_due();
+    loop_->set_write_interest(client.fd(), blocked);
+    if (client.get_tx_depth() > 0 && !blocked) {
+      loop_->wake_at(client.get_flush_deadline());
+    }
+    return true;
+  }
+
+  void check_client_output() {
+    for (auto &client : clients_) {
+      if (client.is_in_use() && client.get_tx_depth() > 0 &&
+          !service_tx(client)) {
+        stop_client(client);
+      }
+    }
+  }
+
+  void check_slow_clients() {
+    if (slow_client_timeout_ms_ == 0) {
+      return;
+    }
+    for (auto &client : clients_) {
+      if (client.is_in_use() &&
+          client.get_slow_ms() > slow_client_timeout_ms_) {
+        debugW("Disconnecting slow client %s on port %d: TX queue backed up "
+               "for %lu ms",
+               client.get_remote_address(), port_, client.get_slow_ms());
+        slow_evicted_count_++;
+        stop_client(client);
+      }
+    }
+  }
+
+  void update_stats() {
+    char buf[320];
+    snprintf(buf, sizeof(buf),
+             "{\"name\":\"%s\",\"port\":%u,\"refused\":%u,"
+             "\"evicted_idle\":%u,\"evicted_slow\":%u,\"clients\":[",
+             name_.c_str(), (unsigned)port_, refused_count_, evicted_count_,
+             slow_evicted_count_);
+    String json = buf;
+    String summary;
+    bool first = true;
+    for (size_t i = 0; i < kMaxClients; i++) {
+      const BufferedTCPClient &client = clients_[i];
+      if (!client.is_in_use()) {
+        continue;
+      }
+      snprintf(
+          buf, sizeof(buf),
+          "%s{\"slot\":%u,\"address\":\"%s\",\"age_s\":%lu,"
+          "\"bytes_in\":%llu,\"lines_in\":%u,\"bytes_out\":%llu,"
+          "\"lines_out\":%u,\"write_stalls\":%u,\"dropped_lines\":%u,"
+          "\"queue\":%u,\"queue_high_water\":%u,\"queue_capacity\":%u,"
+          "\"subscription\":\"%s\"}",
+          first ? "" : ",", (unsigned)i, client.get_remote_address(),
+          client.get_age_ms() / 1000,
+          (unsigned long long)client.get_rx_byte_count(),
+          client.get_rx_line_count(),
+          (unsigned long long)client.get_tx_byte_count(),
+          client.get_tx_line_count(), client.get_tx_stall_count(),
+          client.get_tx_drop_count(), (unsigned)client.get_tx_depth(),
+          (unsigned)client.get_tx_high_water(),
+          (unsigned)client.get_tx_capacity(),
+          subscriptions_[i].to_string().c_str());
+      json += buf;
+      snprintf(buf, sizeof(buf),
+               "%s%s: %lu s, out %llu kB, queue peak %u%%, dropped %u",
+               first ? "" : "; ", client.get_remote_address(),
+               client.get_age_ms() / 1000,
+               (unsigned long long)client.get_tx_byte_count() / 1024,
+               (unsigned)(client.get_tx_high_water() * 100 /
+                          std::max<size_t>(client.get_tx_capacity(), 1)),
+               client.get_tx_drop_count());
+      summary += buf;
+      first = false;
+    }
+    json += "]}";
+    if (first) {
+      summary = "No clients";
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_json_ = json;
+    stats_summary_ = summary;
+  }
+
+  void log_stats() {
+    for (size_t i = 0; i < kMaxClients; i++) {
+      const BufferedTCPClient &client = clients_[i];
+      if (!client.is_in_use()) {
+        continue;
       }
+      debugD(
+          "Port %d client %d: TX queue %u/%u bytes, peak %u, dropped %u, "
+          "writes %u, subscribed to %s",
+          port_, (int)i, (unsigned)client.get_tx_depth(),
+          (unsigned)client.get_tx_capacity(),
+          (unsigned)client.get_tx_high_water(), client.get_tx_drop_count(),
+          client.get_tx_write_count(),
+          subscriptions_[i].to_string().c_str());
     }
   }
 
@@ -113,7 +447,7 @@ class StreamingTCPServer : public ValueProducer<OriginString>,
             if ((state == WiFiState::kWifiConnectedToAP) ||
                 (state == WiFiState::kWifiAPModeActivated)) {
               debugI("Starting Streaming TCP server on port %d", port_);
-              server_->begin();
+              loop_->post([this]() { this->listen_for_clients(); });
             }
           }));
     }
@@ -5,29 +5,119 @@
 #include <AsyncUDP.h>
 #include <WiFi.h>
 
+#include <atomic>
+#include <cstring>
+
+#include "config.h"
+#include "elapsedMillis.h"
+#include "network_loop.h"
 #include "sensesp/net/networking.h"
-#include "sensesp/system/task_queue_producer.h"
 #include "sensesp/system/valueconsumer.h"
 #include "origin_string.h"
+#include "shwg.h"
+#include "udp_packet_pool.h"
 
 using namespace sensesp;
 
+/**
+ * @brief How StreamingUDPServer transmits its datagrams.
+ */
+enum class UDPMode {
+  kBroadcast,  ///< To the broadcast address of the network
+  kMulticast,  ///< To an IP multicast group, joined for receiving as well
+  kUnicast,    ///< To a list of hosts, through UDPUnicastOutput
+};
+
+inline UDPMode UDPModeFromString(const String& mode) {
+  if (mode == "Multicast") {
+    return UDPMode::kMulticast;
+  }
+  if (mode == "Unicast") {
+    return UDPMode::kUnicast;
+  }
+  return UDPMode::kBroadcast;
+}
+
 class StreamingUDPServer : public ValueProducer<OriginString>,
                            public ValueConsumer<OriginString>,
                            public Startable {
  public:
-  StreamingUDPServer(const uint16_t port, Networking* networking)
-      : Startable(50), networking_{networking}, port_{port} {
-    task_queue_producer_ = new TaskQueueProducer<OriginString*>(NULL, ReactESP::app, 200, 490);
+  StreamingUDPServer(const uint16_t port, Networking* networking,
+                     NetworkLoop* loop)
+      : Startable(50), networking_{networking}, port_{port}, loop_{loop} {
+    // received packets are emitted in the given network loop
+    rx_pool_ = new UDPPacketPool(kUDPRXPoolSize, loop);
   }
 
   void set_input(OriginString new_value, uint8_t input_channel = 0) override {
-    if (connected_ && new_value.origin_id != origin_id(&async_udp_)) {
-      size_t len_sent = async_udp_.broadcast(new_value.data.c_str());
-      if (len_sent == 0) {
-        debugW("UDP broadcast failed: %s", new_value.data.c_str());
-      }
+    if (new_value.origin_id != get_origin_id()) {
+      send(new_value.data.c_str(), new_value.data.length());
+    }
+  }
+
+  /**
+   * @brief Send to the given multicast group instead of broadcasting. Must
+   * be called before the server is started.
+   */
+  void set_multicast(const IPAddress& group) {
+    if (group[0] < 224 || group[0] > 239) {
+      debugW("%s is not a multicast group address, broadcasting instead",
+             group.toString().c_str());
+      return;
+    }
+    mode_ = UDPMode::kMulticast;
+    multicast_group_ = group;
+  }
+
+  /**
+   * @brief Send a single datagram.
+   *
+   * @return false if the server is not running or sending failed.
+   */
+  bool send(const char* data, size_t length) {
+    if (!connected_) {
+      return false;
+    }
+    if (mode_ == UDPMode::kMulticast) {
+      return send_to(multicast_group_, port_, data, length);
+    }
+    size_t len_sent = async_udp_.broadcast((uint8_t*)data, length);
+    return check_sent(len_sent, length);
+  }
+
+  /**
+   * @brief Send a single datagram to the given address from the server's
+   * socket.
+   *
+   * @return false if the server is not running or sending failed.
+   */
+  bool send_to(const IPAddress& address, uint16_t port, const char* data,
+               size_t length) {
+    if (!connected_) {
+      return false;
+    }
+    size_t len_sent =
+        async_udp_.writeTo((const uint8_t*)data, length, address, port);
+    return check_sent(len_sent, length);
+  }
+
+  /// Default destination port of the server.
+  uint16_t get_port() const { return port_; }
+
+  /// Origin ID of the strings received by this server.
+  uint32_t get_origin_id() { return origin_id(&async_udp_); }
+
+  /// Number of received datagrams dropped for lack of a free buffer.
+  uint32_t get_rx_drop_count() const {
+    return rx_pool_->get_exhausted_count() + rx_pool_->get_oversize_count();
+  }
+
+  /// Return true if a broadcast recently failed.
+  bool is_congested() {
+    if (congested_ && congestion_elapsed_ > kCongestionHoldMs) {
+      congested_ = false;
     }
+    return congested_;
   }
 
   void set_enabled(bool enabled) { enabled_ = enabled; }
@@ -35,12 +125,78 @@ class StreamingUDPServer : public ValueProducer<OriginString>,
  protected:
   Networking* networking_;
   const uint16_t port_;
+  NetworkLoop* loop_;
   AsyncUDP async_udp_;
-  bool connected_ = false;
-  TaskQueueProducer<OriginString*>* task_queue_producer_;
+  UDPMode mode_ = UDPMode::kBroadcast;
+  IPAddress multicast_group_;
+  // read by the tasks sending through the server
+  std::atomic<bool> connected_{false};
+  bool congested_ = false;
+  elapsedMillis congestion_elapsed_;
+  UDPPacketPool* rx_pool_;
+  OriginString rx_line_;
 
   bool enabled_ = true;
 
+  bool check_sent(size_t len_sent, size_t length) {
+    if (len_sent == 0) {
+      debugW("UDP send of %u bytes failed", (unsigned)length);
+      congested_ = true;
+      congestion_elapsed_ = 0;
+      return false;
+    }
+    return true;
+  }
+
+  /// Open the socket and start receiving. Called in the network task.
+  void listen_for_packets() {
+    if (!listen()) {
+      debugE("UDP Server startup failed - port reserved?");
+      return;
+    }
+    connected_ = true;
+    async_udp_.onPacket([this](AsyncUDPPacket packet) {
+      // handle the received packet in the network task
+      rx_pool_->receive(packet.data(), packet.length());
+    });
+  }
+
+  bool listen() {
+    if (mode_ == UDPMode::kMulticast) {
+      debugI("Joining multicast group %s",
+             multicast_group_.toString().c_str());
+      return async_udp_.listenMulticast(multicast_group_, port_);
+    }
+    return async_udp_.listen(port_);
+  }
+
+  /**
+   * @brief Emit each line of a received datagram, without the line
+   * terminator. The datagram is split in place.
+   */
+  void emit_lines(char* data, size_t length) {
+    rx_line_.origin_id = get_origin_id();
+    rx_line_.can_id = 0;
+    char* end = data + length;
+    char* line = data;
+    while (line < end) {
+      char* newline = (char*)memchr(line, '\n', end - line);
+      char* line_end = newline == nullptr ? end : newline;
+      if (line_end > line && line_end[-1] == '\r') {
+        line_end--;
+      }
+      if (line_end > line) {
+        *line_end = '\0';
+        rx_line_.data = line;
+        this->emit(rx_line_);
+      }
+      if (newline == nullptr) {
+        break;
+      }
+      line = newline + 1;
+    }
+  }
+
   void start() override {
     if (enabled_) {
       networking_->connect_to(
@@ -48,33 +204,12 @@ class StreamingUDPServer : public ValueProducer<OriginString>,
             if ((state == WiFiState::kWifiConnectedToAP) ||
                 (state == WiFiState::kWifiAPModeActivated)) {
               debugI("Starting Streaming UDP server on port %d", port_);
-              if (async_udp_.listen(port_)) {
-                connected_ = true;
-                async_udp_.onPacket([this](AsyncUDPPacket packet) {
-                  // ensure that the received packet is zero-terminated
-                  char buf[packet.length() + 1];
-                  memcpy(buf, packet.data(), packet.length());
-                  buf[packet.length()] = '\0';
-
-                  OriginString* ydwg_string = new OriginString{
-                      origin_id(&async_udp_), buf};
-                  //  Handle the received packet in the main task
-                  int retval = task_queue_producer_->set(ydwg_string);
-                  if (retval == false) {
-                    debugW("StreamingUDPServer: task_queue_producer_ full, dropping value");
-                    delete ydwg_string;
-                  }
-                });
-              } else {
-                debugE("UDP Server startup failed - port reserved?");
-              }
+              loop_->post([this]() { this->listen_for_packets(); });
             }
           }));
-      task_queue_producer_->connect_to(
-          new LambdaConsumer<OriginString*>([this](OriginString* ydwg_str) {
-            this->emit(*ydwg_str);
-            delete ydwg_str;
-          }));
+      rx_pool_->on_packet([this](char* data, size_t length) {
+        this->emit_lines(data, length);
+      });
     }
   }
 };
@@ -19,13 +19,13 @@ class StringTokenizer : public SymmetricTransform<OriginString> {
     String value_string = value.data;
     while ((pos = value_string.indexOf(delimiter_)) != -1) {
       String substring = value_string.substring(0, pos);
-      OriginString output = {value.origin_id, substring};
+      OriginString output = {value.origin_id, substring, value.can_id};
       this->emit(output);
       value_string = value_string.substring(pos + delimiter_.length());
     }
     // if there is anything left, emit it
     if (value_string.length() > 0) {
-      OriginString output = {value.origin_id, value_string};
+      OriginString output = {value.origin_id, value_string, value.can_id};
       this->emit(output);
     }
   }
@@ -0,0 +1,63 @@
+#ifndef SH_WG_FIRMWARE_TASK_BRIDGE_H_
+#define SH_WG_FIRMWARE_TASK_BRIDGE_H_
+
+#include "ReactESP.h"
+#include "network_loop.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+#include "spsc_queue.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Pass values from one task to another through a lock-free queue.
+ *
+ * set_input() is called in the producing task and must always be called
+ * from the same task. The values are emitted in the event loop of the
+ * consuming task. Values arriving while the queue is full are dropped and
+ * counted.
+ *
+ * A consumer ReactESP instance polls the queue on every tick. A consumer
+ * NetworkLoop is woken up by set_input() instead, so that it can sleep
+ * while there is nothing to do.
+ */
+template <typename T>
+class TaskBridge : public ValueConsumer<T>, public ValueProducer<T> {
+ public:
+  TaskBridge(size_t capacity, ReactESP* consumer_app)
+      : ValueConsumer<T>(), ValueProducer<T>(), queue_{capacity} {
+    consumer_app->onTick([this]() { this->drain(); });
+  }
+
+  TaskBridge(size_t capacity, NetworkLoop* consumer_loop)
+      : ValueConsumer<T>(),
+        ValueProducer<T>(),
+        queue_{capacity},
+        consumer_loop_{consumer_loop} {
+    consumer_loop->on_wakeup([this]() { this->drain(); });
+  }
+
+  void set_input(T new_value, uint8_t input_channel = 0) override {
+    queue_.push(new_value);
+    if (consumer_loop_ != nullptr) {
+      consumer_loop_->wake();
+    }
+  }
+
+  size_t get_depth() const { return queue_.get_depth(); }
+  size_t get_high_water() const { return queue_.get_high_water(); }
+  uint32_t get_drop_count() const { return queue_.get_drop_count(); }
+
+ protected:
+  SPSCQueue<T> queue_;
+  NetworkLoop* consumer_loop_ = nullptr;
+
+  void drain() {
+    T value;
+    while (queue_.pop(value)) {
+      this->emit(value);
+    }
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_TASK_BRIDGE_H_
@@ -0,0 +1,268 @@
+#include "tcp_client_backlog.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "sensesp.h"
+
+TCPClientBacklog::TCPClientBacklog(size_t ram_size, size_t file_size,
+                                   const String& file_path)
+    : ram_(ram_size), file_path_{file_path}, file_size_{file_size} {
+  if (file_size_ != 0 && file_size_ < 2 * kTCPClientBacklogSpillChunkSize) {
+    debugW("Backlog file size %u is too small, not using %s",
+           (unsigned)file_size_, file_path_.c_str());
+    file_size_ = 0;
+  }
+  if (file_size_ != 0) {
+    spill_buf_.resize(kTCPClientBacklogSpillChunkSize);
+  }
+}
+
+void TCPClientBacklog::push(const char* data, size_t length) {
+  size_t size = kHeaderSize + length;
+  if (length > kTCPClientBacklogMaxLineLength || size > ram_.size()) {
+    drops_++;
+    return;
+  }
+  char header[kHeaderSize];
+  uint32_t timestamp = millis();
+  uint16_t length16 = length;
+  memcpy(header, &timestamp, 4);
+  memcpy(header + 4, &length16, 2);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (ram_.size() - ram_used_ < size) {
+    drop_ram_front();
+  }
+  ram_write(ram_head_, header, kHeaderSize);
+  ram_write((ram_head_ + kHeaderSize) % ram_.size(), data, length);
+  ram_head_ = (ram_head_ + size) % ram_.size();
+  ram_used_ += size;
+  num_records_++;
+  if (ram_used_ > ram_high_water_.load()) {
+    ram_high_water_ = ram_used_;
+  }
+}
+
+void TCPClientBacklog::spill() {
+  if (file_size_ == 0) {
+    return;
+  }
+
+  // take whole records off the front of the RAM ring
+  size_t length = 0;
+  size_t num_spilled = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ram_used_ <= ram_.size() / 2) {
+      return;
+    }
+    while (ram_used_ > 0) {
+      size_t size = ram_record_size(ram_tail_);
+      if (length + size > spill_buf_.size()) {
+        break;
+      }
+      ram_read(ram_tail_, &spill_buf_[length], size);
+      length += size;
+      num_spilled++;
+      ram_tail_ = (ram_tail_ + size) % ram_.size();
+      ram_used_ -= size;
+      ram_front_seq_++;
+    }
+  }
+
+  if (file_ == nullptr && !open_file()) {
+    num_records_ -= num_spilled;
+    drops_ += num_spilled;
+    return;
+  }
+  while (file_size_ - file_used_ < length && file_records_ > 0) {
+    drop_file_front();
+  }
+  if (file_ == nullptr) {
+    num_records_ -= num_spilled;
+    drops_ += num_spilled;
+    return;
+  }
+  if (!file_write(file_head_, spill_buf_.data(), length) ||
+      fflush(file_) != 0) {
+    num_records_ -= num_spilled;
+    drops_ += num_spilled;
+    close_file("write failed");
+    return;
+  }
+  file_head_ = (file_head_ + length) % file_size_;
+  file_used_ += length;
+  file_records_ += num_spilled;
+}
+
+size_t TCPClientBacklog::peek(char* buf) {
+  char header[kHeaderSize];
+  uint16_t length;
+
+  // the file holds the older records
+  if (file_records_ > 0) {
+    if (file_read(file_tail_, header, kHeaderSize)) {
+      memcpy(&length, header + 4, 2);
+      if (length <= kTCPClientBacklogMaxLineLength &&
+          file_read((file_tail_ + kHeaderSize) % file_size_, buf, length)) {
+        peeked_from_file_ = true;
+        peeked_size_ = kHeaderSize + length;
+        return length;
+      }
+    }
+    close_file("read failed");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (ram_used_ == 0) {
+    peeked_size_ = 0;
+    return 0;
+  }
+  ram_read(ram_tail_, header, kHeaderSize);
+  memcpy(&length, header + 4, 2);
+  ram_read((ram_tail_ + kHeaderSize) % ram_.size(), buf, length);
+  peeked_from_file_ = false;
+  peeked_size_ = kHeaderSize + length;
+  peeked_seq_ = ram_front_seq_;
+  return length;
+}
+
+void TCPClientBacklog::pop() {
+  if (peeked_size_ == 0) {
+    return;
+  }
+  if (peeked_from_file_) {
+    file_tail_ = (file_tail_ + peeked_size_) % file_size_;
+    file_used_ -= peeked_size_;
+    file_records_--;
+    num_records_--;
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // the producer may have dropped the record in the meantime
+    if (peeked_seq_ == ram_front_seq_) {
+      ram_tail_ = (ram_tail_ + peeked_size_) % ram_.size();
+      ram_used_ -= peeked_size_;
+      ram_front_seq_++;
+      num_records_--;
+    }
+  }
+  peeked_size_ = 0;
+}
+
+size_t TCPClientBacklog::get_ram_depth() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ram_used_;
+}
+
+unsigned long TCPClientBacklog::get_oldest_age_ms() {
+  char header[kHeaderSize];
+  if (file_records_ > 0) {
+    if (!file_read(file_tail_, header, kHeaderSize)) {
+      return 0;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ram_used_ == 0) {
+      return 0;
+    }
+    ram_read(ram_tail_, header, kHeaderSize);
+  }
+  uint32_t timestamp;
+  memcpy(&timestamp, header, 4);
+  return (uint32_t)millis() - timestamp;
+}
+
+void TCPClientBacklog::ram_read(size_t offset, char* data, size_t length) {
+  size_t first = std::min(length, ram_.size() - offset);
+  memcpy(data, &ram_[offset], first);
+  memcpy(data + first, &ram_[0], length - first);
+}
+
+void TCPClientBacklog::ram_write(size_t offset, const char* data,
+                                 size_t length) {
+  size_t first = std::min(length, ram_.size() - offset);
+  memcpy(&ram_[offset], data, first);
+  memcpy(&ram_[0], data + first, length - first);
+}
+
+size_t TCPClientBacklog::ram_record_size(size_t offset) {
+  char header[kHeaderSize];
+  uint16_t length;
+  ram_read(offset, header, kHeaderSize);
+  memcpy(&length, header + 4, 2);
+  return kHeaderSize + length;
+}
+
+void TCPClientBacklog::drop_ram_front() {
+  size_t size = ram_record_size(ram_tail_);
+  ram_tail_ = (ram_tail_ + size) % ram_.size();
+  ram_used_ -= size;
+  ram_front_seq_++;
+  num_records_--;
+  drops_++;
+}
+
+bool TCPClientBacklog::open_file() {
+  file_ = fopen(file_path_.c_str(), "w+b");
+  if (file_ == nullptr) {
+    debugW("Could not create backlog file %s", file_path_.c_str());
+    file_size_ = 0;
+    return false;
+  }
+  debugI("Spilling backlog to %s", file_path_.c_str());
+  return true;
+}
+
+void TCPClientBacklog::close_file(const char* reason) {
+  debugW("Backlog file %s %s, not using it any more", file_path_.c_str(),
+         reason);
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+    remove(file_path_.c_str());
+  }
+  num_records_ -= file_records_;
+  drops_ += file_records_;
+  file_size_ = 0;
+  file_head_ = file_tail_ = file_used_ = file_records_ = 0;
+}
+
+bool TCPClientBacklog::file_read(size_t offset, char* data, size_t length) {
+  size_t first = std::min(length, file_size_ - offset);
+  if (fseek(file_, offset, SEEK_SET) != 0 ||
+      fread(data, 1, first, file_) != first) {
+    return false;
+  }
+  return first == length || (fseek(file_, 0, SEEK_SET) == 0 &&
+                             fread(data + first, 1, length - first, file_) ==
+                                 length - first);
+}
+
+bool TCPClientBacklog::file_write(size_t offset, const char* data,
+                                  size_t length) {
+  size_t first = std::min(length, file_size_ - offset);
+  if (fseek(file_, offset, SEEK_SET) != 0 ||
+      fwrite(data, 1, first, file_) != first) {
+    return false;
+  }
+  return first == length || (fseek(file_, 0, SEEK_SET) == 0 &&
+                             fwrite(data + first, 1, length - first, file_) ==
+                                 length - first);
+}
+
+void TCPClientBacklog::drop_file_front() {
+  char header[kHeaderSize];
+  if (!file_read(file_tail_, header, kHeaderSize)) {
+    close_file("read failed");
+    return;
+  }
+  uint16_t length;
+  memcpy(&length, header + 4, 2);
+  size_t size = kHeaderSize + length;
+  file_tail_ = (file_tail_ + size) % file_size_;
+  file_used_ -= size;
+  file_records_--;
+  num_records_--;
+  drops_++;
+}
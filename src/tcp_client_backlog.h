@@ -0,0 +1,107 @@
+#ifndef SH_WG_FIRMWARE_TCP_CLIENT_BACKLOG_H_
+#define SH_WG_FIRMWARE_TCP_CLIENT_BACKLOG_H_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "config.h"
+
+/**
+ * @brief Bounded store-and-forward backlog of the lines an upstream TCP
+ * client could not send.
+ *
+ * Every line is stored as a record together with the time it was queued.
+ * New records are appended to a RAM ring. If a backlog file is configured,
+ * the oldest records are moved from the RAM ring to a ring file on the
+ * flash file system whenever the RAM ring is more than half full, so that
+ * the file always holds the older part of the backlog. When a ring is full,
+ * its oldest records are dropped.
+ *
+ * push() may be called from any task, but the other methods must only be
+ * called from one task. The backlog file is recreated at startup; its
+ * contents do not survive a restart.
+ */
+class TCPClientBacklog {
+ public:
+  TCPClientBacklog(size_t ram_size, size_t file_size, const String& file_path);
+
+  /// Append a line. Lines longer than kTCPClientBacklogMaxLineLength are
+  /// dropped.
+  void push(const char* data, size_t length);
+
+  bool is_empty() const { return num_records_.load() == 0; }
+
+  /// Move the oldest records to the backlog file if the RAM ring is more
+  /// than half full.
+  void spill();
+
+  /**
+   * @brief Copy the oldest line to the buffer, which must hold at least
+   * kTCPClientBacklogMaxLineLength bytes.
+   *
+   * @return Length of the line, 0 if the backlog is empty.
+   */
+  size_t peek(char* buf);
+
+  /// Remove the line returned by the last peek().
+  void pop();
+
+  size_t get_num_records() const { return num_records_.load(); }
+  size_t get_ram_depth();
+  size_t get_ram_high_water() const { return ram_high_water_.load(); }
+  size_t get_file_depth() const { return file_used_; }
+  /// Number of lines dropped because the backlog was full.
+  uint32_t get_drop_count() const { return drops_.load(); }
+  /// Time the oldest line has been waiting in ms, 0 if the backlog is empty.
+  unsigned long get_oldest_age_ms();
+
+ protected:
+  // timestamp and length of a record
+  static constexpr size_t kHeaderSize = 6;
+
+  // RAM ring; shared by both tasks and guarded by the mutex
+  std::mutex mutex_;
+  std::vector<char> ram_;
+  size_t ram_head_ = 0;
+  size_t ram_tail_ = 0;
+  size_t ram_used_ = 0;
+  // incremented whenever a record leaves the front of the RAM ring
+  uint32_t ram_front_seq_ = 0;
+  std::atomic<size_t> ram_high_water_{0};
+
+  // ring file; only used by the consuming task
+  String file_path_;
+  FILE* file_ = nullptr;
+  size_t file_size_;
+  size_t file_head_ = 0;
+  size_t file_tail_ = 0;
+  size_t file_used_ = 0;
+  size_t file_records_ = 0;
+  // records on their way from RAM to the file
+  std::vector<char> spill_buf_;
+
+  // state of the record returned by peek()
+  bool peeked_from_file_ = false;
+  size_t peeked_size_ = 0;
+  uint32_t peeked_seq_ = 0;
+
+  std::atomic<size_t> num_records_{0};
+  std::atomic<uint32_t> drops_{0};
+
+  void ram_read(size_t offset, char* data, size_t length);
+  void ram_write(size_t offset, const char* data, size_t length);
+  size_t ram_record_size(size_t offset);
+  void drop_ram_front();
+
+  bool open_file();
+  void close_file(const char* reason);
+  bool file_read(size_t offset, char* data, size_t length);
+  bool file_write(size_t offset, const char* data, size_t length);
+  void drop_file_front();
+};
+
+#endif  // SH_WG_FIRMWARE_TCP_CLIENT_BACKLOG_H_
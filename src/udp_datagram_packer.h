@@ -0,0 +1,104 @@
+#ifndef SH_WG_FIRMWARE_UDP_DATAGRAM_PACKER_H_
+#define SH_WG_FIRMWARE_UDP_DATAGRAM_PACKER_H_
+
+#include <cstring>
+#include <vector>
+
+#include "network_loop.h"
+#include "origin_string.h"
+#include "sensesp/system/valueconsumer.h"
+#include "streaming_udp_server.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Pack input strings into as few UDP datagrams as possible.
+ *
+ * Strings are appended to a preallocated datagram buffer until the next one
+ * would not fit in the payload size, and are never split between datagrams.
+ * A partially filled datagram is sent when it has waited for the maximum
+ * delay. Broadcasts are sent at the WiFi basic rate, so every datagram
+ * saved is a considerable amount of airtime.
+ *
+ * Strings received by the destination server itself are not sent back.
+ * Subclasses can send the datagrams elsewhere by overriding send_datagram().
+ */
+class UDPDatagramPacker : public ValueConsumer<OriginString> {
+ public:
+  UDPDatagramPacker(StreamingUDPServer* server, size_t payload_size,
+                    unsigned long max_delay_ms, NetworkLoop* loop)
+      : server_{server},
+        buf_(payload_size),
+        max_delay_ms_{max_delay_ms},
+        loop_{loop} {
+    loop->on_wakeup([this]() { this->check_timeout(); });
+  }
+
+  virtual ~UDPDatagramPacker() {}
+
+  void set_input(OriginString new_value, uint8_t input_channel = 0) override {
+    if (new_value.origin_id == server_->get_origin_id()) {
+      return;
+    }
+    size_t length = new_value.data.length();
+    if (length > buf_.size()) {
+      debugW("Input string longer than the datagram payload: %s",
+             new_value.data.c_str());
+      return;
+    }
+    if (length_ + length > buf_.size()) {
+      flush();
+    }
+    if (length_ == 0) {
+      batch_started_ = millis();
+      loop_->wake_at(batch_started_ + max_delay_ms_);
+    }
+    memcpy(&buf_[length_], new_value.data.c_str(), length);
+    line_count_++;
+    length_ += length;
+    if (length_ == buf_.size()) {
+      flush();
+    }
+  }
+
+  uint32_t get_datagram_count() const { return datagram_count_; }
+  uint64_t get_byte_count() const { return byte_count_; }
+  uint32_t get_line_count() const { return line_count_; }
+  uint32_t get_failure_count() const { return failure_count_; }
+
+ protected:
+  StreamingUDPServer* server_;
+  std::vector<char> buf_;
+  size_t length_ = 0;
+  unsigned long max_delay_ms_;
+  unsigned long batch_started_ = 0;
+  NetworkLoop* loop_;
+  uint32_t datagram_count_ = 0;
+  uint64_t byte_count_ = 0;
+  uint32_t line_count_ = 0;
+  uint32_t failure_count_ = 0;
+
+  virtual bool send_datagram(const char* data, size_t length) {
+    return server_->send(data, length);
+  }
+
+  void flush() {
+    if (length_ > 0) {
+      if (send_datagram(buf_.data(), length_)) {
+        datagram_count_++;
+        byte_count_ += length_;
+      } else {
+        failure_count_++;
+      }
+      length_ = 0;
+    }
+  }
+
+  void check_timeout() {
+    if (length_ > 0 && millis() - batch_started_ >= max_delay_ms_) {
+      flush();
+    }
+  }
+};
+
+#endif  // SH_WG_FIRMWARE_UDP_DATAGRAM_PACKER_H_
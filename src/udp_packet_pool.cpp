@@ -0,0 +1,45 @@
+#include "udp_packet_pool.h"
+
+#include <cstring>
+
+UDPPacketPool::UDPPacketPool(size_t num_packets, NetworkLoop* loop)
+    : packets_(num_packets),
+      free_{num_packets},
+      filled_{num_packets},
+      loop_{loop} {
+  for (size_t i = 0; i < num_packets; i++) {
+    free_.push(i);
+  }
+  loop->on_wakeup([this]() { this->drain(); });
+}
+
+bool UDPPacketPool::receive(const uint8_t* data, size_t length) {
+  if (length > kUDPDatagramPayloadSize) {
+    oversize_count_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  uint8_t index;
+  if (!free_.pop(index)) {
+    exhausted_count_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  Packet& packet = packets_[index];
+  memcpy(packet.data, data, length);
+  packet.data[length] = '\0';
+  packet.length = length;
+  // there is a slot for every buffer, so this cannot fail
+  filled_.push(index);
+  loop_->wake();
+  return true;
+}
+
+void UDPPacketPool::drain() {
+  uint8_t index;
+  while (filled_.pop(index)) {
+    Packet& packet = packets_[index];
+    if (handler_) {
+      handler_(packet.data, packet.length);
+    }
+    free_.push(index);
+  }
+}
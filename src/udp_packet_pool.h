@@ -0,0 +1,71 @@
+#ifndef SH_WG_FIRMWARE_UDP_PACKET_POOL_H_
+#define SH_WG_FIRMWARE_UDP_PACKET_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "config.h"
+#include "network_loop.h"
+#include "spsc_queue.h"
+
+/**
+ * @brief Fixed pool of receive buffers handing UDP datagrams over to the
+ * network task.
+ *
+ * receive() is called in the UDP receive callback. It copies the datagram
+ * into a free buffer and passes the buffer index to the network task
+ * through a lock-free queue. The handler gets the buffer in place, zero
+ * terminated and writable, and the buffer returns to the pool when the
+ * handler returns. Indices travel back through a second queue, so both
+ * directions have a single producer.
+ *
+ * Nothing is allocated after construction. Datagrams arriving while every
+ * buffer is in use, or larger than a buffer, are dropped and counted.
+ */
+class UDPPacketPool {
+ public:
+  using Handler = std::function<void(char* data, size_t length)>;
+
+  UDPPacketPool(size_t num_packets, NetworkLoop* loop);
+
+  /// Set the function handling the received datagrams in the network task.
+  void on_packet(Handler handler) { handler_ = handler; }
+
+  /**
+   * @brief Queue a received datagram. Must always be called from the same
+   * task.
+   *
+   * @return false if the datagram was dropped.
+   */
+  bool receive(const uint8_t* data, size_t length);
+
+  size_t get_size() const { return packets_.size(); }
+  size_t get_high_water() const { return filled_.get_high_water(); }
+  uint32_t get_exhausted_count() const {
+    return exhausted_count_.load(std::memory_order_relaxed);
+  }
+  uint32_t get_oversize_count() const {
+    return oversize_count_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  struct Packet {
+    uint16_t length;
+    char data[kUDPDatagramPayloadSize + 1];
+  };
+
+  std::vector<Packet> packets_;
+  SPSCQueue<uint8_t> free_;    //< network task -> receive callback
+  SPSCQueue<uint8_t> filled_;  //< receive callback -> network task
+  NetworkLoop* loop_;
+  Handler handler_;
+  std::atomic<uint32_t> exhausted_count_{0};
+  std::atomic<uint32_t> oversize_count_{0};
+
+  void drain();
+};
+
+#endif  // SH_WG_FIRMWARE_UDP_PACKET_POOL_H_
@@ -0,0 +1,92 @@
+#include "udp_unicast_output.h"
+
+void UDPUnicastPacker::request_resolve() {
+  unsigned long now = millis();
+  if (literal_ || resolve_pending_ ||
+      (resolved_ && now - resolved_ms_ < kUDPDestinationDNSCacheTTLMs) ||
+      (resolve_attempted_ &&
+       now - last_resolve_attempt_ < kUDPDestinationResolveRetryMs)) {
+    return;
+  }
+  resolve_pending_ = true;
+  resolve_attempted_ = true;
+  last_resolve_attempt_ = now;
+  ResolveHostAsync(destination_.host, loop_,
+                   [this](bool resolved, const IPAddress& address) {
+                     this->on_resolved(resolved, address);
+                   });
+}
+
+void UDPUnicastPacker::on_resolved(bool resolved, const IPAddress& address) {
+  resolve_pending_ = false;
+  if (!resolved) {
+    // keep sending to the last known address, if there is one
+    debugW("Could not resolve UDP destination %s",
+           destination_.host.c_str());
+    return;
+  }
+  if (!resolved_ || (uint32_t)address != (uint32_t)address_) {
+    debugI("UDP destination %s resolved to %s", destination_.host.c_str(),
+           address.toString().c_str());
+  }
+  address_ = address;
+  resolved_ = true;
+  resolved_ms_ = millis();
+}
+
+bool UDPUnicastPacker::send_datagram(const char* data, size_t length) {
+  request_resolve();
+  if (!resolved_) {
+    return false;
+  }
+  return server_->send_to(address_, destination_.port, data, length);
+}
+
+UDPUnicastOutput::UDPUnicastOutput(
+    const String& name, StreamingUDPServer* server,
+    const std::vector<UDPDestination>& destinations, NetworkLoop* loop)
+    : name_{name} {
+  if (destinations.empty()) {
+    debugW("%s is in unicast mode but has no destinations", name.c_str());
+  }
+  for (const auto& destination : destinations) {
+    packers_.push_back(new UDPUnicastPacker(server, destination, loop));
+  }
+  loop->get_app()->onRepeat(kClientStatsUpdatePeriodMs,
+                            [this]() { this->update_stats(); });
+}
+
+void UDPUnicastOutput::update_stats() {
+  char buf[256];
+  String json = "{\"name\":\"" + name_ + "\",\"destinations\":[";
+  String summary;
+  bool first = true;
+  for (auto packer : packers_) {
+    const UDPDestination& destination = packer->get_destination();
+    String address = packer->get_address();
+    snprintf(buf, sizeof(buf),
+             "%s{\"host\":\"%s\",\"port\":%u,\"address\":\"%s\","
+             "\"datagrams\":%u,\"bytes\":%llu,\"lines\":%u,\"failures\":%u}",
+             first ? "" : ",", destination.host.c_str(),
+             (unsigned)destination.port, address.c_str(),
+             packer->get_datagram_count(),
+             (unsigned long long)packer->get_byte_count(),
+             packer->get_line_count(), packer->get_failure_count());
+    json += buf;
+    snprintf(buf, sizeof(buf), "%s%s:%u: out %llu kB, failed %u",
+             first ? "" : "; ", destination.host.c_str(),
+             (unsigned)destination.port,
+             (unsigned long long)packer->get_byte_count() / 1024,
+             packer->get_failure_count());
+    summary += buf;
+    first = false;
+  }
+  json += "]}";
+  if (first) {
+    summary = "No destinations";
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_json_ = json;
+  stats_summary_ = summary;
+}
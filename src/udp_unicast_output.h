@@ -0,0 +1,121 @@
+#ifndef SH_WG_FIRMWARE_UDP_UNICAST_OUTPUT_H_
+#define SH_WG_FIRMWARE_UDP_UNICAST_OUTPUT_H_
+
+#include <mutex>
+#include <vector>
+
+#include "config.h"
+#include "host_port_list.h"
+#include "host_resolver.h"
+#include "network_loop.h"
+#include "origin_string.h"
+#include "sensesp/system/valueconsumer.h"
+#include "streaming_udp_server.h"
+#include "udp_datagram_packer.h"
+
+using namespace sensesp;
+
+/**
+ * @brief Unicast UDP destination.
+ */
+typedef HostPort UDPDestination;
+
+/**
+ * @brief Parse a comma or space separated list of host[:port] destinations.
+ *
+ * Destinations without a port use the default port. Invalid entries and
+ * entries beyond kMaxUDPDestinations are skipped with a warning.
+ *
+ * @return false if any entry was skipped.
+ */
+inline bool ParseUDPDestinations(const String& list, uint16_t default_port,
+                                 std::vector<UDPDestination>& destinations) {
+  return ParseHostPortList(list, default_port, kMaxUDPDestinations,
+                           "UDP destination", destinations);
+}
+
+/**
+ * @brief Datagram packer sending to a single unicast destination.
+ *
+ * Host names are looked up in the resolver task (see ResolveHostAsync())
+ * when the first datagram is sent, so the lookup doesn't block the network
+ * task. Datagrams are dropped until the destination has an address. The
+ * address is looked up again once it is older than
+ * kUDPDestinationDNSCacheTTLMs, and kept if that fails. Failed lookups are
+ * retried after kUDPDestinationResolveRetryMs.
+ */
+class UDPUnicastPacker : public UDPDatagramPacker {
+ public:
+  UDPUnicastPacker(StreamingUDPServer* server,
+                   const UDPDestination& destination, NetworkLoop* loop)
+      : UDPDatagramPacker(server, kUDPDatagramPayloadSize,
+                          kUDPMaxBatchDelayMs, loop),
+        destination_(destination),
+        literal_(address_.fromString(destination.host)) {
+    resolved_ = literal_;
+  }
+
+  const UDPDestination& get_destination() const { return destination_; }
+  /// Resolved address, or an empty string if not resolved.
+  String get_address() const { return resolved_ ? address_.toString() : ""; }
+
+ protected:
+  UDPDestination destination_;
+  IPAddress address_;
+  // the destination is an IP address and needs no lookup
+  const bool literal_;
+  bool resolved_;
+  unsigned long resolved_ms_ = 0;
+  bool resolve_pending_ = false;
+  bool resolve_attempted_ = false;
+  unsigned long last_resolve_attempt_ = 0;
+
+  void request_resolve();
+  void on_resolved(bool resolved, const IPAddress& address);
+  bool send_datagram(const char* data, size_t length) override;
+};
+
+/**
+ * @brief Send a UDP output to a list of unicast destinations.
+ *
+ * Every destination has its own datagram packer, so that datagrams are
+ * batched and counted per destination. Unicast frames are acknowledged and
+ * sent at the rate negotiated with each station, unlike broadcasts, and
+ * also reach hosts on other subnets.
+ */
+class UDPUnicastOutput : public ValueConsumer<OriginString> {
+ public:
+  UDPUnicastOutput(const String& name, StreamingUDPServer* server,
+                   const std::vector<UDPDestination>& destinations,
+                   NetworkLoop* loop);
+
+  void set_input(OriginString new_value, uint8_t input_channel = 0) override {
+    for (auto packer : packers_) {
+      packer->set_input(new_value, input_channel);
+    }
+  }
+
+  /// Latest destination statistics as JSON. Safe to call from any task.
+  String get_stats_json() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_json_;
+  }
+
+  /// Latest destination statistics as text. Safe to call from any task.
+  String get_stats_summary() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_summary_;
+  }
+
+ protected:
+  String name_;
+  std::vector<UDPUnicastPacker*> packers_;
+
+  std::mutex stats_mutex_;
+  String stats_json_ = "{}";
+  String stats_summary_ = "No destinations";
+
+  void update_stats();
+};
+
+#endif  // SH_WG_FIRMWARE_UDP_UNICAST_OUTPUT_H_
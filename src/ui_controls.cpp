@@ -1,10 +1,22 @@
 #include "ui_controls.h"
 
+#include <algorithm>
+
+#include "config.h"
+
+/// Limit a configured number to the given range.
+static int ClampConfigValue(int value, int min_value, int max_value) {
+  return std::min(std::max(value, min_value), max_value);
+}
+
 static const char kPortConfigSchema[] = R"({
     "type": "object",
     "properties": {
         "enable": { "title": "Enable", "type": "boolean" },
-        "port": { "title": "Port", "type": "integer" }
+        "port": { "title": "Port", "type": "integer" },
+        "pgn_filter_mode": { "title": "PGN filter", "type": "string", "enum": ["Off", "Allow", "Deny"] },
+        "pgn_filter": { "title": "PGNs (comma separated)", "type": "string" },
+        "rate_limits": { "title": "Rate limits (PGN[@source]=messages per second, comma separated)", "type": "string" }
     }
   })";
 
@@ -13,6 +25,9 @@ String PortConfig::get_config_schema() { return kPortConfigSchema; }
 void PortConfig::get_configuration(JsonObject& root) {
   root["enable"] = enabled_;
   root["port"] = port_;
+  root["pgn_filter_mode"] = pgn_filter_mode_;
+  root["pgn_filter"] = pgn_filter_;
+  root["rate_limits"] = rate_limits_;
 }
 
 bool PortConfig::set_configuration(const JsonObject& config) {
@@ -28,6 +43,19 @@ bool PortConfig::set_configuration(const JsonObject& config) {
     port_ = config["port"];
   }
 
+  // filters and rate limits are optional to keep older configurations valid
+  if (config.containsKey("pgn_filter_mode")) {
+    pgn_filter_mode_ = config["pgn_filter_mode"].as<String>();
+  }
+
+  if (config.containsKey("pgn_filter")) {
+    pgn_filter_ = config["pgn_filter"].as<String>();
+  }
+
+  if (config.containsKey("rate_limits")) {
+    rate_limits_ = config["rate_limits"].as<String>();
+  }
+
   return true;
 }
 
@@ -37,7 +65,10 @@ static const char kBiDiPortConfigSchemaTemplate[] = R"({
     "properties": {
         "enable_tx": { "title": "{{tx_title}}", "type": "boolean" },
         "enable_rx": { "title": "{{rx_title}}", "type": "boolean" },
-        "port": { "title": "Port", "type": "integer" }
+        "port": { "title": "Port", "type": "integer" },
+        "pgn_filter_mode": { "title": "PGN filter", "type": "string", "enum": ["Off", "Allow", "Deny"] },
+        "pgn_filter": { "title": "PGNs (comma separated)", "type": "string" },
+        "rate_limits": { "title": "Rate limits (PGN[@source]=messages per second, comma separated)", "type": "string" }
     }
   })";
 
@@ -51,6 +82,9 @@ void BiDiPortConfig::get_configuration(JsonObject& root) {
   root["enable_tx"] = tx_enabled_;
   root["enable_rx"] = rx_enabled_;
   root["port"] = port_;
+  root["pgn_filter_mode"] = pgn_filter_mode_;
+  root["pgn_filter"] = pgn_filter_;
+  root["rate_limits"] = rate_limits_;
 }
 
 bool BiDiPortConfig::set_configuration(const JsonObject& config) {
@@ -72,6 +106,113 @@ bool BiDiPortConfig::set_configuration(const JsonObject& config) {
     port_ = config["port"];
   }
 
+  // filters and rate limits are optional to keep older configurations valid
+  if (config.containsKey("pgn_filter_mode")) {
+    pgn_filter_mode_ = config["pgn_filter_mode"].as<String>();
+  }
+
+  if (config.containsKey("pgn_filter")) {
+    pgn_filter_ = config["pgn_filter"].as<String>();
+  }
+
+  if (config.containsKey("rate_limits")) {
+    rate_limits_ = config["rate_limits"].as<String>();
+  }
+
+  return true;
+}
+
+static const char kUDPPortConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "enable": { "title": "Enable", "type": "boolean" },
+        "port": { "title": "Port", "type": "integer" },
+        "udp_mode": { "title": "Send as", "type": "string", "enum": ["Broadcast", "Multicast", "Unicast"] },
+        "multicast_group": { "title": "Multicast group address", "type": "string" },
+        "destinations": { "title": "Unicast destinations (host[:port], comma separated)", "type": "string" },
+        "pgn_filter_mode": { "title": "PGN filter", "type": "string", "enum": ["Off", "Allow", "Deny"] },
+        "pgn_filter": { "title": "PGNs (comma separated)", "type": "string" },
+        "rate_limits": { "title": "Rate limits (PGN[@source]=messages per second, comma separated)", "type": "string" }
+    }
+  })";
+
+String UDPPortConfig::get_config_schema() { return kUDPPortConfigSchema; }
+
+void UDPPortConfig::get_configuration(JsonObject& root) {
+  PortConfig::get_configuration(root);
+  root["udp_mode"] = udp_mode_;
+  root["multicast_group"] = multicast_group_;
+  root["destinations"] = destinations_;
+}
+
+bool UDPPortConfig::set_configuration(const JsonObject& config) {
+  if (!PortConfig::set_configuration(config)) {
+    return false;
+  }
+
+  // absent from older configurations
+  if (config.containsKey("udp_mode")) {
+    udp_mode_ = config["udp_mode"].as<String>();
+  }
+
+  if (config.containsKey("multicast_group")) {
+    multicast_group_ = config["multicast_group"].as<String>();
+  }
+
+  if (config.containsKey("destinations")) {
+    destinations_ = config["destinations"].as<String>();
+  }
+
+  return true;
+}
+
+static const char kUDPBiDiPortConfigSchemaTemplate[] = R"({
+    "type": "object",
+    "properties": {
+        "enable_tx": { "title": "{{tx_title}}", "type": "boolean" },
+        "enable_rx": { "title": "{{rx_title}}", "type": "boolean" },
+        "port": { "title": "Port", "type": "integer" },
+        "udp_mode": { "title": "Send as", "type": "string", "enum": ["Broadcast", "Multicast", "Unicast"] },
+        "multicast_group": { "title": "Multicast group address, also joined for receiving", "type": "string" },
+        "destinations": { "title": "Unicast destinations (host[:port], comma separated)", "type": "string" },
+        "pgn_filter_mode": { "title": "PGN filter", "type": "string", "enum": ["Off", "Allow", "Deny"] },
+        "pgn_filter": { "title": "PGNs (comma separated)", "type": "string" },
+        "rate_limits": { "title": "Rate limits (PGN[@source]=messages per second, comma separated)", "type": "string" }
+    }
+  })";
+
+String UDPBiDiPortConfig::get_config_schema() {
+  String schema = kUDPBiDiPortConfigSchemaTemplate;
+  schema.replace("{{tx_title}}", tx_title_);
+  schema.replace("{{rx_title}}", rx_title_);
+  return schema;
+}
+
+void UDPBiDiPortConfig::get_configuration(JsonObject& root) {
+  BiDiPortConfig::get_configuration(root);
+  root["udp_mode"] = udp_mode_;
+  root["multicast_group"] = multicast_group_;
+  root["destinations"] = destinations_;
+}
+
+bool UDPBiDiPortConfig::set_configuration(const JsonObject& config) {
+  if (!BiDiPortConfig::set_configuration(config)) {
+    return false;
+  }
+
+  // absent from older configurations
+  if (config.containsKey("udp_mode")) {
+    udp_mode_ = config["udp_mode"].as<String>();
+  }
+
+  if (config.containsKey("multicast_group")) {
+    multicast_group_ = config["multicast_group"].as<String>();
+  }
+
+  if (config.containsKey("destinations")) {
+    destinations_ = config["destinations"].as<String>();
+  }
+
   return true;
 }
 
@@ -80,7 +221,10 @@ static const char kHostPortConfigSchemaTemplate[] = R"({
     "properties": {
         "enable": { "title": "{{title}}", "type": "boolean" },
         "host": { "title": "{{host}}", "type": "string" },
-        "port": { "title": "{{port}}", "type": "integer" }
+        "port": { "title": "{{port}}", "type": "integer" },
+        "pgn_filter_mode": { "title": "PGN filter", "type": "string", "enum": ["Off", "Allow", "Deny"] },
+        "pgn_filter": { "title": "PGNs (comma separated)", "type": "string" },
+        "rate_limits": { "title": "Rate limits (PGN[@source]=messages per second, comma separated)", "type": "string" }
     }
   })";
 
@@ -96,6 +240,9 @@ void HostPortConfig::get_configuration(JsonObject& root) {
   root["enable"] = enabled_;
   root["host"] = host_;
   root["port"] = port_;
+  root["pgn_filter_mode"] = pgn_filter_mode_;
+  root["pgn_filter"] = pgn_filter_;
+  root["rate_limits"] = rate_limits_;
 }
 
 bool HostPortConfig::set_configuration(const JsonObject& config) {
@@ -117,6 +264,19 @@ bool HostPortConfig::set_configuration(const JsonObject& config) {
     port_ = config["port"];
   }
 
+  // filters and rate limits are optional to keep older configurations valid
+  if (config.containsKey("pgn_filter_mode")) {
+    pgn_filter_mode_ = config["pgn_filter_mode"].as<String>();
+  }
+
+  if (config.containsKey("pgn_filter")) {
+    pgn_filter_ = config["pgn_filter"].as<String>();
+  }
+
+  if (config.containsKey("rate_limits")) {
+    rate_limits_ = config["rate_limits"].as<String>();
+  }
+
   return true;
 }
 
@@ -174,4 +334,152 @@ bool StringConfig::set_configuration(const JsonObject& config) {
   return true;
 }
 
+static const char kCANBufferConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "auto_size": { "title": "Automatic RX buffer sizing", "type": "boolean" },
+        "msg_buf_size": { "title": "Fast packet message buffer size", "type": "integer", "minimum": 1, "maximum": 50 },
+        "rx_frame_buf_size": { "title": "RX frame buffer size", "type": "integer", "minimum": 1, "maximum": 1000 },
+        "observed_peak": { "title": "Observed RX queue peak", "type": "integer", "readOnly": true }
+    }
+  })";
+
+String CANBufferConfig::get_config_schema() { return kCANBufferConfigSchema; }
+
+void CANBufferConfig::get_configuration(JsonObject& root) {
+  root["auto_size"] = auto_size_;
+  root["msg_buf_size"] = msg_buf_size_;
+  root["rx_frame_buf_size"] = rx_frame_buf_size_;
+  root["observed_peak"] = observed_peak_;
+}
+
+bool CANBufferConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("auto_size")) {
+    return false;
+  } else {
+    auto_size_ = config["auto_size"];
+  }
+
+  if (!config.containsKey("msg_buf_size")) {
+    return false;
+  } else {
+    msg_buf_size_ =
+        ClampConfigValue(config["msg_buf_size"], 1, kMaxN2kCANMsgBufSize);
+  }
+
+  if (!config.containsKey("rx_frame_buf_size")) {
+    return false;
+  } else {
+    rx_frame_buf_size_ = ClampConfigValue(config["rx_frame_buf_size"], 1,
+                                          kMaxN2kCANReceiveFrameBufSize);
+  }
+
+  // the observed peak is not editable and is absent from older configs
+  if (config.containsKey("observed_peak")) {
+    observed_peak_ = config["observed_peak"];
+  }
+
+  return true;
+}
+
+static const char kTCPClientBufferConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "tx_buffer_size": { "title": "TX buffer size per client (bytes)", "type": "integer" },
+        "overflow_policy": { "title": "When a client's TX buffer is full", "type": "string", "enum": ["Drop oldest", "Drop newest", "Disconnect"] },
+        "evict_idlest": { "title": "When all client slots are in use, disconnect the idlest client instead of refusing the new one", "type": "boolean" },
+        "flush_deadline_ms": { "title": "Maximum time data is held back to be sent in fewer packets (ms)", "type": "integer" },
+        "slow_client_queue_percent": { "title": "A client is slow from when its TX buffer is fuller than (%, 0 = never) until it is empty", "type": "integer" },
+        "slow_client_timeout_s": { "title": "Disconnect clients that stay slow for longer than (s, 0 = never)", "type": "integer" }
+    }
+  })";
+
+String TCPClientBufferConfig::get_config_schema() {
+  return kTCPClientBufferConfigSchema;
+}
+
+void TCPClientBufferConfig::get_configuration(JsonObject& root) {
+  root["tx_buffer_size"] = tx_buffer_size_;
+  root["overflow_policy"] = overflow_policy_;
+  root["evict_idlest"] = evict_idlest_;
+  root["flush_deadline_ms"] = flush_deadline_ms_;
+  root["slow_client_queue_percent"] = slow_client_queue_percent_;
+  root["slow_client_timeout_s"] = slow_client_timeout_s_;
+}
+
+bool TCPClientBufferConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("tx_buffer_size")) {
+    return false;
+  } else {
+    tx_buffer_size_ = config["tx_buffer_size"];
+  }
+
+  if (!config.containsKey("overflow_policy")) {
+    return false;
+  } else {
+    overflow_policy_ = config["overflow_policy"].as<String>();
+  }
+
+  // absent from older configurations
+  if (config.containsKey("evict_idlest")) {
+    evict_idlest_ = config["evict_idlest"];
+  }
+
+  if (config.containsKey("flush_deadline_ms")) {
+    flush_deadline_ms_ = config["flush_deadline_ms"];
+  }
+
+  if (config.containsKey("slow_client_queue_percent")) {
+    slow_client_queue_percent_ = config["slow_client_queue_percent"];
+  }
+
+  if (config.containsKey("slow_client_timeout_s")) {
+    slow_client_timeout_s_ = config["slow_client_timeout_s"];
+  }
+
+  return true;
+}
+
+static const char kTCPClientBacklogConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "ram_size_kb": { "title": "Backlog size in RAM per client (kB, 0 = disabled)", "type": "integer", "minimum": 0, "maximum": 64 },
+        "file_size_kb": { "title": "Backlog file size in flash per client (kB, 0 = none)", "type": "integer", "minimum": 0, "maximum": 1024 },
+        "replay_rate_kbps": { "title": "Backlog replay rate after reconnecting (kB/s, 0 = unlimited)", "type": "integer", "minimum": 0, "maximum": 1024 }
+    }
+  })";
+
+String TCPClientBacklogConfig::get_config_schema() {
+  return kTCPClientBacklogConfigSchema;
+}
+
+void TCPClientBacklogConfig::get_configuration(JsonObject& root) {
+  root["ram_size_kb"] = ram_size_kb_;
+  root["file_size_kb"] = file_size_kb_;
+  root["replay_rate_kbps"] = replay_rate_kbps_;
+}
+
+bool TCPClientBacklogConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("ram_size_kb")) {
+    return false;
+  } else {
+    ram_size_kb_ = ClampConfigValue(config["ram_size_kb"], 0,
+                                    kMaxTCPClientBacklogRAMSizeKB);
+  }
+
+  if (!config.containsKey("file_size_kb")) {
+    return false;
+  } else {
+    file_size_kb_ = ClampConfigValue(config["file_size_kb"], 0,
+                                     kMaxTCPClientBacklogFileSizeKB);
+  }
 
+  if (!config.containsKey("replay_rate_kbps")) {
+    return false;
+  } else {
+    replay_rate_kbps_ = ClampConfigValue(config["replay_rate_kbps"], 0,
+                                         kMaxTCPClientReplayRateKBps);
+  }
+
+  return true;
+}
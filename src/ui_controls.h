@@ -1,8 +1,12 @@
 #ifndef SH_WG_SRC_UI_CONTROLS_H_
 #define SH_WG_SRC_UI_CONTROLS_H_
 
+#include "buffered_tcp_client.h"
+#include "decimation.h"
+#include "pgn_filter.h"
 #include "sensesp.h"
 #include "sensesp/system/configurable.h"
+#include "streaming_udp_server.h"
 
 using namespace sensesp;
 
@@ -26,10 +30,17 @@ class PortConfig : public Configurable {
 
   bool get_enabled() { return enabled_; }
   uint16_t get_port() { return port_; }
+  PGNFilter get_pgn_filter() {
+    return PGNFilter(PGNFilterModeFromString(pgn_filter_mode_), pgn_filter_);
+  }
+  DecimationRules get_rate_limits() { return DecimationRules(rate_limits_); }
 
  protected:
   bool enabled_ = false;
   int port_ = 0;
+  String pgn_filter_mode_ = "Off";
+  String pgn_filter_ = "";
+  String rate_limits_ = "";
 };
 
 class BiDiPortConfig : public Configurable {
@@ -53,6 +64,10 @@ class BiDiPortConfig : public Configurable {
   bool get_tx_enabled() { return tx_enabled_; }
   bool get_rx_enabled() { return rx_enabled_; }
   uint16_t get_port() { return port_; }
+  PGNFilter get_pgn_filter() {
+    return PGNFilter(PGNFilterModeFromString(pgn_filter_mode_), pgn_filter_);
+  }
+  DecimationRules get_rate_limits() { return DecimationRules(rate_limits_); }
 
  protected:
   bool tx_enabled_ = false;
@@ -62,6 +77,71 @@ class BiDiPortConfig : public Configurable {
   String rx_title_ = "Receive";
 
   int port_ = 0;
+  String pgn_filter_mode_ = "Off";
+  String pgn_filter_ = "";
+  String rate_limits_ = "";
+};
+
+/**
+ * @brief PortConfig with the UDP transmission mode and multicast group.
+ */
+class UDPPortConfig : public PortConfig {
+ public:
+  UDPPortConfig(bool enabled, uint16_t port, String config_path,
+                String description, int sort_order = 1000)
+      : PortConfig(enabled, port, config_path, description, sort_order) {
+    // the base class constructor only loaded its own fields
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  UDPMode get_udp_mode() { return UDPModeFromString(udp_mode_); }
+  IPAddress get_multicast_group() {
+    IPAddress group;
+    group.fromString(multicast_group_);
+    return group;
+  }
+  String get_destinations() { return destinations_; }
+
+ protected:
+  String udp_mode_ = "Broadcast";
+  String multicast_group_ = kDefaultUDPMulticastGroup;
+  String destinations_ = "";
+};
+
+/**
+ * @brief BiDiPortConfig with the UDP transmission mode and multicast group.
+ */
+class UDPBiDiPortConfig : public BiDiPortConfig {
+ public:
+  UDPBiDiPortConfig(bool tx_enabled, bool rx_enabled, String tx_title,
+                    String rx_title, uint16_t port, String config_path,
+                    String description, int sort_order = 1000)
+      : BiDiPortConfig(tx_enabled, rx_enabled, tx_title, rx_title, port,
+                       config_path, description, sort_order) {
+    // the base class constructor only loaded its own fields
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  UDPMode get_udp_mode() { return UDPModeFromString(udp_mode_); }
+  IPAddress get_multicast_group() {
+    IPAddress group;
+    group.fromString(multicast_group_);
+    return group;
+  }
+  String get_destinations() { return destinations_; }
+
+ protected:
+  String udp_mode_ = "Broadcast";
+  String multicast_group_ = kDefaultUDPMulticastGroup;
+  String destinations_ = "";
 };
 
 class HostPortConfig : public Configurable {
@@ -86,11 +166,18 @@ class HostPortConfig : public Configurable {
   bool get_enabled() { return enabled_; }
   String get_host() { return host_; }
   uint16_t get_port() { return port_; }
+  PGNFilter get_pgn_filter() {
+    return PGNFilter(PGNFilterModeFromString(pgn_filter_mode_), pgn_filter_);
+  }
+  DecimationRules get_rate_limits() { return DecimationRules(rate_limits_); }
 
  protected:
   bool enabled_ = false;
   String host_ = "";
   int port_ = 0;
+  String pgn_filter_mode_ = "Off";
+  String pgn_filter_ = "";
+  String rate_limits_ = "";
   String enabled_title_;
   String host_title_;
   String port_title_;
@@ -136,4 +223,126 @@ class StringConfig : public Configurable {
   String title_ = "Value";
 };
 
+/**
+ * @brief Configurable for the NMEA 2000 CAN buffer sizes.
+ *
+ * If automatic sizing is enabled, the receive frame buffer is sized from the
+ * peak RX queue depth observed during previous runs. The observed peak is
+ * stored in the same configuration file.
+ */
+class CANBufferConfig : public Configurable {
+ public:
+  CANBufferConfig(bool auto_size, uint16_t msg_buf_size,
+                  uint16_t rx_frame_buf_size, String config_path,
+                  String description, int sort_order = 1000)
+      : Configurable(config_path, description, sort_order),
+        auto_size_(auto_size),
+        msg_buf_size_(msg_buf_size),
+        rx_frame_buf_size_(rx_frame_buf_size) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  bool get_auto_size() { return auto_size_; }
+  uint16_t get_msg_buf_size() { return msg_buf_size_; }
+  uint16_t get_rx_frame_buf_size() { return rx_frame_buf_size_; }
+  uint16_t get_observed_peak() { return observed_peak_; }
+
+  /**
+   * @brief Record a new RX queue depth peak. The configuration is saved only
+   * if the peak has grown.
+   */
+  void update_observed_peak(uint16_t peak) {
+    if (peak > observed_peak_) {
+      observed_peak_ = peak;
+      save_configuration();
+    }
+  }
+
+ protected:
+  bool auto_size_ = true;
+  uint16_t msg_buf_size_ = 0;
+  uint16_t rx_frame_buf_size_ = 0;
+  uint16_t observed_peak_ = 0;
+};
+
+/**
+ * @brief Configurable for the client slots and per-client TX buffers of the
+ * TCP servers.
+ */
+class TCPClientBufferConfig : public Configurable {
+ public:
+  TCPClientBufferConfig(size_t tx_buffer_size, String overflow_policy,
+                        bool evict_idlest, unsigned long flush_deadline_ms,
+                        int slow_client_queue_percent,
+                        unsigned long slow_client_timeout_ms,
+                        String config_path, String description,
+                        int sort_order = 1000)
+      : Configurable(config_path, description, sort_order),
+        tx_buffer_size_(tx_buffer_size),
+        overflow_policy_(overflow_policy),
+        evict_idlest_(evict_idlest),
+        flush_deadline_ms_(flush_deadline_ms),
+        slow_client_queue_percent_(slow_client_queue_percent),
+        slow_client_timeout_s_(slow_client_timeout_ms / 1000) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  size_t get_tx_buffer_size() { return tx_buffer_size_; }
+  TXOverflowPolicy get_overflow_policy() {
+    return TXOverflowPolicyFromString(overflow_policy_);
+  }
+  bool get_evict_idlest() { return evict_idlest_; }
+  unsigned long get_flush_deadline_ms() { return flush_deadline_ms_; }
+  int get_slow_client_queue_percent() { return slow_client_queue_percent_; }
+  unsigned long get_slow_client_timeout_ms() {
+    return slow_client_timeout_s_ * 1000UL;
+  }
+
+ protected:
+  int tx_buffer_size_ = 0;
+  String overflow_policy_ = "Drop oldest";
+  bool evict_idlest_ = true;
+  int flush_deadline_ms_ = 0;
+  int slow_client_queue_percent_ = 0;
+  int slow_client_timeout_s_ = 0;
+};
+
+/**
+ * @brief Configurable for the store-and-forward backlog of the upstream TCP
+ * clients.
+ */
+class TCPClientBacklogConfig : public Configurable {
+ public:
+  TCPClientBacklogConfig(size_t ram_size, size_t file_size, size_t replay_rate,
+                         String config_path, String description,
+                         int sort_order = 1000)
+      : Configurable(config_path, description, sort_order),
+        ram_size_kb_(ram_size / 1024),
+        file_size_kb_(file_size / 1024),
+        replay_rate_kbps_(replay_rate / 1024) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  size_t get_ram_size() { return ram_size_kb_ * 1024; }
+  size_t get_file_size() { return file_size_kb_ * 1024; }
+  size_t get_replay_rate() { return replay_rate_kbps_ * 1024; }
+
+ protected:
+  int ram_size_kb_ = 0;
+  int file_size_kb_ = 0;
+  int replay_rate_kbps_ = 0;
+};
+
 #endif  // SH_WG_SRC_UI_CONTROLS_H_
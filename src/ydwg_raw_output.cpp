@@ -23,7 +23,7 @@ OriginString CANFrameToYDWGRaw(const CANFrame& frame, struct timeval& timestamp)
 
   String out = time_str + direction + " " + can_id_str + buffer + "\r\n";
 
-  OriginString origin_string = {frame.origin_id, out};
+  OriginString origin_string = {frame.origin_id, out, frame.id};
 
   return origin_string;
 }
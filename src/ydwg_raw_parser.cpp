@@ -166,7 +166,7 @@ bool YDWGRawDeviceStringToCANFrame(CANFrame& frame, struct timeval& timestamp,
 
   String app_str = ydwg_raw_str.substring(pos);
 
-  OriginString app_origin_str = {ydwg_raw.origin_id, app_str};
+  OriginString app_origin_str = {ydwg_raw.origin_id, app_str, 0};
 
   if (YDWGRawAppStringToCANFrame(frame, app_origin_str)) {
     switch (direction) {